@@ -0,0 +1,56 @@
+// adapt.h
+#ifndef ADAPT_H
+#define ADAPT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/* ---- Macros ---- */
+#define ADAPT_AIMD 1            // additive increase, multiplicative decrease
+#define ADAPT_GRADIENT 2        // limit scaled by baseline / current RTT
+#define ADAPT_TOLERANCE 2.0     // RTT up to baseline x this is not congestion
+#define ADAPT_BACKOFF 0.9       // AIMD: limit multiplier on congestion
+#define ADAPT_SMOOTHING 0.2     // gradient: weight of each new limit
+#define ADAPT_REBASE 10         // s between baseline (min RTT) refreshes
+#define ADAPT_WAIT_MS 10        // longest wait for a slot before re-checking the run
+
+/* ---- Structures ---- */
+struct adapt_ctl            // in-flight limit shared by every client thread
+{
+    pthread_mutex_t lock;
+    pthread_cond_t slot;            // signalled when a request completes
+    int algo;                       // ADAPT_AIMD or ADAPT_GRADIENT
+    int max;                        // ceiling (number of client threads)
+    double limit;                   // current in-flight limit
+    int in_flight;                  // requests outstanding
+    uint64_t base_rtt;              // no-load RTT estimate (ns)
+    uint64_t next_base;             // min RTT since the last refresh
+    uint64_t rebase_at;             // when next_base replaces base_rtt
+    uint64_t last_cut;              // AIMD: time of the last decrease
+    uint64_t grad_sum, grad_n;      // gradient: RTTs of the current window
+    uint64_t measure_start;         // measurement window of the run
+    uint64_t measure_end;
+    uint64_t t_change;              // last time the integrals were updated
+    uint64_t interval_ns;           // period of the progress lines
+    uint64_t next_report;
+    // totals of the interval and the measurement window (Little's law)
+    double int_area, win_area;      // in_flight integrated over time (ns)
+    double int_limit, win_limit;    // limit integrated over time (ns)
+    double int_rtt, win_rtt;        // summed RTT (ns)
+    long int_n, win_n;              // completed requests
+};
+
+/* ---- Function Prototypes ---- */
+int parse_adapt(const char *name);
+const char *adapt_name(int algo);
+void adapt_init(int algo, int max, int interval_ms);
+void adapt_window(uint64_t start, uint64_t end);
+int adapt_acquire(uint64_t deadline);
+void adapt_release(uint64_t rtt_ns);
+void adapt_report(FILE *out, double secs);
+
+/* --- Variables ---- */
+extern struct adapt_ctl adapt;
+
+#endif
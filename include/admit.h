@@ -0,0 +1,47 @@
+// admit.h
+#ifndef ADMIT_H
+#define ADMIT_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* ---- Macros ---- */
+#define ADMIT_OK 0          // admit the connection
+#define ADMIT_FULL 1        // --max-conns reached
+#define ADMIT_LAG 2         // event loop lag over --max-lag
+
+#define REJECT_CLOSE 0      // accept then reset over-limit connections
+#define REJECT_PAUSE 1      // stop watching the listeners until load drops
+#define ADMIT_RECHECK 10    // ms between resume checks of a paused, quiet loop
+
+/* ---- Structures ---- */
+struct admit_ctl            // admission controller shared by every backend
+{
+    int max_conns;                  // open connection limit (0 = none)
+    uint64_t max_lag_ns;            // loop lag limit (0 = none)
+    int policy;                     // REJECT_CLOSE or REJECT_PAUSE
+    int pausable;                   // 1 once the backend can pause its listeners
+    int paused;                     // 1 while the listeners are paused
+    uint64_t lag_ns;                // smoothed loop lag
+    long rejected[3];               // connections rejected, by ADMIT_* reason
+    long pauses[3];                 // times the listeners were paused, by reason
+    uint64_t pause_start;
+    uint64_t paused_ns;             // total time paused
+};
+
+/* ---- Function Prototypes ---- */
+void admit_init(int max_conns, long max_lag_us, int policy);
+int admit_check(int live);
+void admit_loop_lag(uint64_t busy_ns);
+void admit_reject(int reason);
+void admit_set_pausable();
+int admit_pause(int reason);
+int admit_paused();
+int admit_resume(int live);
+void admit_report(FILE *out);
+int parse_reject(const char *name);
+
+/* --- Variables ---- */
+extern struct admit_ctl admit;
+
+#endif
@@ -0,0 +1,23 @@
+//clt_proc.h
+#ifndef CLT_PROC_H
+#define CLT_PROC_H
+
+#include <pthread.h>
+#include "clt_thread.h"
+
+/* ---- Structures ---- */
+struct clt_shm              // segment shared by the coordinator and its workers
+{
+    pthread_barrier_t start;        // releases every worker at once
+    pthread_barrier_t connected;    // starts the phases once every client has connected
+    int nslots;                     // number of worker slots
+    struct connect_stats slots[];   // merged results of each worker
+};
+
+/* ---- Function Prototypes ---- */
+int run_workers();
+int run_worker(struct clt_shm *shm, int id);
+int pin_core(int id);
+void wait_connected();
+
+#endif
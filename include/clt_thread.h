@@ -4,6 +4,13 @@
 
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include "keydist.h"
+#include "hist.h"
+#include "log.h"
+#include "socket.h"
+#include "verify.h"
+#include "series.h"
+#include "adapt.h"
 
 /* ---- Macros ---- */
 #define ARGSNUM 4
@@ -12,8 +19,19 @@
 #define ARG_CLTS 3
 #define STRINGSIZE 16
 #define PKTSIZE 1000
-#define TIMEOUT 20
+#define TIMEOUT 20          // default measurement window (s), --duration
 #define CLTLOGFILE "../data/clt_log"
+#define DEFKEYS 100000      // default key space of the kv workload
+#define DEFVLEN 100         // default value size of kv SETs
+#define DEFZIPF 0.99        // default zipf skew
+#define DEFCONNTIMEOUT 5000 // default connect timeout (ms)
+#define AUTOTUNE_SECS 3     // benchmark length of each profile when autotuning
+#define MAXSPREAD 254       // most loopback source addresses for --src-spread
+#define VERIFY_REPORTS 5    // bad echoes described per client (--integrity)
+#define KNEE_MAXPROBES 64   // most runs of the saturation search
+#define KNEE_PRECISION 20   // binary search stops within 1/20 (5%) of the knee
+#define CHURN_BACKOFF 1     // first wait after a failed churn connect (ms), doubles
+#define CHURN_MAXBACKOFF 1000   // longest wait between failed churn connects (ms)
 
 /* ---- Structures ---- */
 struct clt_nw_var                   // client network variables
@@ -22,14 +40,129 @@ struct clt_nw_var                   // client network variables
     struct sockaddr_in h_addr;      // addr of host to connect to
     in_port_t h_port;               // hosts port
     unsigned long h_ip;             // hosts ip
+    in_port_t l_port;               // local port to bind (0 = kernel picks)
+    in_addr_t l_ip;                 // local address to bind (0 = kernel picks)
+};
+
+struct clt_config           // runtime options of the load generator
+{
+    char *ip;                       // host ip cmd arg
+    char *port;                     // host port cmd arg
+    int clients;                    // number of clients over all processes
+    int procs;                      // load generator processes (1 = no fork)
+    int proc_clients;               // clients (threads) in this process
+    int client_base;                // id of this process's first client
+    int kv;                         // 1 to send kv requests instead of echo
+    struct keydist keys;            // kv key distribution
+    double read_ratio;              // fraction of kv requests that are GETs
+    double del_ratio;               // fraction of kv writes that are DELs
+    int vlen;                       // value size of kv SETs
+    double ramp_rate;               // connections per second (0 = all at once)
+    int step_size;                  // connections per ramp step (0 = no steps)
+    int step_ms;                    // time between ramp steps
+    int connect_timeout;            // connect timeout (ms)
+    uint64_t start_ns;              // time the ramp started (slots count from here)
+    uint64_t measure_start;         // requests completing in [measure_start,
+    uint64_t measure_end;           //   measure_end) are counted
+    uint64_t run_end;               // end of cool-down, clients stop
+    int churn;                      // requests per connection (0 = one connection)
+    int port_lo, port_hi;           // local port range to bind (0 = kernel picks)
+    int run_secs;                   // measurement window (TIMEOUT by default)
+    int warmup_secs;                // sending before the window, not counted
+    int cooldown_secs;              // sending after the window, not counted
+    double knee_slo_us;             // p99 SLO of the saturation search (0 = off)
+    int adaptive;                   // ADAPT_AIMD or ADAPT_GRADIENT (0 = fixed concurrency)
+    const struct sock_profile *profile; // socket options of client sockets
+    int autotune;                   // 1 to sweep every profile and report the best
+    const char *unix_path;          // unix socket to connect to (NULL = tcp)
+    int unix_type;                  // SOCK_STREAM or SOCK_SEQPACKET
+    int compare;                    // 1 to benchmark tcp against the unix socket
+    int idle;                       // idle connections each client holds open
+    int src_spread;                 // loopback source addresses to spread over (0 = off)
+    int quiet;                      // 1 to print nothing per connection
+    int integrity;                  // 1 to send checksummed frames and verify echoes
+    const char *series;             // time series file (NULL = none)
+    int interval_ms;                // time series period
+};
+
+struct connect_stats        // connection and request results of one client
+{
+    struct hist lat;                // connect latency (ns) of successful connects
+    struct hist rtt;                // request round trip time (ns)
+    int ok;                         // connections established
+    int refused;                    // ECONNREFUSED
+    int timeouts;                   // handshake did not finish in time
+    int resets;                     // reset/closed before the first echo
+    int other;                      // any other connect error
+    long requests;                  // requests completed over all connections
+    long verified;                  // echoes checked and intact (--integrity)
+    long corrupt;                   // echoes whose bytes changed
+    long misordered;                // intact echoes of another request
+    long short_echoes;              // connection ended part way through an echo
+};
+
+struct knee_probe           // one run of the saturation search
+{
+    int clients;                    // concurrency tried
+    double rate;                    // requests/sec
+    double p50, p99;                // round trip (us)
+    long errors;                    // failed connects and bad echoes
+    int pass;                       // 1 if within the SLO without errors
+};
+
+struct kv_counts            // per client kv operation counts
+{
+    int gets, sets, dels, misses, errors;
+};
+
+struct clt_run              // state one client carries across its connections
+{
+    struct clt_log_stats stats;     // requests and bytes over the whole run
+    struct kv_counts kv;            // kv operation counts
+    double total_time;              // sum of response times (ms)
+    uint64_t rng;                   // random state of kv workload
+    int next_port;                  // next local port to bind (--ports)
+    int next_src;                   // connections opened so far (--src-spread)
+    uint64_t seq;                   // requests sent over all connections (--integrity)
+    int *idle;                      // idle connections held until the run ends
+    int nidle;
 };
 
 /* ---- Function Prototypes ---- */
+int parse_args(int argc, char **argv);
 int valid_args(int arg, char *port, char *clients);
+int build_kv_request(char *buff, uint64_t *rng, struct kv_counts *counts);
+void check_kv_response(char *buff, struct kv_counts *counts);
+int check_echo(const char *buff, int len, struct clt_run *run);
+void wait_ramp_slot(int client);
+void churn_backoff(int *backoff);
+void set_phases(uint64_t t0);
+double measured_secs();
+int next_local_port(struct clt_run *run);
+in_addr_t next_local_addr(struct clt_run *run);
+int open_idle(struct clt_nw_var nw, struct clt_run *run);
+void close_idle(struct clt_run *run);
+void check_port_range();
+void classify_connect_error(struct connect_stats *cs, int err);
+void merge_connect_stats(struct connect_stats *dst, const struct connect_stats *src);
+void report_connect_stats(const struct connect_stats *stats, int n);
+int run_clients();
+int bench_run(double *rate, double *p50, double *p99, long *errors);
+int autotune();
+int compare_transports();
+int find_knee();
+int knee_probe(struct knee_probe *probe, int clients);
 int connect_to_host(struct clt_nw_var *nw);
-int send_loop(struct clt_nw_var nw);
+int connect_unix(struct clt_nw_var *nw);
+int send_loop(struct clt_nw_var nw, struct clt_run *run);
 void spawn_clients(char *ip, char *port);
 void get_host_info(struct clt_nw_var *nw, char *ip, char *port);
 void print_nw_struct(struct clt_nw_var nw);
+void print_usage();
+
+/* --- Variables ---- */
+extern struct clt_config clt_cfg;
+extern struct connect_stats *conn_stats;
+extern int clt_active;
 
 #endif
@@ -0,0 +1,25 @@
+// deque.h
+#ifndef DEQUE_H
+#define DEQUE_H
+
+/* ---- Macros ---- */
+#define DEQUESIZE 1024      // slots per deque (power of 2)
+#define DEQUE_EMPTY ((void *)0)
+#define DEQUE_ABORT ((void *)1) // lost a race, the caller may retry
+
+/* ---- Structures ---- */
+struct ws_deque             // Chase-Lev work-stealing deque (fixed size)
+{
+    long top __attribute__((aligned(64)));      // thieves take from here
+    long bottom __attribute__((aligned(64)));   // owner pushes and takes here
+    void *slots[DEQUESIZE];
+};
+
+/* ---- Function Prototypes ---- */
+void deque_init(struct ws_deque *d);
+int deque_push(struct ws_deque *d, void *item);
+void *deque_take(struct ws_deque *d);
+void *deque_steal(struct ws_deque *d);
+long deque_size(struct ws_deque *d);
+
+#endif
@@ -0,0 +1,53 @@
+// fiber.h
+#ifndef FIBER_H
+#define FIBER_H
+
+#include <stddef.h>
+
+/* ---- Macros ---- */
+#define FIBERPOOL 4096      // finished fibers (with their stacks) kept per scheduler
+
+/* ---- Structures ---- */
+struct fiber                // user-space thread with its own small stack
+{
+    void *sp;                       // saved stack pointer while switched out
+    char *stack;                    // mapping: guard region, then the stack
+    size_t map_size;                // size of the mapping
+    void (*fn)(void *);             // body
+    void *arg;
+    int done;                       // 1 once fn has returned
+    int waiting;                    // 1 while parked on an I/O event
+    struct fiber *next;             // link on the ready queue / free pool
+    struct fiber *live_prev;        // link on the scheduler's live list
+    struct fiber *live_next;
+};
+
+struct fiber_sched          // runs the fibers of one thread
+{
+    void *sp;                       // scheduler's stack pointer while a fiber runs
+    struct fiber *current;          // fiber running now (NULL in the scheduler)
+    struct fiber *ready_head;       // fibers waiting for their turn
+    struct fiber *ready_tail;
+    struct fiber *alive;            // fibers not finished (freed with the scheduler)
+    struct fiber *pool;             // finished fibers whose stacks can be reused
+    int npool;
+    size_t stack_size;              // usable stack of each fiber
+    size_t guard_size;              // PROT_NONE region below each stack
+    long live;                      // fibers not finished
+    long peak;                      // most fibers alive at once
+    long created;                   // fibers started
+    long stacks;                    // stacks mapped (the rest were reused)
+    long switches;                  // switches into fibers
+};
+
+/* ---- Function Prototypes ---- */
+void fiber_sched_init(struct fiber_sched *s, size_t stack_size, size_t guard_size);
+void fiber_sched_free(struct fiber_sched *s);
+struct fiber *fiber_create(struct fiber_sched *s, void (*fn)(void *), void *arg);
+void fiber_ready(struct fiber_sched *s, struct fiber *f);
+int fiber_run_ready(struct fiber_sched *s);
+void fiber_park();
+struct fiber *fiber_self();
+void fiber_switch(void **save_sp, void *load_sp);
+
+#endif
@@ -0,0 +1,34 @@
+// hist.h
+#ifndef HIST_H
+#define HIST_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* ---- Macros ---- */
+#define HIST_SUBBITS 3                      // 8 sub-buckets per power of 2 (~12% error)
+#define HIST_SUB (1 << HIST_SUBBITS)
+#define HIST_GROUPS 40                      // covers values up to ~2^40 (ns: ~18 min)
+#define HIST_BUCKETS (HIST_GROUPS * HIST_SUB)
+
+/* ---- Structures ---- */
+struct hist                 // log-linear histogram of nanosecond values
+{
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[HIST_BUCKETS];
+};
+
+/* ---- Function Prototypes ---- */
+void hist_init(struct hist *h);
+void hist_add(struct hist *h, uint64_t v);
+void hist_merge(struct hist *dst, const struct hist *src);
+uint64_t hist_percentile(const struct hist *h, double p);
+uint64_t hist_bucket_low(int b);
+int hist_bucket(uint64_t v);
+void hist_print(FILE *out, const char *title, const struct hist *h, int buckets);
+uint64_t now_ns();
+
+#endif
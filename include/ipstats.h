@@ -0,0 +1,44 @@
+// ipstats.h
+#ifndef IPSTATS_H
+#define IPSTATS_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+/* ---- Macros ---- */
+#define IPSTATS_INITSIZE 1024   // initial table slots (power of 2, grows x2)
+#define IPSTATS_MAXLOAD 75      // % of slots used before the table grows
+
+/* ---- Structures ---- */
+struct ip_entry             // totals of the closed connections of one address
+{
+    uint32_t ip;                    // network order, 0 = unix domain clients
+    uint32_t conns;                 // connections closed (0 = free slot)
+    uint64_t requests;              // requests served
+    uint64_t bytes;                 // bytes echoed back
+    uint64_t dur_ns;                // summed connection durations
+    uint64_t max_ns;                // longest connection
+};
+
+struct ip_table             // open addressed table of addresses, linear probing
+{
+    struct ip_entry *ents;
+    uint32_t cap;                   // slots (power of 2)
+    uint32_t used;                  // addresses tracked
+    int interval;                   // seconds between summaries (0 = at exit only)
+    int done;                       // final summary written, reporter must stop
+    const char *logfile;            // summaries are appended here
+    pthread_mutex_t lock;
+};
+
+/* ---- Function Prototypes ---- */
+int ipstats_init(const char *logfile, int interval);
+int ipstats_hdr(const char *logfile, int interval);
+void ipstats_add(uint32_t ip, uint64_t requests, uint64_t bytes, uint64_t dur_ns);
+void *ipstats_reporter(void *arg);
+int ipstats_write(int final);
+
+/* --- Variables ---- */
+extern struct ip_table ipstats;
+
+#endif
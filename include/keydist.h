@@ -0,0 +1,29 @@
+// keydist.h
+#ifndef KEYDIST_H
+#define KEYDIST_H
+
+#include <stdint.h>
+
+/* ---- Enums ---- */
+enum key_dist               // distribution keys are drawn from
+{
+    DIST_UNIFORM,
+    DIST_ZIPF
+};
+
+/* ---- Structures ---- */
+struct keydist              // key generator shared (read only) by all threads
+{
+    enum key_dist dist;
+    uint64_t nkeys;                 // keys are 0..nkeys-1
+    double theta;                   // zipf skew (0.99 = YCSB default)
+    double alpha, zetan, eta;       // precomputed zipf constants
+};
+
+/* ---- Function Prototypes ---- */
+int keydist_init(struct keydist *kd, enum key_dist dist, uint64_t nkeys, double theta);
+uint64_t keydist_next(const struct keydist *kd, uint64_t *rng);
+uint64_t xorshift64(uint64_t *state);
+double rand_unit(uint64_t *state);
+
+#endif
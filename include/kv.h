@@ -0,0 +1,74 @@
+// kv.h
+#ifndef KV_H
+#define KV_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+/* ---- Macros ---- */
+#define KV_MAXKEY 48        // max key length (bytes)
+#define KV_MAXVAL 200       // max value length (bytes)
+#define KV_SHARDCAP 4096    // initial slots per shard (power of 2, grows x2)
+#define KV_TAG_EMPTY 0      // slot never used
+#define KV_TAG_DEAD 1       // slot deleted (tombstone)
+
+/* ---- Enums ---- */
+enum kv_op                  // request opcode (first byte of a frame)
+{
+    KV_GET = 1,
+    KV_SET = 2,
+    KV_DEL = 3
+};
+
+enum kv_status              // response status
+{
+    KV_OK = 0,
+    KV_NOTFOUND = 1,
+    KV_BADREQ = 2,
+    KV_FULL = 3
+};
+
+/* ---- Structures ---- */
+struct kv_hdr               // header at the start of every PKTSIZE frame
+{
+    uint8_t op;                     // enum kv_op
+    uint8_t status;                 // enum kv_status (responses)
+    uint16_t klen;                  // key bytes following the header
+    uint16_t vlen;                  // value bytes following the key
+    uint16_t pad;
+};
+
+struct kv_entry             // slot payload, looked at only on a tag match
+{
+    uint16_t klen;
+    uint16_t vlen;
+    char key[KV_MAXKEY];
+    char val[KV_MAXVAL];
+};
+
+struct kv_shard             // open addressed table owned by one lock
+{
+    pthread_mutex_t lock;
+    uint32_t *tags;                 // hash tag per slot, probed linearly
+    struct kv_entry *entries;       // entry per slot (parallel to tags)
+    uint32_t cap;                   // slots (power of 2)
+    uint32_t used;                  // live + dead slots
+    uint32_t live;                  // live slots
+} __attribute__((aligned(64)));     // keep shard locks on separate cache lines
+
+struct kv_store             // store made of independently locked shards
+{
+    struct kv_shard *shards;
+    int nshards;
+};
+
+/* ---- Function Prototypes ---- */
+int kv_init(struct kv_store *kv, int nshards);
+void kv_handle(struct kv_store *kv, char *frame, int len);
+int kv_get(struct kv_store *kv, const char *key, int klen, char *val);
+int kv_set(struct kv_store *kv, const char *key, int klen, const char *val, int vlen);
+int kv_del(struct kv_store *kv, const char *key, int klen);
+int kv_encode(char *frame, int op, const char *key, int klen, const char *val, int vlen);
+uint32_t kv_hash(const char *key, int klen);
+
+#endif
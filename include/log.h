@@ -41,7 +41,7 @@ struct clt_log_stats    // hold client logging info
 
 /* ---- Function Prototypes ---- */
 int app_srv_hdr();
-int app_clt_hdr();
+int app_clt_hdr(int secs);
 int append_srv_data(char *filename, struct srv_log_stats stats);
 int append_clt_data(struct clt_log_stats stats, double t);
 int append_total_clients(char *filename, int total);
@@ -51,6 +51,6 @@ void update_bytes_struct(struct Bytes *data, int bytes);
 void print_bytes_struct(struct Bytes data);
 
 /* --- Variables ---- */
-pthread_mutex_t lock;
+extern pthread_mutex_t lock;
 
 #endif
@@ -0,0 +1,20 @@
+// memstat.h
+#ifndef MEMSTAT_H
+#define MEMSTAT_H
+
+#include <stdio.h>
+
+/* ---- Structures ---- */
+struct mem_sample           // process and kernel memory at one point in time (bytes)
+{
+    long rss;                       // resident set of this process
+    long slab;                      // kernel slab (sockets, epoll items, files...)
+    long tcp_mem;                   // memory held in tcp socket buffers
+};
+
+/* ---- Function Prototypes ---- */
+int mem_sample(struct mem_sample *m);
+void mem_report(FILE *out, long conns, const struct mem_sample *base);
+long next_scale_step(long n);
+
+#endif
@@ -0,0 +1,38 @@
+// perthread.h
+#ifndef PERTHREAD_H
+#define PERTHREAD_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+/* ---- Macros ---- */
+#define SLOTS_INITIALIZER {PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, NULL, NULL, 0}
+
+/* ---- Structures ---- */
+struct slot_reg;
+
+struct slot_link            // first member of every registered slot
+{
+    struct slot_link *next;         // list of live slots
+    struct slot_link *prev;
+    struct slot_reg *reg;           // registry the slot belongs to
+    int id;                         // creation order, names the thread
+};
+
+struct slot_reg             // one slot per thread, created on first use
+{
+    pthread_mutex_t lock;           // guards the live list and what retire folds into
+    struct slot_link *live;         // slots of running threads, newest first
+    int nslots;                     // slots ever created (ids)
+    size_t size;                    // size of a slot, slot_link first
+    void (*init)(void *slot);       // sets up a new zeroed slot (may be NULL)
+    void (*retire)(void *slot);     // folds an exiting thread's slot, lock held
+    pthread_key_t key;              // owner of each thread's slot
+};
+
+/* ---- Function Prototypes ---- */
+int slots_init(struct slot_reg *reg, size_t size, void (*init)(void *), void (*retire)(void *));
+void *slots_get(struct slot_reg *reg, void **mine);
+int spawn_helper_thread(pthread_t *thread, void *(*run)(void *));
+
+#endif
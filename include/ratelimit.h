@@ -0,0 +1,43 @@
+// ratelimit.h
+#ifndef RATELIMIT_H
+#define RATELIMIT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/* ---- Macros ---- */
+#define RL_BUCKETS 65536    // table slots (power of 2), 1 MB, ~49k IPs at 75% load
+#define RL_MAXLOAD 75       // % of slots used before new IPs go unlimited
+#define RL_TOP 5            // most throttled IPs listed in the report
+
+/* ---- Structures ---- */
+struct rl_bucket            // token bucket of one client IPv4 address (16 bytes)
+{
+    uint32_t ip;                    // network order, 0 = free slot
+    uint32_t throttled;             // requests deferred for lack of tokens
+    uint64_t state;                 // ms of the last refill << 32 | milli-tokens, one CAS word
+};
+
+struct rl_table             // open addressed table of buckets, linear probing
+{
+    struct rl_bucket *buckets;
+    int used;                       // slots taken
+    int32_t rate;                   // tokens per second (= milli-tokens per ms)
+    int32_t burst;                  // bucket size in milli-tokens
+    long overflow;                  // connections left unlimited, table full
+    int deferrable;                 // 1 if the event loop can hold requests back
+    pthread_mutex_t lock;           // guards slot creation, not the buckets
+};
+
+/* ---- Function Prototypes ---- */
+int rl_init(int rate, int burst);
+struct rl_bucket *rl_lookup(uint32_t ip);
+int rl_wait(struct rl_bucket *b, int held);
+void rl_set_deferrable();
+void rl_report(FILE *out);
+
+/* --- Variables ---- */
+extern struct rl_table rl;
+
+#endif
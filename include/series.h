@@ -0,0 +1,51 @@
+// series.h
+#ifndef SERIES_H
+#define SERIES_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "hist.h"
+#include "perthread.h"
+
+/* ---- Macros ---- */
+#define DEFINTERVAL 1000    // default ms between time-series snapshots
+#define SERIES_NAP 100      // ms the reporter sleeps between checks for stop
+
+/* ---- Structures ---- */
+struct series_slot          // counters of one thread, written by it alone
+{
+    struct slot_link link;          // registry list and creation order (first member)
+    uint64_t requests;
+    uint64_t bytes;
+    uint64_t lat_count;             // latencies recorded
+    uint64_t lat[HIST_BUCKETS];     // latency buckets (see hist.h)
+    uint64_t loops;                 // event loop wake ups (series_loop)
+    uint64_t events;                // events those wake ups returned
+} __attribute__((aligned(64)));
+
+struct series               // time-series writer shared by server and client
+{
+    int on;                         // 1 once series_init() succeeded
+    int keep;                       // 1 while slots are kept (series or stats page)
+    int stop;                       // set by series_stop()
+    int json;                       // 1 for JSON lines, 0 for CSV
+    int interval_ms;                // snapshot period
+    int *active;                    // open connections, read each snapshot
+    FILE *out;
+    uint64_t t0;                    // start of the series
+    pthread_t thread;               // reporter
+};
+
+/* ---- Function Prototypes ---- */
+int series_init(const char *path, int interval_ms, int *active);
+int series_keep();
+void series_add(uint64_t bytes, uint64_t lat_ns);
+void series_loop(int events);
+int series_collect(struct series_slot *total, struct series_slot *threads, int max);
+void series_stop();
+
+/* --- Variables ---- */
+extern struct series series;
+
+#endif
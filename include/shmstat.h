@@ -0,0 +1,76 @@
+// shmstat.h
+#ifndef SHMSTAT_H
+#define SHMSTAT_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "hist.h"
+
+/* ---- Macros ---- */
+#define SHMSTAT_NAME "/srv_%d"      // shm_open name, i.e. /dev/shm/srv_<pid>
+#define SHMSTAT_DIR "/dev/shm"
+#define SHMSTAT_PREFIX "srv_"
+#define SHMSTAT_MAGIC 0x53525653u   // "SRVS"
+#define SHMSTAT_VERSION 1           // bump on any layout change
+#define SHMSTAT_THREADS 64          // threads listed individually
+#define SHMSTAT_PERIOD 100          // ms between updates of the page
+#define SHMSTAT_NAMESIZE 32
+
+/* ---- Structures ---- */
+struct shmstat_thread       // counters of one server thread
+{
+    int32_t id;                     // creation order of the thread's slot
+    int32_t pad;
+    uint64_t requests;
+    uint64_t bytes;
+    uint64_t loops;                 // event loop wake ups (0 for blocking backends)
+    uint64_t events;                // events returned by those wake ups
+};
+
+struct shmstat_data         // everything the seqlock protects
+{
+    uint64_t t_update;              // time of this update (CLOCK_MONOTONIC ns)
+    uint64_t updates;               // updates published so far
+    int64_t live;                   // connections open
+    int64_t total;                  // connections accepted
+    uint64_t requests;
+    uint64_t bytes;
+    uint64_t loops;
+    uint64_t events;
+    uint64_t lat_count;             // sampled request latencies
+    uint64_t lat[HIST_BUCKETS];     // their buckets (see hist.h)
+    int32_t nthreads;               // threads with counters
+    int32_t shown;                  // of which listed in 'thread'
+    struct shmstat_thread thread[SHMSTAT_THREADS];
+};
+
+struct shmstat_page         // layout of /dev/shm/srv_<pid>
+{
+    uint32_t magic;                 // SHMSTAT_MAGIC
+    uint32_t version;               // SHMSTAT_VERSION
+    uint32_t size;                  // sizeof(struct shmstat_page)
+    int32_t pid;                    // server process
+    uint64_t t_start;               // server start (CLOCK_MONOTONIC ns)
+    char backend[SHMSTAT_NAMESIZE]; // I/O model
+    uint64_t seq;                   // seqlock: odd while 'data' is being written
+    struct shmstat_data data;
+};
+
+struct shmstat              // publisher state (server side)
+{
+    int on;                         // 1 once shmstat_init() succeeded
+    int stop;                       // set by shmstat_stop()
+    char name[SHMSTAT_NAMESIZE];    // shm_open name
+    struct shmstat_page *page;
+    int *live, *total;              // connection counters to sample
+    pthread_t thread;               // publisher
+};
+
+/* ---- Function Prototypes ---- */
+int shmstat_init(const char *backend, int *live, int *total);
+void shmstat_stop();
+
+/* --- Variables ---- */
+extern struct shmstat shmstat;
+
+#endif
@@ -1,16 +1,41 @@
 //socket.h
 #include <netinet/in.h>
+#include <sys/un.h>
 
 #ifndef SOCKET_H
 #define SOCKET_H
 
+/* ---- Structures ---- */
+struct sock_profile         // named set of socket options (see profiles in socket.c)
+{
+    const char *name;
+    const char *desc;
+    int nodelay;                    // TCP_NODELAY: disable Nagle
+    int quickack;                   // TCP_QUICKACK: ack at once, re-armed after every read
+    int sndbuf;                     // SO_SNDBUF bytes (0 = kernel autotuning)
+    int rcvbuf;                     // SO_RCVBUF bytes (0 = kernel autotuning)
+    int defer_accept;               // TCP_DEFER_ACCEPT seconds, listener only (0 = off)
+    int fastopen;                   // TCP_FASTOPEN queue on listeners, fast open connects (0 = off)
+    int notsent_lowat;              // TCP_NOTSENT_LOWAT bytes (0 = kernel default)
+};
+
 /* ---- Functions Prototypes ---- */
 int create_socket(int *sd, int domain, int type, int protocol);
 int bind_socket(int sd, const struct sockaddr *addr, socklen_t len);
 int listen_socket(int sd, int backlog);
 int connect_socket(int sd, const struct sockaddr *addr, socklen_t len);
+int connect_socket_timeout(int sd, const struct sockaddr *addr, socklen_t len, int ms);
 int set_nonblocking(int *sd);
 int set_blocking(int *sd);
+int set_reuseaddr(int sd);
+int set_linger(int sd, int secs);
+const struct sock_profile *find_profile(const char *name);
+const struct sock_profile *profile_at(int i);
+int apply_listen_profile(int sd, const struct sock_profile *p);
+int apply_conn_profile(int sd, const struct sock_profile *p, int client);
+void rearm_quickack(int sd, const struct sock_profile *p);
 void fill_addr(struct sockaddr_in *addr, int domain, unsigned short port, unsigned long ip);
+int fill_unix_addr(struct sockaddr_un *addr, const char *path);
+long raise_fd_limit();
 
 #endif
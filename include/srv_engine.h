@@ -0,0 +1,155 @@
+// srv_engine.h
+#ifndef SRV_ENGINE_H
+#define SRV_ENGINE_H
+
+#include <netinet/in.h>
+#include <signal.h>
+#include "log.h"
+#include "socket.h"
+#include "work.h"
+#include "kv.h"
+#include "srv_timing.h"
+#include "trace.h"
+#include "admit.h"
+#include "ratelimit.h"
+#include "ipstats.h"
+#include "series.h"
+#include "shmstat.h"
+
+/* ---- Macros ---- */
+#define SRVLOGFMT "../data/srv_%s_log"
+#define TRACEFMT "../data/srv_%s_trace.json"
+#define LOGNAMESIZE 64
+#define BACKLOG 100
+#define SCALEBACKLOG 65535  // listen backlog in scale mode (capped by somaxconn)
+#define PKTSIZE 1000        // must be same on client side
+#define IDLETIMEOUT 6000    // ms without events before event loops terminate
+#define DEFTHREADS 8        // default worker count for pooled backends
+
+#define DISPATCH_RR 0       // hand new connections to workers round-robin
+#define DISPATCH_LL 1       // hand new connections to least loaded worker
+
+#define MAXLISTEN 3         // tcp + unix stream + unix seqpacket
+#define LISTEN_TCP 0        // AF_INET SOCK_STREAM
+#define LISTEN_UNIX 1       // AF_UNIX SOCK_STREAM
+#define LISTEN_SEQPACKET 2  // AF_UNIX SOCK_SEQPACKET
+
+#define HANDLER_ECHO 0      // echo every request back
+#define HANDLER_KV 1        // run requests against the key-value store
+
+/* ---- Enums ---- */
+enum conn_status            // result of servicing a connection
+{
+    CONN_AGAIN,                     // socket drained, wait for next event
+    CONN_CLOSED,                    // client disconnected
+    CONN_ERROR,                     // socket error, connection must be closed
+    CONN_DEFER,                     // rate limited, service again after defer_ms
+    CONN_WRITE                      // response tail pending, service again once writable
+};
+
+/* ---- Structures ---- */
+struct srv_listener         // one listening endpoint
+{
+    int sd;                         // socket to listen for new connections
+    int kind;                       // LISTEN_TCP, LISTEN_UNIX or LISTEN_SEQPACKET
+    const char *path;               // socket file (unix listeners)
+};
+
+struct srv_nw_var           // server network variables
+{
+    struct srv_listener listen[MAXLISTEN];  // tcp listener first, then unix ones
+    int nlisten;                    // listeners in use
+    struct sockaddr_in srv_addr;    // addr of server
+    int port;                       // port to bind to
+    const char *unix_path;          // unix stream socket file (NULL = none)
+    const char *seq_path;           // unix seqpacket socket file (NULL = none)
+};
+
+struct srv_config;
+
+struct srv_backend          // I/O model that drives connections through the core
+{
+    const char *name;               // name used to select backend (-b)
+    const char *desc;               // one line description for usage
+    int nonblocking;                // 1 if client sockets are non-blocking
+    int listen_nonblocking;         // 1 if the listeners are too (0 = blocking acceptor)
+    int (*run)(struct srv_nw_var *nw, struct srv_config *cfg);
+};
+
+struct srv_config           // runtime options shared by every backend
+{
+    const struct srv_backend *backend;  // selected I/O model
+    int threads;                        // worker threads (pooled backends)
+    int dispatch;                       // DISPATCH_RR or DISPATCH_LL
+    int shard_max;                      // max connections per shard (0 = no max)
+    struct work_cfg work;               // synthetic work done per request
+    int handler;                        // HANDLER_ECHO or HANDLER_KV
+    int kv_shards;                      // key-value store shards
+    int sample;                         // time 1 in N requests (0 = off)
+    const struct sock_profile *profile; // socket options of listener and clients
+    int scale;                          // 1 for many mostly idle connections
+    int idle_timeout;                   // ms without events before event loops end (-1 = never)
+    int stack_kb;                       // connection thread stack (thread backend)
+    int guard_kb;                       // guard region below each thread stack
+    int thread_cache;                   // idle threads kept for reuse (thread backend)
+    int steal;                          // 1 to let idle workers steal (steal backend)
+    int max_conns;                      // admission: open connection limit (0 = none)
+    long max_lag_us;                    // admission: event loop lag limit (0 = none)
+    int reject;                         // admission: REJECT_CLOSE or REJECT_PAUSE
+    int rate;                           // requests/sec per client address (0 = no limit)
+    int burst;                          // requests a client address may send back to back
+    int aggregate;                      // secs between per-address summaries (-1 = log each connection)
+    const char *series;                 // time series file (NULL = none)
+    int interval_ms;                    // time series period
+    char logfile[LOGNAMESIZE];          // server log file
+    int trace;                          // 1 to record an event trace
+    char tracefile[LOGNAMESIZE];        // Chrome trace written on SIGUSR1 / exit
+};
+
+struct srv_conn             // per connection state shared by every backend
+{
+    int sd;                         // client socket
+    int rlen;                       // bytes of current request received
+    uint32_t peer;                  // client IPv4 address (network order, 0 = unix)
+    uint64_t t_accept;              // when the connection was accepted (now_ns clock)
+    uint64_t t_ready;               // start of a sampled request (0 = not sampled)
+    struct srv_conn *next;          // link while queued between threads or listed
+    struct srv_conn *prev;          // link in a backend's list of open connections
+    void *owner;                    // backend data, e.g. the worker whose epoll holds it
+    char *buff;                     // partial request parked between events (else NULL)
+    struct rl_bucket *rl;           // token bucket of the client address (NULL = unlimited)
+    int defer_ms;                   // last wait of a held back request (0 = not held)
+    char *out;                      // unsent tail of the last response (else NULL)
+    int olen;                       // bytes left in 'out'
+    int wait_out;                   // backend use: 1 while armed for writability
+    struct srv_log_stats stats;     // logging info of connection
+};
+
+/* ---- Function Prototypes ---- */
+int run_srv(struct srv_nw_var *nw, struct srv_config *cfg);
+int setup_srv(struct srv_nw_var *nw, int nonblocking);
+int set_SIGINT();
+void block_SIGINT();
+void set_io_wait(int (*wait)(int sd, short events));
+int setup_unix(struct srv_nw_var *nw, const char *path, int kind, int nonblocking);
+int srv_accept(int sd_listen, int nonblocking, struct srv_conn **conn);
+int srv_accept_any(struct srv_nw_var *nw, int nonblocking, struct srv_conn **conn);
+struct srv_listener *find_listener(struct srv_nw_var *nw, void *ptr);
+void close_listeners(struct srv_nw_var *nw);
+int conn_service(struct srv_conn *conn);
+int conn_park(struct srv_conn *conn);
+int conn_request(struct srv_conn *conn, char *buff);
+int send_all(int sd, const char *buff, int len);
+int conn_flush(struct srv_conn *conn);
+void conn_close(struct srv_conn *conn);
+void conn_link(struct srv_conn **head, struct srv_conn *conn);
+void conn_unlink(struct srv_conn **head, struct srv_conn *conn);
+void report_both(const char *logfile, void (*report)(FILE *out));
+void close_fd();
+
+/* --- Variables ---- */
+extern volatile sig_atomic_t srv_stop;
+extern int total_clts;
+extern int live_clts;
+
+#endif
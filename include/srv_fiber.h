@@ -0,0 +1,37 @@
+// srv_fiber.h
+#ifndef SRV_FIBER_H
+#define SRV_FIBER_H
+
+#include <pthread.h>
+#include "srv_engine.h"
+#include "fiber.h"
+#include "workers.h"
+
+/* ---- Macros ---- */
+#define FIBEREVENTS 256     // events taken per epoll_wait
+
+/* ---- Structures ---- */
+struct fiber_worker         // thread running one fiber scheduler over its own epoll
+{
+    int id;                         // worker number (0 runs on the main thread)
+    int esd;                        // epoll instance
+    struct srv_nw_var *nw;
+    struct srv_config *cfg;
+    struct fiber_sched sched;
+    long waits;                     // times a fiber parked on EAGAIN
+    struct srv_workers *group;      // stop flag and idle clocks shared with the others
+    struct srv_conn *conns;         // connections of its fibers, closed at stop
+    pthread_t thread;
+};
+
+/* ---- Function Prototypes ---- */
+int run_fiber(struct srv_nw_var *nw, struct srv_config *cfg);
+void *fiber_loop(void *args);
+int fiber_wait(int sd, short events);
+void fiber_echo_loop(void *args);
+void report_fibers(struct fiber_worker *workers, int n);
+
+/* --- Variables ---- */
+extern const struct srv_backend fiber_backend;
+
+#endif
@@ -2,39 +2,30 @@
 #ifndef SRV_POLL_H
 #define SRV_POLL_H
 
-#include <netinet/in.h>
+#include <poll.h>
+#include "srv_engine.h"
 
 /* ---- Macros ---- */
-#define SRVLOGFILE "../data/srv_poll_log"
-#define ARGSNUM 2
-#define ARG_PORT 1
-#define BACKLOG 100
-#define PKTSIZE 1000        // must be same on client side
-#define STRINGSIZE 16
-#define ARRSIZE 1000
-#define MAXCLIENTS 15000
+#define POLLINITSIZE 1024   // initial capacity of the poll array (grows x2)
 
 /* ---- Structures ---- */
-struct srv_nw_var           // server network variables
+struct poll_set             // densely packed poll array
 {
-    int sd_listen;                  // socket to listen for new connections
-    struct sockaddr_in srv_addr;    // addr of server
-    int port;                       // port to bind to
-};
-
-struct thread_args          // arguments to pass into threaded function
-{
-    int sd;
-    char clt_ip[STRINGSIZE];
+    struct pollfd *fds;             // fds handed to poll (no -1 holes)
+    struct srv_conn **conns;        // conns[i] is the connection of fds[i]
+    int size;                       // entries in use
+    int cap;                        // entries allocated
 };
 
 /* ---- Function Prototypes ---- */
-int valid_args(int arg, char *port);
-int run_srv(struct srv_nw_var *nw);
-int setup_srv(struct srv_nw_var *nw);
-int run_poll_loop(struct srv_nw_var nw);
-int set_SIGINT();
-void *echo_loop(void *args);
-void close_fd();
+int run_poll_loop(struct srv_nw_var *nw, struct srv_config *cfg);
+int pollset_init(struct poll_set *set, int cap);
+int pollset_add(struct poll_set *set, int fd, struct srv_conn *conn);
+void pollset_remove(struct poll_set *set, int i);
+void pollset_free(struct poll_set *set);
+void poll_listen(struct poll_set *set, struct srv_nw_var *nw, int on);
+
+/* --- Variables ---- */
+extern const struct srv_backend poll_backend;
 
 #endif
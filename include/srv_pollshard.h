@@ -0,0 +1,33 @@
+// srv_pollshard.h
+#ifndef SRV_POLLSHARD_H
+#define SRV_POLLSHARD_H
+
+#include <pthread.h>
+#include "srv_engine.h"
+#include "srv_poll.h"
+
+/* ---- Structures ---- */
+struct poll_shard           // poll worker thread and the connections it owns
+{
+    int id;                         // shard number
+    int efd;                        // eventfd the acceptor signals
+    int nconns;                     // connections owned (read by acceptor)
+    int stop;                       // set by the acceptor when the server stops
+    struct poll_set set;            // entry 0 is efd, rest are clients
+    struct srv_conn *inbox;         // connections handed over, not yet added
+    pthread_mutex_t lock;           // protects inbox
+    pthread_t thread;
+};
+
+/* ---- Function Prototypes ---- */
+int run_pollshard(struct srv_nw_var *nw, struct srv_config *cfg);
+int pick_shard(struct poll_shard *shards, int n, struct srv_config *cfg);
+int hand_off(struct poll_shard *shard, struct srv_conn *conn);
+void stop_shards(struct poll_shard *shards, int n);
+void *shard_loop(void *args);
+void drain_inbox(struct poll_shard *shard);
+
+/* --- Variables ---- */
+extern const struct srv_backend pollshard_backend;
+
+#endif
@@ -0,0 +1,33 @@
+// srv_pool.h
+#ifndef SRV_POOL_H
+#define SRV_POOL_H
+
+#include <pthread.h>
+#include "srv_engine.h"
+
+/* ---- Macros ---- */
+#define QUEUESIZE 1024      // accepted connections waiting for a worker
+#define POOLRECHECK 100     // ms the acceptor waits on a full queue between stop checks
+
+/* ---- Structures ---- */
+struct conn_queue           // bounded queue between acceptor and workers
+{
+    struct srv_conn *conns[QUEUESIZE];
+    int head;                       // next connection to hand out
+    int count;                      // connections waiting
+    struct srv_conn **busy;         // busy[i] is the connection worker i serves
+    int quit;                       // set when the server stops
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+};
+
+/* ---- Function Prototypes ---- */
+int run_pool(struct srv_nw_var *nw, struct srv_config *cfg);
+void pool_stop(pthread_t *threads, int n);
+void *pool_worker(void *args);
+
+/* --- Variables ---- */
+extern const struct srv_backend pool_backend;
+
+#endif
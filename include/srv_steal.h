@@ -0,0 +1,50 @@
+// srv_steal.h
+#ifndef SRV_STEAL_H
+#define SRV_STEAL_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "srv_engine.h"
+#include "deque.h"
+#include "workers.h"
+
+/* ---- Macros ---- */
+#define STEALEVENTS 64      // events moved into the deque per epoll_wait
+#define STEALWAIT 1         // ms an idle worker sleeps before trying to steal again
+
+/* ---- Structures ---- */
+struct steal_worker         // M:N worker: own epoll, own deque of ready connections
+{
+    struct ws_deque deque;          // ready connections (first, it is cache line aligned)
+    int id;                         // worker number (0 runs on the main thread)
+    int esd;                        // epoll instance of the connections it owns
+    int nworkers;
+    struct steal_worker *all;       // every worker (steal victims)
+    struct srv_workers *group;      // stop flag and idle clocks shared with the others
+    struct srv_nw_var *nw;
+    struct srv_config *cfg;
+    uint64_t rng;                   // victim selection
+    long runs;                      // connections serviced
+    long stolen;                    // of those, stolen from another worker
+    long attempts;                  // steal attempts
+    uint64_t busy_ns;               // time spent servicing connections
+    uint64_t start_ns;
+    struct srv_conn *conns;         // connections homed here, closed at stop
+    pthread_mutex_t lock;           // protects conns (thieves close connections too)
+    pthread_t thread;
+};
+
+/* ---- Function Prototypes ---- */
+int run_steal(struct srv_nw_var *nw, struct srv_config *cfg);
+void *steal_loop(void *args);
+int steal_poll(struct steal_worker *w, int timeout);
+struct srv_conn *steal_from(struct steal_worker *w);
+void steal_run(struct steal_worker *w, struct srv_conn *conn);
+void steal_close(struct srv_conn *conn);
+int steal_arm(struct steal_worker *home, struct srv_conn *conn, int op);
+void report_steal(struct steal_worker *workers, int n);
+
+/* --- Variables ---- */
+extern const struct srv_backend steal_backend;
+
+#endif
@@ -2,39 +2,50 @@
 #ifndef SRV_THREAD_H
 #define SRV_THREAD_H
 
-#include <netinet/in.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "srv_engine.h"
 
 /* ---- Macros ---- */
-#define SRVLOGFILE "../data/srv_thread_log"
-#define ARGSNUM 2
-#define ARG_PORT 1
-#define BACKLOG 100
-#define PKTSIZE 1000        // must be same on client side
-#define STRINGSIZE 16
-#define ARRSIZE 1000
-#define THREADS 10000
+#define DEFSTACK 64         // default thread stack (KB)
+#define DEFGUARD 4          // default guard region below each stack (KB)
+#define DEFTHREADCACHE 64   // default idle threads kept for reuse
 
 /* ---- Structures ---- */
-struct srv_nw_var           // server network variables
+struct cache_thread         // a connection thread, on its own stack
 {
-    int sd_listen;                  // socket to listen for new connections
-    struct sockaddr_in srv_addr;    // addr of server
-    int port;                       // port to bind to
+    struct srv_conn *conn;          // connection it serves (NULL while parked)
+    struct cache_thread *prev;
+    struct cache_thread *next;
 };
 
-struct thread_args          // arguments to pass into threaded function
+struct thread_cache         // idle connection threads waiting to be reused
 {
-    int sd;
-    char clt_ip[STRINGSIZE];
+    struct srv_conn *head;          // connections handed to parked threads
+    int idle;                       // parked threads not yet handed a connection
+    pthread_mutex_t lock;
+    pthread_cond_t handoff;
+    struct cache_thread *threads;   // every connection thread
+    int quit;                       // set when the server stops
+    pthread_cond_t gone;            // a thread exited (cache_stop waits on live)
+    long created;                   // threads created
+    long reused;                    // connections given to a parked thread
+    int live;                       // threads alive (serving or parked)
+    int peak;                       // most threads alive at once
+    uint64_t create_ns;             // time spent in pthread_create
 };
 
 /* ---- Function Prototypes ---- */
-int valid_args(int arg, char *port);
-int run_srv(struct srv_nw_var *nw);
-int setup_srv(struct srv_nw_var *nw);
-int run_accept_loop(struct srv_nw_var nw);
-int set_SIGINT();
+int run_accept_loop(struct srv_nw_var *nw, struct srv_config *cfg);
+int thread_attr_init(pthread_attr_t *attr, const struct srv_config *cfg);
+int cache_handoff(struct srv_conn *conn);
+void cache_enter(struct cache_thread *self);
+struct srv_conn *cache_park(struct cache_thread *self, int max);
+void cache_stop();
+void report_threads(const struct srv_config *cfg, uint64_t elapsed_ns, long base_rss, long peak_rss);
 void *echo_loop(void *args);
-void close_fd();
+
+/* --- Variables ---- */
+extern const struct srv_backend thread_backend;
 
 #endif
@@ -0,0 +1,39 @@
+// srv_timing.h
+#ifndef SRV_TIMING_H
+#define SRV_TIMING_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "hist.h"
+#include "perthread.h"
+
+/* ---- Macros ---- */
+#define DEFSAMPLE 64        // time 1 in DEFSAMPLE requests (0 = off)
+
+/* ---- Enums ---- */
+enum timing_stage           // stages of a request, each measured from the last
+{
+    STAGE_RECV,                     // dequeued by the backend -> frame received
+    STAGE_HANDLER,                  // frame received -> work and handler done
+    STAGE_SEND,                     // handler done -> response sent
+    STAGE_TOTAL,                    // dequeued -> response sent
+    STAGE_COUNT
+};
+
+/* ---- Structures ---- */
+struct timing_slot          // histograms of one server thread
+{
+    struct slot_link link;          // registry list (first member)
+    pthread_mutex_t lock;           // taken on sampled requests and on merge
+    struct hist stage[STAGE_COUNT];
+};
+
+/* ---- Function Prototypes ---- */
+int timing_init(int sample);
+int timing_sample();
+void timing_record(uint64_t t_ready, uint64_t t_recv, uint64_t t_handler, uint64_t t_send);
+void timing_merge(struct hist *stage);
+void timing_report(FILE *out);
+
+#endif
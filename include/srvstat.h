@@ -0,0 +1,21 @@
+// srvstat.h
+#ifndef SRVSTAT_H
+#define SRVSTAT_H
+
+#include "shmstat.h"
+
+/* ---- Macros ---- */
+#define DEFREFRESH 1000     // default ms between screens
+#define READ_TRIES 1000     // seqlock retries before a read gives up
+#define MAXSERVERS 16       // running servers listed when no pid is given
+
+/* ---- Function Prototypes ---- */
+int find_server();
+const struct shmstat_page *map_page(int pid);
+int read_page(const struct shmstat_page *page, struct shmstat_data *data);
+int page_exists(int pid);
+void render(const struct shmstat_page *page, const struct shmstat_data *cur,
+            const struct shmstat_data *prev);
+void print_usage();
+
+#endif
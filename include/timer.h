@@ -0,0 +1,31 @@
+// timer.h
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+/* ---- Macros ---- */
+#define TIMERINITSIZE 256   // initial heap capacity (grows x2)
+
+/* ---- Structures ---- */
+struct timer_ent            // one pending timer
+{
+    uint64_t when;                  // expiry (now_ns clock)
+    void *ptr;                      // what expires (e.g. a deferred connection)
+};
+
+struct timer_heap           // binary min-heap of timers owned by one loop
+{
+    struct timer_ent *ents;
+    int size;
+    int cap;
+};
+
+/* ---- Function Prototypes ---- */
+int timer_init(struct timer_heap *h);
+int timer_add(struct timer_heap *h, uint64_t when, void *ptr);
+void *timer_pop_due(struct timer_heap *h, uint64_t now);
+int timer_timeout(struct timer_heap *h, uint64_t now, int timeout);
+void timer_free(struct timer_heap *h);
+
+#endif
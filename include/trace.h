@@ -0,0 +1,53 @@
+// trace.h
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/* ---- Macros ---- */
+#define TRACE_RING 16384        // events per thread ring (power of 2)
+#define TRACE_MAXRINGS 1024     // rings ever allocated, threads beyond go untraced
+
+// record an event only when tracing was enabled (one load and branch otherwise)
+#define TRACE(type, arg) do { if(trace_on) trace_event((type), (arg)); } while(0)
+
+/* ---- Enums ---- */
+enum trace_type             // kinds of events, see trace_names in trace.c
+{
+    TR_WAIT,                        // event loop goes to sleep (begin)
+    TR_WAKE,                        // event loop woke up, arg = ready events (end)
+    TR_ACCEPT,                      // connection accepted, arg = socket
+    TR_RECV,                        // data read, arg = bytes
+    TR_SEND,                        // response sent, arg = bytes
+    TR_CLOSE,                       // connection closed, arg = socket
+    TR_LOG_BEGIN,                   // log file write started
+    TR_LOG_END,                     // log file write finished
+    TR_TYPES
+};
+
+/* ---- Structures ---- */
+struct trace_event          // one compact event (16 bytes)
+{
+    uint64_t ts;                    // monotonic time (ns)
+    uint32_t arg;                   // event argument
+    uint16_t type;                  // enum trace_type
+    uint16_t tid;                   // small id of the recording thread
+};
+
+struct trace_ring           // single writer ring of one thread
+{
+    uint64_t head;                  // events ever written (next slot = head % TRACE_RING)
+    struct trace_ring *next;        // list of every ring (for dumps)
+    struct trace_ring *free_next;   // list of rings of exited threads
+    struct trace_event ev[TRACE_RING];
+};
+
+/* ---- Function Prototypes ---- */
+int trace_init(const char *path);
+void trace_event(int type, uint32_t arg);
+int trace_dump(const char *path);
+
+/* --- Variables ---- */
+extern int trace_on;
+
+#endif
@@ -0,0 +1,32 @@
+// verify.h
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <stdint.h>
+
+/* ---- Macros ---- */
+#define VERIFY_MAGIC 0x56524659     // "VRFY"
+#define VERIFY_OK 0                 // echo intact and in order
+#define VERIFY_CORRUPT 1            // checksum does not match the bytes
+#define VERIFY_MISORDERED 2         // intact frame, but not the one just sent
+
+/* ---- Structures ---- */
+struct verify_hdr           // start of every integrity mode frame
+{
+    uint32_t magic;
+    uint32_t crc;                   // CRC32C of everything after this field
+    uint64_t seq;                   // request number within the stream
+    uint64_t stream;                // client that sent it
+};
+
+/* ---- Function Prototypes ---- */
+void verify_init();
+const char *verify_impl();
+uint32_t crc32c(const void *buff, int len);
+uint32_t crc32c_sw(const void *buff, int len);
+uint32_t crc32c_hw(const void *buff, int len);
+void verify_fill(char *frame, int len, uint64_t stream, uint64_t seq);
+int verify_check(const char *frame, int len, uint64_t stream, uint64_t seq);
+int verify_first_diff(const char *frame, int len, uint64_t stream, uint64_t seq);
+
+#endif
@@ -0,0 +1,31 @@
+// work.h
+#ifndef WORK_H
+#define WORK_H
+
+#include <stddef.h>
+
+/* ---- Enums ---- */
+enum work_model             // synthetic per-request work done by the handler
+{
+    WORK_NONE,                      // pure echo
+    WORK_SPIN,                      // busy loop for 'arg' nanoseconds
+    WORK_TOUCH,                     // touch a working set of 'arg' bytes
+    WORK_HASH,                      // checksum the payload
+    WORK_BLOCK                      // sleep 'arg' milliseconds (blocking call)
+};
+
+/* ---- Structures ---- */
+struct work_cfg             // selected work model and its parameter
+{
+    enum work_model model;
+    long arg;                       // ns, bytes or ms depending on model
+};
+
+/* ---- Function Prototypes ---- */
+int parse_work(const char *spec, struct work_cfg *work);
+unsigned int do_work(const struct work_cfg *work, const char *buff, int len);
+void spin_ns(long ns);
+unsigned int touch_set(size_t bytes);
+unsigned int hash_buff(const char *buff, int len);
+
+#endif
@@ -0,0 +1,35 @@
+// workers.h
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "srv_engine.h"
+
+/* ---- Structures ---- */
+struct worker_clock         // last event of one worker, on its own cache line
+{
+    uint64_t ns;
+} __attribute__((aligned(64)));
+
+struct srv_workers          // event loop workers sharing the listeners (0 runs on the caller)
+{
+    int n;                          // workers
+    int started;                    // worker threads 1..started-1 are running
+    int qfd;                        // stop eventfd, in every worker's epoll
+    int quit;                       // set once the workers must stop
+    pthread_t *threads;             // threads[i] runs worker i (i > 0)
+    struct worker_clock *last;      // last[i] is when worker i last had an event
+};
+
+/* ---- Function Prototypes ---- */
+int workers_init(struct srv_workers *ws, int n);
+int workers_epoll(struct srv_workers *ws, struct srv_nw_var *nw);
+int workers_start(struct srv_workers *ws, void *(*loop)(void *), void *workers, size_t size);
+int workers_stopping(struct srv_workers *ws);
+void workers_busy(struct srv_workers *ws, int id);
+int workers_idle(struct srv_workers *ws, int timeout);
+int workers_stop(struct srv_workers *ws);
+
+#endif
@@ -0,0 +1,397 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     adapt.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that limits how many requests the client has in flight
+|               (--adaptive aimd|gradient). <NUM OF CLIENTS> becomes the
+|               ceiling: every client thread connects, but before each request
+|               it takes a slot and threads beyond the limit wait, connection
+|               open, for one to free up. The limit follows the round trip
+|               times the clients measure, against a baseline that is the
+|               lowest RTT seen over the last ADAPT_REBASE seconds:
+|
+|                   aimd     : +1/limit per request under the tolerance
+|                              (about +1 per round trip), x ADAPT_BACKOFF at
+|                              most once per round trip above it.
+|                   gradient : once per window of 'limit' requests the limit
+|                              is scaled by tolerance x baseline / mean RTT
+|                              (kept within 0.5-1) and grows by sqrt(limit)
+|                              of headroom, smoothed.
+|
+|               Either way the client settles where more concurrency only
+|               adds queueing, which is the server's capacity. By Little's
+|               law the requests in flight L, round trip W and throughput X
+|               of that point satisfy L = X * W; the report prints both sides
+|               so it can be checked against what was measured.
+------------------------------------------------------------------------------*/
+#include "../include/adapt.h"
+#include "../include/hist.h"
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+/* --- Global ---- */
+struct adapt_ctl adapt;
+
+static void adapt_tick(uint64_t now);
+static void adapt_update(uint64_t now, uint64_t rtt);
+static void adapt_progress(uint64_t now);
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int parse_adapt(const char *name)
+|                   *name : algorithm name
+|
+|   RETURN:     ADAPT_AIMD or ADAPT_GRADIENT, 0 if unknown
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Maps the --adaptive argument to an algorithm.
+------------------------------------------------------------------------------*/
+int parse_adapt(const char *name)
+{
+    if(strcmp(name, "aimd") == 0)
+        return ADAPT_AIMD;
+    if(strcmp(name, "gradient") == 0)
+        return ADAPT_GRADIENT;
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   const char *adapt_name(int algo)
+|                   algo : ADAPT_AIMD or ADAPT_GRADIENT
+|
+|   RETURN:     name of the algorithm
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Inverse of parse_adapt(), for reports.
+------------------------------------------------------------------------------*/
+const char *adapt_name(int algo)
+{
+    return algo == ADAPT_AIMD ? "aimd" : "gradient";
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void adapt_init(int algo, int max, int interval_ms)
+|                   algo        : ADAPT_AIMD or ADAPT_GRADIENT
+|                   max         : ceiling of the limit (client threads)
+|                   interval_ms : ms between progress lines
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Starts with one request in flight and no baseline. The slot
+|               condition waits on the monotonic clock, the one RTTs and the
+|               run's phases are measured with.
+------------------------------------------------------------------------------*/
+void adapt_init(int algo, int max, int interval_ms)
+{
+    pthread_condattr_t _attr;
+
+    memset(&adapt, 0, sizeof(adapt));
+    pthread_mutex_init(&adapt.lock, NULL);
+    pthread_condattr_init(&_attr);
+    pthread_condattr_setclock(&_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&adapt.slot, &_attr);
+    pthread_condattr_destroy(&_attr);
+
+    adapt.algo = algo;
+    adapt.max = max;
+    adapt.limit = 1;
+    adapt.base_rtt = UINT64_MAX;
+    adapt.next_base = UINT64_MAX;
+    adapt.interval_ns = interval_ms * 1000000ull;
+    adapt.measure_end = UINT64_MAX;
+    adapt.t_change = now_ns();
+    adapt.rebase_at = adapt.t_change + ADAPT_REBASE * 1000000000ull;
+    adapt.next_report = adapt.t_change + adapt.interval_ns;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void adapt_window(uint64_t start, uint64_t end)
+|                   start : start of the measurement window (now_ns clock)
+|                   end   : end of the measurement window
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Only the window counts towards the final report, the same as
+|               for the other results.
+------------------------------------------------------------------------------*/
+void adapt_window(uint64_t start, uint64_t end)
+{
+    pthread_mutex_lock(&adapt.lock);
+    adapt_tick(now_ns());
+    adapt.measure_start = start;
+    adapt.measure_end = end;
+    pthread_mutex_unlock(&adapt.lock);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int adapt_acquire(uint64_t deadline)
+|                   deadline : give up waiting at this time (now_ns clock)
+|
+|   RETURN:     0 once a slot is taken, -1 if the deadline passed first
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Takes a slot before a request is sent, waiting while the
+|               limit is reached. A taken slot must be given back with
+|               adapt_release(), whether the request succeeded or not.
+------------------------------------------------------------------------------*/
+int adapt_acquire(uint64_t deadline)
+{
+    struct timespec _ts;
+    uint64_t _now;
+
+    pthread_mutex_lock(&adapt.lock);
+    while(adapt.in_flight >= (int)adapt.limit)
+    {
+        if((_now = now_ns()) >= deadline)
+        {
+            pthread_mutex_unlock(&adapt.lock);
+            return -1;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &_ts);
+        _ts.tv_nsec += ADAPT_WAIT_MS * 1000000L;
+        if(_ts.tv_nsec >= 1000000000L)
+        {
+            _ts.tv_sec++;
+            _ts.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&adapt.slot, &adapt.lock, &_ts);
+    }
+
+    adapt_tick(now_ns());
+    adapt.in_flight++;
+    pthread_mutex_unlock(&adapt.lock);
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void adapt_release(uint64_t rtt_ns)
+|                   rtt_ns : round trip of the request, 0 if it failed
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Gives a slot back and feeds the request's round trip to the
+|               algorithm. Waiters are woken one per free slot. Whichever
+|               thread is first past the end of an interval prints it.
+------------------------------------------------------------------------------*/
+void adapt_release(uint64_t rtt_ns)
+{
+    uint64_t _now;
+    int _free;
+
+    pthread_mutex_lock(&adapt.lock);
+    _now = now_ns();    // under the lock, so the integrals never go backwards
+    adapt_tick(_now);
+    adapt.in_flight--;
+
+    if(rtt_ns > 0)
+    {
+        adapt_update(_now, rtt_ns);
+        adapt.int_rtt += rtt_ns;
+        adapt.int_n++;
+        if(_now >= adapt.measure_start && _now < adapt.measure_end)
+        {
+            adapt.win_rtt += rtt_ns;
+            adapt.win_n++;
+        }
+    }
+
+    if(_now >= adapt.next_report)
+        adapt_progress(_now);
+
+    _free = (int)adapt.limit - adapt.in_flight;
+    if(_free > 1)
+        pthread_cond_broadcast(&adapt.slot);
+    else if(_free == 1)
+        pthread_cond_signal(&adapt.slot);
+    pthread_mutex_unlock(&adapt.lock);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   static void adapt_tick(uint64_t now)
+|                   now : current time (now_ns clock)
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Integrates the requests in flight and the limit over the time
+|               since the last change, for their time averages. Called with
+|               the lock held before either of them changes.
+------------------------------------------------------------------------------*/
+static void adapt_tick(uint64_t now)
+{
+    double _dt = now - adapt.t_change;
+
+    adapt.int_area += adapt.in_flight * _dt;
+    adapt.int_limit += adapt.limit * _dt;
+    if(now > adapt.measure_start && adapt.t_change < adapt.measure_end)
+    {
+        adapt.win_area += adapt.in_flight * _dt;
+        adapt.win_limit += adapt.limit * _dt;
+    }
+    adapt.t_change = now;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   static void adapt_update(uint64_t now, uint64_t rtt)
+|                   now : current time (now_ns clock)
+|                   rtt : round trip of the request that just completed (ns)
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Moves the limit (see the module description). The baseline is
+|               the lowest RTT seen; every ADAPT_REBASE seconds it is replaced
+|               by the lowest of the last period, so a server that got slower
+|               for good is not compared against a stale best case.
+------------------------------------------------------------------------------*/
+static void adapt_update(uint64_t now, uint64_t rtt)
+{
+    double _tolerated, _gradient;
+
+    if(rtt < adapt.base_rtt)
+        adapt.base_rtt = rtt;
+    if(rtt < adapt.next_base)
+        adapt.next_base = rtt;
+    if(now >= adapt.rebase_at)
+    {
+        adapt.base_rtt = adapt.next_base;
+        adapt.next_base = UINT64_MAX;
+        adapt.rebase_at = now + ADAPT_REBASE * 1000000000ull;
+    }
+    _tolerated = ADAPT_TOLERANCE * adapt.base_rtt;
+
+    if(adapt.algo == ADAPT_AIMD)
+    {
+        if(rtt <= _tolerated)
+            adapt.limit += 1.0 / adapt.limit;
+        else if(now - adapt.last_cut > rtt)   // one decrease per round trip
+        {
+            adapt.limit *= ADAPT_BACKOFF;
+            adapt.last_cut = now;
+        }
+    }
+    else
+    {
+        adapt.grad_sum += rtt;
+        if(++adapt.grad_n < (uint64_t)adapt.limit)
+            return;
+
+        _gradient = _tolerated * adapt.grad_n / adapt.grad_sum;
+        if(_gradient > 1)
+            _gradient = 1;
+        if(_gradient < 0.5)
+            _gradient = 0.5;
+        adapt.limit = (1 - ADAPT_SMOOTHING) * adapt.limit
+                      + ADAPT_SMOOTHING * (adapt.limit * _gradient + sqrt(adapt.limit));
+        adapt.grad_sum = 0;
+        adapt.grad_n = 0;
+    }
+
+    if(adapt.limit < 1)
+        adapt.limit = 1;
+    if(adapt.limit > adapt.max)
+        adapt.limit = adapt.max;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   static void adapt_progress(uint64_t now)
+|                   now : current time (now_ns clock)
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Prints the interval that just ended: mean limit and requests
+|               in flight, mean and baseline round trip, and the throughput
+|               measured next to the one Little's law predicts (L / W).
+------------------------------------------------------------------------------*/
+static void adapt_progress(uint64_t now)
+{
+    double _span = now - adapt.next_report + adapt.interval_ns;
+    double _rtt = adapt.int_n > 0 ? adapt.int_rtt / adapt.int_n : 0;
+    double _inflight = adapt.int_area / _span;
+
+    printf("- Adaptive: limit %.1f, in flight %.1f, rtt %.1f us (base %.1f us), "
+           "%.0f requests/sec, L/W %.0f\n",
+           adapt.int_limit / _span, _inflight, _rtt / 1000.0, adapt.base_rtt / 1000.0,
+           adapt.int_n / (_span / 1e9), _rtt > 0 ? _inflight / (_rtt / 1e9) : 0);
+
+    adapt.int_area = 0;
+    adapt.int_limit = 0;
+    adapt.int_rtt = 0;
+    adapt.int_n = 0;
+    while(adapt.next_report <= now)
+        adapt.next_report += adapt.interval_ns;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void adapt_report(FILE *out, double secs)
+|                   *out : stream to print to
+|                   secs : length of the measurement window (s)
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Prints where the limit settled over the measurement window
+|               and checks Little's law: the mean requests in flight over the
+|               mean round trip against the throughput actually measured.
+------------------------------------------------------------------------------*/
+void adapt_report(FILE *out, double secs)
+{
+    double _ns, _rtt;
+
+    pthread_mutex_lock(&adapt.lock);
+    _ns = secs * 1e9;
+    _rtt = adapt.win_n > 0 ? adapt.win_rtt / adapt.win_n : 0;
+    fprintf(out, "Adaptive concurrency (%s): limit settled at %.1f of %d, baseline rtt %.1f us\n",
+            adapt_name(adapt.algo), adapt.win_limit / _ns, adapt.max, adapt.base_rtt / 1000.0);
+    fprintf(out, "Little's law: %.2f in flight / %.1f us = %.1f requests/sec (measured %.1f)\n",
+            adapt.win_area / _ns, _rtt / 1000.0,
+            _rtt > 0 ? (adapt.win_area / _ns) / (_rtt / 1e9) : 0, adapt.win_n / secs);
+    pthread_mutex_unlock(&adapt.lock);
+}
@@ -0,0 +1,258 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     admit.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that decides whether the server takes on one more
+|               connection. Without it a saturated server keeps accepting and
+|               every client's latency degrades together; with it the server
+|               sheds new connections and keeps serving the ones it has.
+|
+|               Two limits can be set: a maximum number of open connections
+|               (--max-conns) and a maximum event loop lag (--max-lag), the
+|               smoothed time a loop spends between two waits, which is how
+|               long a new event can sit unnoticed. Over a limit a connection
+|               is either accepted and reset straight away (close policy) or
+|               the event loop stops watching its listeners so connections
+|               queue in the kernel backlog (pause policy, epoll and poll
+|               only). Listeners are resumed with some hysteresis: below 90%
+|               of the connection limit and half the lag limit.
+------------------------------------------------------------------------------*/
+#include "../include/admit.h"
+#include "../include/hist.h"
+#include <stdio.h>
+#include <string.h>
+
+/* ---- Macros ---- */
+#define LAGSHIFT 3          // lag EWMA weight of a new sample: 1/8
+
+/* --- Global ---- */
+struct admit_ctl admit;
+static const char *admit_names[] = {"ok", "connection limit", "loop lag"};
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void admit_init(int max_conns, long max_lag_us, int policy)
+|                   max_conns  : open connection limit (0 = none)
+|                   max_lag_us : loop lag limit in us (0 = none)
+|                   policy     : REJECT_CLOSE or REJECT_PAUSE
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Sets the limits and clears the counters.
+------------------------------------------------------------------------------*/
+void admit_init(int max_conns, long max_lag_us, int policy)
+{
+    memset(&admit, 0, sizeof admit);
+    admit.max_conns = max_conns;
+    admit.max_lag_ns = (uint64_t)max_lag_us * 1000;
+    admit.policy = policy;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int admit_check(int live)
+|                   live : connections open right now
+|
+|   RETURN:     ADMIT_OK, or the limit that is exceeded
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Checks the limits for one more connection.
+------------------------------------------------------------------------------*/
+int admit_check(int live)
+{
+    if(admit.max_conns > 0 && live >= admit.max_conns)
+        return ADMIT_FULL;
+
+    if(admit.max_lag_ns > 0 && admit.lag_ns > admit.max_lag_ns)
+        return ADMIT_LAG;
+
+    return ADMIT_OK;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void admit_loop_lag(uint64_t busy_ns)
+|                   busy_ns : time the loop took from wakeup to its next wait
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Feeds one loop iteration into the smoothed lag. Called by the
+|               single threaded event loops only.
+------------------------------------------------------------------------------*/
+void admit_loop_lag(uint64_t busy_ns)
+{
+    admit.lag_ns += ((int64_t)busy_ns - (int64_t)admit.lag_ns) >> LAGSHIFT;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void admit_reject(int reason)
+|                   reason : ADMIT_FULL or ADMIT_LAG
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Counts a rejected connection.
+------------------------------------------------------------------------------*/
+void admit_reject(int reason)
+{
+    __sync_fetch_and_add(&admit.rejected[reason], 1);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void admit_set_pausable()
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Called by a backend that can pause its listeners. Other
+|               backends always use the close policy.
+------------------------------------------------------------------------------*/
+void admit_set_pausable()
+{
+    admit.pausable = admit.policy == REJECT_PAUSE;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int admit_pause(int reason)
+|                   reason : ADMIT_FULL or ADMIT_LAG
+|
+|   RETURN:     1 if the listeners are to be paused, 0 if they already are
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Marks the listeners paused and counts the pause.
+------------------------------------------------------------------------------*/
+int admit_pause(int reason)
+{
+    if(admit.paused)
+        return 0;
+
+    admit.paused = 1;
+    admit.pauses[reason]++;
+    admit.pause_start = now_ns();
+    return 1;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int admit_paused()
+|
+|   RETURN:     1 while the listeners are paused
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Tells the event loop whether its listeners are paused.
+------------------------------------------------------------------------------*/
+int admit_paused()
+{
+    return admit.paused;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int admit_resume(int live)
+|                   live : connections open right now
+|
+|   RETURN:     1 if the listeners are to be resumed, 0 otherwise
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Ends a pause once the load is clearly below the limits, so
+|               the listeners don't flap at the threshold.
+------------------------------------------------------------------------------*/
+int admit_resume(int live)
+{
+    if(!admit.paused)
+        return 0;
+
+    if(admit.max_conns > 0 && live >= admit.max_conns * 9 / 10)
+        return 0;
+
+    if(admit.max_lag_ns > 0 && admit.lag_ns > admit.max_lag_ns / 2)
+        return 0;
+
+    admit.paused = 0;
+    admit.paused_ns += now_ns() - admit.pause_start;
+    return 1;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void admit_report(FILE *out)
+|                   *out : stream to print to
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Prints the rejected connections and pauses by reason. Nothing
+|               is printed when no limit was set.
+------------------------------------------------------------------------------*/
+void admit_report(FILE *out)
+{
+    uint64_t _paused = admit.paused_ns;
+
+    if(admit.max_conns == 0 && admit.max_lag_ns == 0)
+        return;
+
+    if(admit.paused)
+        _paused += now_ns() - admit.pause_start;
+
+    fprintf(out, "\nAdmission control (max conns %d, max lag %.0f us, %s policy)\n",
+            admit.max_conns, admit.max_lag_ns / 1e3, admit.policy == REJECT_PAUSE ? "pause" : "close");
+    for(int i = ADMIT_FULL; i <= ADMIT_LAG; i++)
+        fprintf(out, "- %s: %ld rejected, %ld pauses\n", admit_names[i], admit.rejected[i], admit.pauses[i]);
+    fprintf(out, "- Listeners paused %.1f ms in total\n", _paused / 1e6);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int parse_reject(const char *name)
+|                   *name : "close" or "pause"
+|
+|   RETURN:     REJECT_CLOSE or REJECT_PAUSE, -1 for an unknown policy
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Parses a reject policy given on the command line.
+------------------------------------------------------------------------------*/
+int parse_reject(const char *name)
+{
+    if(strcmp(name, "close") == 0)
+        return REJECT_CLOSE;
+    if(strcmp(name, "pause") == 0)
+        return REJECT_PAUSE;
+
+    return -1;
+}
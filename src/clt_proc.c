@@ -0,0 +1,241 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     clt_proc.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that splits the load generator over several processes.
+|               A single client process is bound by its own thread scheduling,
+|               so with --procs P the coordinator forks P workers, each pinned
+|               to its own core of those the process may run on (its cpuset)
+|               and running its share of the clients. All
+|               workers wait on a process-shared barrier so they start at the
+|               same time, and on a second one once all their clients have
+|               connected, so every process (and the coordinator) lays out the
+|               same warm-up and measurement window. Each worker leaves its merged histograms and counters
+|               in its slot of a shared memory segment. The coordinator merges
+|               the slots once every worker has exited and prints one summary.
+------------------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include "../include/clt_proc.h"
+#include "../include/hist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+static struct clt_shm *proc_shm;    // this worker's segment, NULL when not forked
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int run_workers()
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Maps the shared segment, forks clt_cfg.procs workers, releases
+|               them together through the barrier, starts the phases with them
+|               once their clients have connected, waits for them and reports
+|               the merged results.
+------------------------------------------------------------------------------*/
+int run_workers()
+{
+    struct clt_shm *_shm;
+    pthread_barrierattr_t _attr;
+    cpu_set_t _cpus;
+    size_t _size = sizeof(struct clt_shm) + clt_cfg.procs * sizeof(struct connect_stats);
+    pid_t *_pids;
+    int _status;
+    int _failed = 0;
+
+    if((_shm = mmap(NULL, _size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+    {
+        printf("\tError mapping shared memory\n");
+        printf("\tError code: %s\n\n", strerror(errno));
+        return -1;
+    }
+
+    if((_pids = calloc(clt_cfg.procs, sizeof *_pids)) == NULL)
+    {
+        munmap(_shm, _size);
+        return -1;
+    }
+
+    // workers plus the coordinator meet at the barriers
+    pthread_barrierattr_init(&_attr);
+    pthread_barrierattr_setpshared(&_attr, PTHREAD_PROCESS_SHARED);
+    pthread_barrier_init(&_shm->start, &_attr, clt_cfg.procs + 1);
+    pthread_barrier_init(&_shm->connected, &_attr, clt_cfg.procs + 1);
+    pthread_barrierattr_destroy(&_attr);
+    _shm->nslots = clt_cfg.procs;
+    for(int i = 0; i < clt_cfg.procs; i++)
+    {
+        hist_init(&_shm->slots[i].lat);
+        hist_init(&_shm->slots[i].rtt);
+    }
+
+    // workers inherit this mask and pin themselves to one core of it each
+    if(sched_getaffinity(0, sizeof(_cpus), &_cpus) == 0 && CPU_COUNT(&_cpus) < clt_cfg.procs)
+        printf("- %d workers share %d allowed cores, some are pinned to the same core\n",
+               clt_cfg.procs, CPU_COUNT(&_cpus));
+
+    fflush(stdout);     // don't duplicate buffered output in the children
+    for(int i = 0; i < clt_cfg.procs; i++)
+    {
+        if((_pids[i] = fork()) == -1)
+        {
+            printf("\tError forking worker %d\n", i);
+            printf("\tError code: %s\n\n", strerror(errno));
+            for(int j = 0; j < i; j++)      // nobody can pass the barrier now
+                kill(_pids[j], SIGKILL);
+            while(wait(NULL) > 0)
+                ;
+            free(_pids);
+            munmap(_shm, _size);
+            return -1;
+        }
+        if(_pids[i] == 0)
+            _exit(run_worker(_shm, i) == -1 ? 1 : 0);
+    }
+
+    printf("- Started %d worker processes\n", clt_cfg.procs);
+    pthread_barrier_wait(&_shm->start);
+    pthread_barrier_wait(&_shm->connected);
+    set_phases(now_ns());
+
+    for(int i = 0; i < clt_cfg.procs; i++)
+        if(waitpid(_pids[i], &_status, 0) == -1 || !WIFEXITED(_status) || WEXITSTATUS(_status) != 0)
+        {
+            printf("\tWorker %d failed, its results are missing\n", i);
+            _failed++;
+        }
+
+    report_connect_stats(_shm->slots, _shm->nslots);
+    if(_failed > 0)
+        printf("\n%d of %d workers failed\n", _failed, clt_cfg.procs);
+
+    pthread_barrier_destroy(&_shm->start);
+    pthread_barrier_destroy(&_shm->connected);
+    munmap(_shm, _size);
+    free(_pids);
+    return _failed > 0 ? -1 : 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int run_worker(struct clt_shm *shm, int id)
+|                   *shm : shared segment
+|                   id   : worker number
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Body of a forked worker. Takes its slice of the clients
+|               (the first clients % procs workers get one extra), pins itself
+|               to a core, waits at the barrier, runs the clients and merges
+|               their results into its slot. A worker that can't be pinned or
+|               whose clients never ran fails, but still passes both barriers
+|               so the others aren't held.
+------------------------------------------------------------------------------*/
+int run_worker(struct clt_shm *shm, int id)
+{
+    int _share = clt_cfg.clients / clt_cfg.procs;
+    int _extra = clt_cfg.clients % clt_cfg.procs;
+    int _pinned;
+
+    clt_cfg.proc_clients = _share + (id < _extra);
+    clt_cfg.client_base = id * _share + (id < _extra ? id : _extra);
+
+    _pinned = pin_core(id);
+
+    proc_shm = shm;
+    pthread_barrier_wait(&shm->start);
+
+    if(_pinned == -1 || run_clients() == -1)
+    {
+        wait_connected();
+        return -1;
+    }
+
+    for(int i = 0; i < clt_cfg.proc_clients; i++)
+        merge_connect_stats(&shm->slots[id], &conn_stats[i]);
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int pin_core(int id)
+|                   id : worker number
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Pins the calling process (and so the client threads it will
+|               create) to the id-th core it is allowed to run on, counting
+|               the cores of its affinity mask (a cpuset or taskset may leave
+|               out any of them). With more workers than allowed cores the
+|               count wraps and workers share cores.
+------------------------------------------------------------------------------*/
+int pin_core(int id)
+{
+    cpu_set_t _allowed, _set;
+    int _cpu, _n;
+
+    if(sched_getaffinity(0, sizeof(_allowed), &_allowed) == -1)
+    {
+        printf("\tWorker %d: error reading allowed cores\n", id);
+        printf("\tError code: %s\n\n", strerror(errno));
+        return -1;
+    }
+
+    // the (id % allowed)-th set bit of the mask
+    _n = id % CPU_COUNT(&_allowed);
+    for(_cpu = 0; _cpu < CPU_SETSIZE; _cpu++)
+        if(CPU_ISSET(_cpu, &_allowed) && _n-- == 0)
+            break;
+
+    CPU_ZERO(&_set);
+    CPU_SET(_cpu, &_set);
+    if(sched_setaffinity(0, sizeof(_set), &_set) == -1)
+    {
+        printf("\tWorker %d: error pinning to core\n", id);
+        printf("\tError code: %s\n\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void wait_connected()
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Called by one client thread of a worker once all its clients
+|               have connected. Holds it until every other worker (and the
+|               coordinator) gets there, so they all start the phases
+|               together. Returns at once when the clients weren't forked.
+------------------------------------------------------------------------------*/
+void wait_connected()
+{
+    if(proc_shm != NULL)
+        pthread_barrier_wait(&proc_shm->connected);
+}
@@ -15,10 +15,77 @@
 |               create. The program will then create a seperate thread for each
 |               client in order to simulate multiple client connections to the
 |               server.
+|
+|               With -k the clients speak the key-value protocol (see kv.h)
+|               instead of echo, drawing keys from a uniform or zipfian
+|               distribution with a configurable read/write mix:
+|
+|                   Usage: ./clt [-k] [--keys N] [--dist uniform|zipf[:S]]
+|                                [--reads R] [--dels R] [--vlen N]
+|                                <HOST IP> <PORT> <NUM OF CLIENTS>
+|
+|               Connection establishment can be ramped (--ramp RATE conn/s or
+|               --steps N:MS) instead of every client connecting at the same
+|               instant. Connect latency is recorded in a histogram and failed
+|               connects are classified (refused, timed out, reset before the
+|               first echo) and reported once all clients have finished.
+|
+|               With --churn K each client opens a connection, does K echoes
+|               and closes it (RST via SO_LINGER 0, so no TIME_WAIT builds up),
+|               repeating until TIMEOUT. --ports LO-HI binds every connection
+|               to an explicit local port range split between the clients.
+|               A client whose connect fails waits before the next one, from
+|               CHURN_BACKOFF ms doubling up to CHURN_MAXBACKOFF, so a server
+|               that refuses connections isn't hammered by a spinning loop.
+|
+|               --profile NAME applies one of the socket option profiles in
+|               socket.c to every client socket. --autotune instead runs a
+|               short benchmark with each profile and reports the fastest.
+|
+|               --unix PATH (or --seqpacket PATH) connects to the server's unix
+|               domain socket instead of HOST IP:PORT. --compare runs a short
+|               benchmark over tcp and then over the unix socket and reports
+|               the loopback tcp overhead for the server's I/O model.
+|               --find-knee US searches for the most clients the server
+|               serves with a p99 round trip under US microseconds.
+|               --adaptive aimd|gradient keeps <NUM OF CLIENTS> connections
+|               but limits the requests in flight, following the round trip
+|               times to settle at the server's capacity (see adapt.c).
+|
+|               With --procs P the clients are split over P forked worker
+|               processes pinned to distinct cores (see clt_proc.c); their
+|               results are merged through shared memory.
+|
+|               --idle M makes every client hold M extra connections open, and
+|               idle, for the whole run, which is how the server's scale mode
+|               (-M) is driven to very large connection counts. --src-spread N
+|               binds connections round-robin to 127.0.0.1-127.0.0.N so the
+|               ~28k ephemeral ports of a single source address are not the
+|               limit.
+|
+|               --integrity sends checksummed frames with a sequence number
+|               and a pseudo-random body instead of 'A's, and checks every
+|               echo (see verify.c). Corrupted, misordered and short echoes
+|               are counted and reported with the other results.
+|
+|               --series PATH writes requests/sec, bytes/sec, connections and
+|               round trip percentiles every --interval MS (see series.c).
+|
+|               A run is --warmup S, then the --duration S measurement window
+|               (TIMEOUT by default), then --cooldown S. Clients send all the
+|               time but only requests completing inside the window count.
+|               The phases are laid out once every client thread has made its
+|               first connect (after its --ramp / --steps slot), so the
+|               connect ramp and cold start never fall inside the window and
+|               all clients enter and leave it together.
 ------------------------------------------------------------------------------*/
 #include "../include/clt_thread.h"
+#include "../include/clt_proc.h"
 #include "../include/socket.h"
 #include "../include/log.h"
+#include "../include/kv.h"
+#include "../include/keydist.h"
+#include "../include/hist.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
@@ -31,6 +98,18 @@
 #include <sys/time.h>
 #include <omp.h>
 #include <pthread.h>
+#include <getopt.h>
+
+/* ---- Macros ---- */
+#ifndef IP_BIND_ADDRESS_NO_PORT
+#define IP_BIND_ADDRESS_NO_PORT 24  // linux >= 4.2, missing from older headers
+#endif
+
+/* --- Global ---- */
+struct clt_config clt_cfg;
+struct connect_stats *conn_stats;   // one per client thread
+int clt_active = 0;                 // open connections (time series)
+static char kv_value[KV_MAXVAL];    // payload of every kv SET
 
 /*==============================================================================
 |   FUNCTION:   int main(int argc, char **argv)
@@ -47,257 +126,1677 @@
 ==============================================================================*/
 int main(int argc, char **argv)
 {
-    if(!valid_args(argc, argv[ARG_PORT], argv[ARG_CLTS]))  // check for valid args
+    if(!parse_args(argc, argv))  // check for valid args
         exit(1);
 
-    if(app_clt_hdr() == -1)  // append header to client log file
+    if(app_clt_hdr(clt_cfg.run_secs) == -1)  // append header to client log file
         exit(1);
 
-    struct clt_nw_var nw_var;
-    get_host_info(&nw_var, argv[ARG_IP], argv[ARG_PORT]);
+    if(clt_cfg.churn > 0)
+        check_port_range();
 
-    int num_of_clts = atoi(argv[ARG_CLTS]); // get number of client to create
-    omp_set_num_threads(num_of_clts);
+    if(clt_cfg.idle > 0)
+        printf("- Open file limit: %ld\n", raise_fd_limit());
 
-    #pragma omp parallel
+    if(clt_cfg.autotune)
+    {
+        if(autotune() == -1)
+            exit(1);
+        return 0;
+    }
+
+    if(clt_cfg.compare)
+    {
+        if(compare_transports() == -1)
+            exit(1);
+        return 0;
+    }
+
+    if(clt_cfg.knee_slo_us > 0)
+    {
+        if(find_knee() == -1)
+            exit(1);
+        return 0;
+    }
+
+    if(clt_cfg.procs > 1)   // coordinator of forked load generators
     {
-        spawn_clients(argv[ARG_IP], argv[ARG_PORT]);
+        if(run_workers() == -1)
+            exit(1);
+        return 0;
     }
 
+    if(clt_cfg.series != NULL && series_init(clt_cfg.series, clt_cfg.interval_ms, &clt_active) == -1)
+        exit(1);
+
+    if(clt_cfg.adaptive)
+        adapt_init(clt_cfg.adaptive, clt_cfg.clients, clt_cfg.interval_ms);
+
+    if(run_clients() == -1)
+        exit(1);
+    series_stop();
+
+    report_connect_stats(conn_stats, clt_cfg.clients);
     return 0;
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   int valid_args(int arg, char *port, char *clients)
-|                   arg   : number of cmd args
-|                   *port : port arg
-|                   *clients : number of clients arg
+|   FUNCTION:   int run_clients()
 |
-|   RETURN:     1 on true, 0 on false
+|   RETURN:     0 on success, -1 on failure
 |
-|   DATE:       Feb 13, 2018
+|   DATE:       Oct 18, 2026
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Checks for valid arguments (valid number of args, port and
-|               number of clients). Returns true (1) if args are valid,
-|               otherwise returns false (0).
+|   DESC:       Runs this process's share of clients (clt_cfg.proc_clients),
+|               one thread each, and returns once all of them have finished.
+|               Their results are left in 'conn_stats'.
 ------------------------------------------------------------------------------*/
-int valid_args(int arg, char *port, char *clients)
+int run_clients()
 {
-    // check valid number of args (4)
-    if(arg != ARGSNUM)
+    if((conn_stats = calloc(clt_cfg.proc_clients, sizeof *conn_stats)) == NULL)
     {
-        printf("\nUsage: ./clt <HOST IP> <PORT> <NUM OF CLIENTS>\n\n");
-        return 0;
+        printf("\tError allocating client stats\n");
+        printf("\tError code: %s\n\n", strerror(errno));
+        return -1;
     }
-
-    // check for valid port
-    for(int i = 0; port[i] != '\0'; i++)
+    for(int i = 0; i < clt_cfg.proc_clients; i++)
     {
-        if(!isdigit(port[i]))
-        {
-            printf("\nError: Invalid port: %s.\n\n", port);
-            return 0;
-        }
+        hist_init(&conn_stats[i].lat);
+        hist_init(&conn_stats[i].rtt);
     }
 
-    // check for valid num of clients
-    for(int i = 0; clients[i] != '\0'; i++)
+    omp_set_num_threads(clt_cfg.proc_clients);
+
+    #pragma omp parallel
     {
-        if(!isdigit(clients[i]))
-        {
-            printf("\nError: Invalid number of clients: %s.\n\n", port);
-            return 0;
-        }
+        spawn_clients(clt_cfg.ip, clt_cfg.port);
     }
 
-    return 1;
+    return 0;
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   int connect_to_host(struct clt_nw_var *nw)
-|                   *nw : pointer to clients network variables
+|   FUNCTION:   int bench_run(double *rate, double *p50, double *p99, long *errors)
+|                   *rate   : set to requests per second
+|                   *p50    : set to median round trip (us)
+|                   *p99    : set to 99th percentile round trip (us)
+|                   *errors : set to failed connects and bad echoes (may be NULL)
 |
 |   RETURN:     0 on success, -1 on failure
 |
-|   DATE:       Feb 13, 2018
+|   DATE:       Oct 18, 2026
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       High level function that connects the client program to a host
-|               machine. Uses variables held in '*nw' to create a socket and
-|               connect the socket to a host machine.
+|   DESC:       Runs the clients once with the current settings for
+|               clt_cfg.run_secs and boils the results down to the numbers
+|               the sweeps compare.
 ------------------------------------------------------------------------------*/
-int connect_to_host(struct clt_nw_var *nw)
+int bench_run(double *rate, double *p50, double *p99, long *errors)
 {
-    if(create_socket(&(nw->sd), AF_INET, SOCK_STREAM, 0) == -1)
+    struct connect_stats _total;
+    double _secs;
+
+    if(run_clients() == -1)
         return -1;
+    _secs = measured_secs();
 
-    bzero((char *)&(nw->h_addr), sizeof(struct sockaddr_in));
-    fill_addr(&(nw->h_addr), AF_INET, nw->h_port, nw->h_ip);
+    memset(&_total, 0, sizeof(_total));
+    hist_init(&_total.lat);
+    hist_init(&_total.rtt);
+    for(int i = 0; i < clt_cfg.proc_clients; i++)
+        merge_connect_stats(&_total, &conn_stats[i]);
+    free(conn_stats);
 
-    if(connect_socket(nw->sd, (struct sockaddr *)&(nw->h_addr), sizeof(nw->h_addr)) == -1)
-        return -1;
+    *rate = _total.requests / _secs;
+    *p50 = hist_percentile(&_total.rtt, 50) / 1000.0;
+    *p99 = hist_percentile(&_total.rtt, 99) / 1000.0;
+    if(errors != NULL)
+        *errors = _total.refused + _total.timeouts + _total.resets + _total.other
+                  + _total.corrupt + _total.misordered + _total.short_echoes;
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int autotune()
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Runs the clients for AUTOTUNE_SECS with every socket profile in
+|               turn and prints requests/sec and latency of each, then the
+|               profile with the highest request rate. Only the client's own
+|               sockets are swept; the server keeps the profile it was
+|               started with.
+------------------------------------------------------------------------------*/
+int autotune()
+{
+    const struct sock_profile *_p;
+    double _rate[16], _p50[16], _p99[16];
+    int _n, _best = 0;
+
+    clt_cfg.run_secs = AUTOTUNE_SECS;
+    for(_n = 0; (_p = profile_at(_n)) != NULL && _n < 16; _n++)
+    {
+        clt_cfg.profile = _p;
+        if(bench_run(&_rate[_n], &_p50[_n], &_p99[_n], NULL) == -1)
+            return -1;
+        if(_rate[_n] > _rate[_best])
+            _best = _n;
+    }
+
+    printf("\nAutotune: %d clients, %d sec per profile\n", clt_cfg.clients, AUTOTUNE_SECS);
+    printf("%-12s %14s %12s %12s\n", "PROFILE", "REQUESTS/SEC", "P50 (us)", "P99 (us)");
+    for(int i = 0; i < _n; i++)
+        printf("%-12s %14.1f %12.1f %12.1f\n", profile_at(i)->name, _rate[i], _p50[i], _p99[i]);
+    printf("\nBest profile: %s (--profile %s)\n\n", profile_at(_best)->name, profile_at(_best)->name);
 
     return 0;
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   int send_loop(struct clt_nw_var nw)
-|                   nw : clients network variables
+|   FUNCTION:   int compare_transports()
 |
 |   RETURN:     0 on success, -1 on failure
 |
-|   DATE:       Feb 13, 2018
+|   DATE:       Oct 18, 2026
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Function to initiate send loop. Clients keeps sending a packet
-|               of PKTSIZE and reading the echo from the server until TIMEOUT
-|               has occured.
+|   DESC:       Runs the clients for AUTOTUNE_SECS over loopback tcp and then
+|               over the unix socket, and prints both along with the cost of
+|               tcp relative to the unix socket. Run it once per server
+|               backend to compare I/O models.
 ------------------------------------------------------------------------------*/
-int send_loop(struct clt_nw_var nw)
+int compare_transports()
 {
-    struct timeval _tt1;
-    struct timeval _tt2;
-    struct clt_log_stats _stats;
-    char _send_buff[PKTSIZE];
-    char _recv_buff[PKTSIZE];
-    double _elapsed_time;
-    double _avg_time = 0;
-    int _bytes_recv;
-    int _bytes_sent;
-    time_t _t = time(NULL);
-    time_t _t1;
-    time_t _t2;
+    const char *_path = clt_cfg.unix_path;
+    double _rate[2], _p50[2], _p99[2];
 
-    memset(_send_buff, 'A', PKTSIZE);
-    time(&_t1);                      // get current time (for timeout)
-    _stats.tm = *localtime(&_t);     // time of new connection
-    _stats.requests = 0;
-    init_bytes_struct(&(_stats.bytes));
+    clt_cfg.run_secs = AUTOTUNE_SECS;
 
-    // send loop (unitl timeout)
-    while(1)
-    {
-        gettimeofday(&_tt1, NULL); // start timer
+    clt_cfg.unix_path = NULL;
+    if(bench_run(&_rate[0], &_p50[0], &_p99[0], NULL) == -1)
+        return -1;
 
-        // send oacket
-        if ((_bytes_sent = send(nw.sd, _send_buff, PKTSIZE, 0)) == -1)
-        {
-            printf("\tError sending\n");
-      	    printf("\tError code: %s\n\n", strerror(errno));
-            return -1;
-        }
+    clt_cfg.unix_path = _path;
+    if(bench_run(&_rate[1], &_p50[1], &_p99[1], NULL) == -1)
+        return -1;
 
-        _stats.requests++; // update client requests
+    printf("\nTransport comparison: %d clients, %d sec each\n", clt_cfg.clients, AUTOTUNE_SECS);
+    printf("%-12s %14s %12s %12s\n", "TRANSPORT", "REQUESTS/SEC", "P50 (us)", "P99 (us)");
+    printf("%-12s %14.1f %12.1f %12.1f\n", "tcp", _rate[0], _p50[0], _p99[0]);
+    printf("%-12s %14.1f %12.1f %12.1f\n", clt_cfg.unix_type == SOCK_SEQPACKET ? "seqpacket" : "unix",
+           _rate[1], _p50[1], _p99[1]);
+    if(_rate[0] > 0 && _p50[1] > 0)
+        printf("\nTCP overhead: %.1f%% fewer requests/sec, %.1f%% higher p50\n\n",
+               100.0 * (1 - _rate[0] / _rate[1]), 100.0 * (_p50[0] / _p50[1] - 1));
 
-        // read echo
-        if((_bytes_recv = recv(nw.sd, _recv_buff, PKTSIZE, MSG_WAITALL)) == -1)
-        {
-            printf("\tClient %d error reading\n", omp_get_thread_num());
-      	    printf("\tError code: %s\n\n", strerror(errno));
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int find_knee()
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Finds the most concurrent clients the server handles with a
+|               p99 round trip within the SLO and no errors (--find-knee US).
+|               Concurrency doubles from 1 until a run fails or <NUM OF
+|               CLIENTS> is reached, then a binary search between the last
+|               passing and the first failing count narrows the knee down to
+|               KNEE_PRECISION. Each run lasts AUTOTUNE_SECS (after
+|               --warmup, if given). Prints every run and the knee: the
+|               passing run with the highest request rate. Run it once per
+|               server backend to compare where each falls over.
+------------------------------------------------------------------------------*/
+int find_knee()
+{
+    struct knee_probe _probes[KNEE_MAXPROBES];
+    int _max = clt_cfg.clients;
+    int _np = 0, _lo = 0, _hi = 0, _n = 1, _best = -1;
+
+    clt_cfg.run_secs = AUTOTUNE_SECS;
+    printf("\nSaturation search: p99 SLO %.0f us, up to %d clients, %d sec per run\n",
+           clt_cfg.knee_slo_us, _max, AUTOTUNE_SECS);
+
+    // exponential probe for a failing concurrency
+    while(_np < KNEE_MAXPROBES)
+    {
+        if(knee_probe(&_probes[_np], _n) == -1)
             return -1;
-        }
-        else if(_bytes_recv == 0) // server shutdown
+        if(!_probes[_np++].pass)
         {
-            printf("\nServer shutdown\n\n");
+            _hi = _n;
             break;
         }
-        else // success
-        {
-            update_bytes_struct(&_stats.bytes, _bytes_recv);
-            bzero(_recv_buff, sizeof(_recv_buff));
-        }
-
-        gettimeofday(&_tt2, NULL); // stop timer
-        _elapsed_time = (_tt2.tv_sec - _tt1.tv_sec) * 1000.0;
-        _elapsed_time += (_tt2.tv_usec - _tt1.tv_usec) / 1000.0; // in milliseconds
-        _avg_time += _elapsed_time;
-
-        // check for timeout
-        time(&_t2);
-        if(difftime(_t2, _t1) > TIMEOUT)
+        _lo = _n;
+        if(_n == _max)
             break;
+        _n = 2 * _n > _max ? _max : 2 * _n;
     }
 
-    _avg_time = _avg_time / _stats.requests;
-    printf("- Client %d: Disconnecting\n", omp_get_thread_num());
-    close(nw.sd);
-    append_clt_data(_stats, _avg_time);
+    // binary search between the last pass and the first failure
+    while(_hi > 0 && _np < KNEE_MAXPROBES && _hi - _lo > 1 && (_hi - _lo) * KNEE_PRECISION > _hi)
+    {
+        _n = (_lo + _hi) / 2;
+        if(knee_probe(&_probes[_np], _n) == -1)
+            return -1;
+        if(_probes[_np++].pass)
+            _lo = _n;
+        else
+            _hi = _n;
+    }
+
+    for(int i = 0; i < _np; i++)
+        if(_probes[i].pass && (_best == -1 || _probes[i].rate > _probes[_best].rate))
+            _best = i;
+
+    printf("\n%-10s %14s %12s %12s %8s\n", "CLIENTS", "REQUESTS/SEC", "P50 (us)", "P99 (us)", "ERRORS");
+    for(int i = 0; i < _np; i++)
+        printf("%-10d %14.1f %12.1f %12.1f %8ld %s\n", _probes[i].clients, _probes[i].rate,
+               _probes[i].p50, _probes[i].p99, _probes[i].errors, _probes[i].pass ? "" : "over SLO");
+
+    if(_best == -1)
+        printf("\nNo run met the SLO, even with 1 client\n\n");
+    else
+    {
+        printf("\nKnee: %d clients, %.1f requests/sec, p99 %.1f us", _probes[_best].clients,
+               _probes[_best].rate, _probes[_best].p99);
+        if(_hi == 0)
+            printf(" (never failed, raise <NUM OF CLIENTS>)");
+        else if(_probes[_best].clients != _lo)
+            printf(" (%d clients also pass, with less throughput)", _lo);
+        printf("\n\n");
+    }
 
     return 0;
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   void spawn_clients(char *ip, char *port)
-|                   *ip : cmd arg that holds the servers IP
-|                   *port : cmd arg that holds teh servers listening port
+|   FUNCTION:   int knee_probe(struct knee_probe *probe, int clients)
+|                   *probe  : result of the run
+|                   clients : concurrency to run with
 |
-|   RETURN:     void
+|   RETURN:     0 on success, -1 on failure
 |
-|   DATE:       Feb 13, 2018
+|   DATE:       Oct 18, 2026
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       high level function that is called by openmp. connects to a host
-|               specified by '*ip' and '*port'. Once connected it calls the
-|               send_loop function in order to initiate data transfer.
+|   DESC:       One run of the saturation search, printed as it completes.
 ------------------------------------------------------------------------------*/
-void spawn_clients(char *ip, char *port)
+int knee_probe(struct knee_probe *probe, int clients)
 {
-    struct clt_nw_var _nw;
-    get_host_info(&_nw, ip, port);
-
-    if(connect_to_host(&_nw) == -1)
-        return;
+    clt_cfg.clients = clt_cfg.proc_clients = clients;
+    probe->clients = clients;
+    if(bench_run(&probe->rate, &probe->p50, &probe->p99, &probe->errors) == -1)
+        return -1;
 
-    if(send_loop(_nw) == -1)
-        return;
+    probe->pass = probe->errors == 0 && probe->rate > 0 && probe->p99 <= clt_cfg.knee_slo_us;
+    printf("- %d clients: %.1f requests/sec, p99 %.1f us, %ld errors -> %s\n", clients,
+           probe->rate, probe->p99, probe->errors, probe->pass ? "pass" : "fail");
+    return 0;
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   void get_host_info(struct clt_nw_var *nw, char *ip, char *port)
-|                   *nw : pointer to clients network variables
-|                   *ip : cmd arg that hold the servers IP
-|                   *port : cmd arg that holds the servers listening port
+|   FUNCTION:   int parse_args(int argc, char **argv)
+|                   argc   : number of cmd args
+|                   **argv : array of args
 |
-|   RETURN:     void
+|   RETURN:     1 on true, 0 on false
 |
-|   DATE:       Feb 13, 2018
+|   DATE:       Oct 18, 2026
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Copies the cmd args holding the servers ip and listening port
-|               ('*ip' and '*port' respectivly) into the appropriate fields
-|               of the clients network data struct pointed to by '*nw'.
+|   DESC:       Parses the option flags into 'clt_cfg' then validates the
+|               positional args with valid_args(). Returns true (1) if args
+|               are valid, otherwise returns false (0).
 ------------------------------------------------------------------------------*/
-void get_host_info(struct clt_nw_var *nw, char *ip, char *port)
+int parse_args(int argc, char **argv)
 {
-    nw->h_ip = inet_addr(ip);
-    nw->h_port = htons(atoi(port));
+    static struct option _opts[] =
+    {
+        {"kv",    no_argument,       NULL, 'k'},
+        {"keys",  required_argument, NULL, 'K'},
+        {"dist",  required_argument, NULL, 'D'},
+        {"reads", required_argument, NULL, 'R'},
+        {"dels",  required_argument, NULL, 'X'},
+        {"vlen",  required_argument, NULL, 'V'},
+        {"ramp",  required_argument, NULL, 'r'},
+        {"steps", required_argument, NULL, 's'},
+        {"connect-timeout", required_argument, NULL, 'T'},
+        {"churn", required_argument, NULL, 'c'},
+        {"ports", required_argument, NULL, 'p'},
+        {"procs", required_argument, NULL, 'P'},
+        {"profile", required_argument, NULL, 'o'},
+        {"autotune", no_argument,    NULL, 'A'},
+        {"unix",  required_argument, NULL, 'u'},
+        {"seqpacket", required_argument, NULL, 'Q'},
+        {"compare", no_argument,     NULL, 'C'},
+        {"idle",  required_argument, NULL, 'I'},
+        {"src-spread", required_argument, NULL, 'S'},
+        {"integrity", no_argument,   NULL, 'i'},
+        {"series", required_argument, NULL, 'E'},
+        {"interval", required_argument, NULL, 'N'},
+        {"duration", required_argument, NULL, 'U'},
+        {"warmup", required_argument, NULL, 'W'},
+        {"cooldown", required_argument, NULL, 'O'},
+        {"find-knee", required_argument, NULL, 'F'},
+        {"adaptive", required_argument, NULL, 'G'},
+        {"help",  no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    enum key_dist _dist = DIST_UNIFORM;
+    double _theta = DEFZIPF;
+    long _nkeys = DEFKEYS;
+    char **_pos;
+    int _opt;
+
+    clt_cfg.kv = 0;
+    clt_cfg.read_ratio = 0.9;
+    clt_cfg.del_ratio = 0;
+    clt_cfg.vlen = DEFVLEN;
+    memset(kv_value, 'V', sizeof(kv_value));
+    clt_cfg.ramp_rate = 0;
+    clt_cfg.step_size = 0;
+    clt_cfg.step_ms = 0;
+    clt_cfg.connect_timeout = DEFCONNTIMEOUT;
+    clt_cfg.churn = 0;
+    clt_cfg.port_lo = 0;
+    clt_cfg.port_hi = 0;
+    clt_cfg.procs = 1;
+    clt_cfg.run_secs = TIMEOUT;
+    clt_cfg.warmup_secs = 0;
+    clt_cfg.cooldown_secs = 0;
+    clt_cfg.knee_slo_us = 0;
+    clt_cfg.adaptive = 0;
+    clt_cfg.profile = find_profile("default");
+    clt_cfg.autotune = 0;
+    clt_cfg.unix_path = NULL;
+    clt_cfg.unix_type = SOCK_STREAM;
+    clt_cfg.compare = 0;
+    clt_cfg.idle = 0;
+    clt_cfg.src_spread = 0;
+    clt_cfg.integrity = 0;
+    clt_cfg.series = NULL;
+    clt_cfg.interval_ms = DEFINTERVAL;
+
+    while((_opt = getopt_long(argc, argv, "kh", _opts, NULL)) != -1)
+    {
+        switch(_opt)
+        {
+            case 'k':
+                clt_cfg.kv = 1;
+                break;
+            case 'K':
+                _nkeys = atol(optarg);
+                break;
+            case 'D':
+                if(strcmp(optarg, "uniform") == 0)
+                    _dist = DIST_UNIFORM;
+                else if(strncmp(optarg, "zipf", 4) == 0)
+                {
+                    _dist = DIST_ZIPF;
+                    if(optarg[4] == ':')
+                        _theta = atof(optarg + 5);
+                }
+                else
+                {
+                    printf("\nError: Invalid key distribution: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'R':
+                clt_cfg.read_ratio = atof(optarg);
+                break;
+            case 'X':
+                clt_cfg.del_ratio = atof(optarg);
+                break;
+            case 'V':
+                clt_cfg.vlen = atoi(optarg);
+                break;
+            case 'r':
+                if((clt_cfg.ramp_rate = atof(optarg)) <= 0)
+                {
+                    printf("\nError: Invalid ramp rate: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 's':
+                if(sscanf(optarg, "%d:%d", &clt_cfg.step_size, &clt_cfg.step_ms) != 2
+                   || clt_cfg.step_size < 1 || clt_cfg.step_ms < 0)
+                {
+                    printf("\nError: Invalid ramp steps: %s (expected N:MS).\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'T':
+                if((clt_cfg.connect_timeout = atoi(optarg)) < 1)
+                {
+                    printf("\nError: Invalid connect timeout: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'c':
+                if((clt_cfg.churn = atoi(optarg)) < 1)
+                {
+                    printf("\nError: Invalid requests per connection: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'p':
+                if(sscanf(optarg, "%d-%d", &clt_cfg.port_lo, &clt_cfg.port_hi) != 2
+                   || clt_cfg.port_lo < 1 || clt_cfg.port_hi > 65535 || clt_cfg.port_lo > clt_cfg.port_hi)
+                {
+                    printf("\nError: Invalid port range: %s (expected LO-HI).\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'P':
+                if((clt_cfg.procs = atoi(optarg)) < 1)
+                {
+                    printf("\nError: Invalid number of processes: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'o':
+                if((clt_cfg.profile = find_profile(optarg)) == NULL)
+                {
+                    printf("\nError: Unknown socket profile: %s.\n", optarg);
+                    print_usage();
+                    return 0;
+                }
+                break;
+            case 'A':
+                clt_cfg.autotune = 1;
+                break;
+            case 'u':
+                clt_cfg.unix_path = optarg;
+                clt_cfg.unix_type = SOCK_STREAM;
+                break;
+            case 'Q':
+                clt_cfg.unix_path = optarg;
+                clt_cfg.unix_type = SOCK_SEQPACKET;
+                break;
+            case 'C':
+                clt_cfg.compare = 1;
+                break;
+            case 'I':
+                if((clt_cfg.idle = atoi(optarg)) < 1)
+                {
+                    printf("\nError: Invalid number of idle connections: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'S':
+                if((clt_cfg.src_spread = atoi(optarg)) < 1 || clt_cfg.src_spread > MAXSPREAD)
+                {
+                    printf("\nError: Source spread must be 1-%d addresses.\n\n", MAXSPREAD);
+                    return 0;
+                }
+                break;
+            case 'i':
+                clt_cfg.integrity = 1;
+                break;
+            case 'E':
+                clt_cfg.series = optarg;
+                break;
+            case 'N':
+                if((clt_cfg.interval_ms = atoi(optarg)) < 1)
+                {
+                    printf("\nError: Invalid time series interval: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'U':
+                if((clt_cfg.run_secs = atoi(optarg)) < 1)
+                {
+                    printf("\nError: Invalid duration: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'W':
+                if(!isdigit(optarg[0]) || (clt_cfg.warmup_secs = atoi(optarg)) < 0)
+                {
+                    printf("\nError: Invalid warm-up: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'O':
+                if(!isdigit(optarg[0]) || (clt_cfg.cooldown_secs = atoi(optarg)) < 0)
+                {
+                    printf("\nError: Invalid cool-down: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'F':
+                if((clt_cfg.knee_slo_us = atof(optarg)) <= 0)
+                {
+                    printf("\nError: Invalid p99 SLO: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'G':
+                if((clt_cfg.adaptive = parse_adapt(optarg)) == 0)
+                {
+                    printf("\nError: Unknown concurrency algorithm: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            default:
+                print_usage();
+                return 0;
+        }
+    }
+
+    // positional args as if they were the only ones given
+    _pos = argv + optind - 1;
+    if(!valid_args(argc - optind + 1, _pos[ARG_PORT], _pos[ARG_CLTS]))
+        return 0;
+
+    if(clt_cfg.vlen < 0 || clt_cfg.vlen > KV_MAXVAL)
+    {
+        printf("\nError: Value size must be 0-%d bytes.\n\n", KV_MAXVAL);
+        return 0;
+    }
+
+    if(clt_cfg.kv && keydist_init(&clt_cfg.keys, _dist, _nkeys, _theta) == -1)
+    {
+        printf("\nError: Invalid key space (%ld) or zipf skew (%.2f).\n\n", _nkeys, _theta);
+        return 0;
+    }
+
+    clt_cfg.ip = _pos[ARG_IP];
+    clt_cfg.port = _pos[ARG_PORT];
+    clt_cfg.clients = atoi(_pos[ARG_CLTS]);
+    clt_cfg.proc_clients = clt_cfg.clients;
+    clt_cfg.client_base = 0;
+
+    if(clt_cfg.procs > clt_cfg.clients)
+    {
+        printf("\nError: More processes than clients.\n\n");
+        return 0;
+    }
+
+    if((clt_cfg.autotune || clt_cfg.compare || clt_cfg.knee_slo_us > 0) && clt_cfg.procs > 1)
+    {
+        printf("\nError: --autotune, --compare and --find-knee run in a single process.\n\n");
+        return 0;
+    }
+
+    if(clt_cfg.compare && clt_cfg.unix_path == NULL)
+    {
+        printf("\nError: --compare needs --unix or --seqpacket.\n\n");
+        return 0;
+    }
+
+    if(clt_cfg.port_lo > 0 && clt_cfg.port_hi - clt_cfg.port_lo + 1 < clt_cfg.clients)
+    {
+        printf("\nError: Port range smaller than number of clients.\n\n");
+        return 0;
+    }
+
+    if(clt_cfg.src_spread > 0 && (clt_cfg.port_lo > 0 || clt_cfg.unix_path != NULL))
+    {
+        printf("\nError: --src-spread can't be used with --ports or a unix socket.\n\n");
+        return 0;
+    }
+
+    if(clt_cfg.adaptive && (clt_cfg.procs > 1 || clt_cfg.autotune || clt_cfg.compare || clt_cfg.knee_slo_us > 0))
+    {
+        printf("\nError: --adaptive runs in a single process, on its own.\n\n");
+        return 0;
+    }
+
+    if(clt_cfg.series != NULL && clt_cfg.procs > 1)
+    {
+        printf("\nError: --series runs in a single process.\n\n");
+        return 0;
+    }
+
+    if(clt_cfg.integrity && clt_cfg.kv)
+    {
+        printf("\nError: --integrity checks echoes, it can't be used with --kv.\n\n");
+        return 0;
+    }
+
+    if(clt_cfg.warmup_secs > 0 || clt_cfg.cooldown_secs > 0)
+        printf("- Warm-up %d s, measuring %d s, cool-down %d s\n",
+               clt_cfg.warmup_secs, clt_cfg.run_secs, clt_cfg.cooldown_secs);
+
+    if(clt_cfg.integrity)
+    {
+        verify_init();
+        printf("- Integrity checks on, CRC32C (%s)\n", verify_impl());
+    }
+
+    clt_cfg.quiet = clt_cfg.idle > 0;
+
+    return 1;
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   void print_nw_struct(struct clt_nw_var nw)
-|                   nw : client network variables struct to print
+|   FUNCTION:   int valid_args(int arg, char *port, char *clients)
+|                   arg   : number of cmd args
+|                   *port : port arg
+|                   *clients : number of clients arg
 |
-|   RETURN:     void
+|   RETURN:     1 on true, 0 on false
 |
 |   DATE:       Feb 13, 2018
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Funcion used for testing. Simply prints the contents of 'nw'
+|   DESC:       Checks for valid arguments (valid number of args, port and
+|               number of clients). Returns true (1) if args are valid,
+|               otherwise returns false (0).
 ------------------------------------------------------------------------------*/
-void print_nw_struct(struct clt_nw_var nw)
+int valid_args(int arg, char *port, char *clients)
 {
-    printf("\nsock: %d\nport: %d\nip: %lu\n\n", nw.sd, nw.h_port, nw.h_ip);
+    // check valid number of args (4)
+    if(arg != ARGSNUM)
+    {
+        print_usage();
+        return 0;
+    }
+
+    // check for valid port
+    for(int i = 0; port[i] != '\0'; i++)
+    {
+        if(!isdigit(port[i]))
+        {
+            printf("\nError: Invalid port: %s.\n\n", port);
+            return 0;
+        }
+    }
+
+    // check for valid num of clients
+    for(int i = 0; clients[i] != '\0'; i++)
+    {
+        if(!isdigit(clients[i]))
+        {
+            printf("\nError: Invalid number of clients: %s.\n\n", clients);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int connect_to_host(struct clt_nw_var *nw)
+|                   *nw : pointer to clients network variables
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Feb 13, 2018
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       High level function that connects the client program to a host
+|               machine. Uses variables held in '*nw' to create a socket and
+|               connect the socket to a host machine. The time the handshake
+|               takes is recorded in the client's connect histogram and a
+|               failure is classified instead of just being printed.
+------------------------------------------------------------------------------*/
+int connect_to_host(struct clt_nw_var *nw)
+{
+    struct connect_stats *_cs = &conn_stats[omp_get_thread_num()];
+    uint64_t _t;
+
+    if(clt_cfg.unix_path != NULL)
+        return connect_unix(nw);
+
+    if(create_socket(&(nw->sd), AF_INET, SOCK_STREAM, 0) == -1)
+        return -1;
+
+    if(clt_cfg.churn > 0)
+        set_reuseaddr(nw->sd);
+
+    apply_conn_profile(nw->sd, clt_cfg.profile, 1);
+
+    if(nw->l_port != 0 || nw->l_ip != 0)
+    {
+        struct sockaddr_in _local;
+        int _on = 1;
+
+        // source address only, the port is picked at connect() time so the
+        // same port can be reused towards different source addresses
+        if(nw->l_port == 0)
+            setsockopt(nw->sd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &_on, sizeof(_on));
+
+        bzero((char *)&_local, sizeof(_local));
+        fill_addr(&_local, AF_INET, htons(nw->l_port), nw->l_ip != 0 ? nw->l_ip : htonl(INADDR_ANY));
+        if(bind(nw->sd, (struct sockaddr *)&_local, sizeof(_local)) == -1)
+        {
+            classify_connect_error(_cs, errno);
+            close(nw->sd);
+            return -1;
+        }
+    }
+
+    bzero((char *)&(nw->h_addr), sizeof(struct sockaddr_in));
+    fill_addr(&(nw->h_addr), AF_INET, nw->h_port, nw->h_ip);
+
+    _t = now_ns();
+    if(connect_socket_timeout(nw->sd, (struct sockaddr *)&(nw->h_addr), sizeof(nw->h_addr),
+                              clt_cfg.connect_timeout) == -1)
+    {
+        classify_connect_error(_cs, errno);
+        if(!clt_cfg.quiet)
+            printf("\tClient %d error connecting: %s\n", omp_get_thread_num(), strerror(errno));
+        close(nw->sd);
+        return -1;
+    }
+
+    hist_add(&_cs->lat, now_ns() - _t);
+    _cs->ok++;
+    __sync_fetch_and_add(&clt_active, 1);
+    if(!clt_cfg.quiet)
+        printf("- Client %d: Connected to host\n", omp_get_thread_num());
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int connect_unix(struct clt_nw_var *nw)
+|                   *nw : clients network variables
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Connects to the server's unix domain socket (stream or
+|               seqpacket). Timing and failure classification are the same as
+|               for tcp connects; tcp socket options do not apply.
+------------------------------------------------------------------------------*/
+int connect_unix(struct clt_nw_var *nw)
+{
+    struct connect_stats *_cs = &conn_stats[omp_get_thread_num()];
+    struct sockaddr_un _addr;
+    uint64_t _t;
+
+    if(fill_unix_addr(&_addr, clt_cfg.unix_path) == -1)
+        return -1;
+
+    if(create_socket(&(nw->sd), AF_UNIX, clt_cfg.unix_type, 0) == -1)
+        return -1;
+
+    _t = now_ns();
+    if(connect_socket_timeout(nw->sd, (struct sockaddr *)&_addr, sizeof(_addr),
+                              clt_cfg.connect_timeout) == -1)
+    {
+        classify_connect_error(_cs, errno);
+        if(!clt_cfg.quiet)
+            printf("\tClient %d error connecting: %s\n", omp_get_thread_num(), strerror(errno));
+        close(nw->sd);
+        return -1;
+    }
+
+    hist_add(&_cs->lat, now_ns() - _t);
+    _cs->ok++;
+    __sync_fetch_and_add(&clt_active, 1);
+    if(!clt_cfg.quiet)
+        printf("- Client %d: Connected to %s\n", omp_get_thread_num(), clt_cfg.unix_path);
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int send_loop(struct clt_nw_var nw, struct clt_run *run)
+|                   nw   : clients network variables
+|                   *run : client's state accumulated over its connections
+|
+|   RETURN:     0 once the run is over or the server shut down, 1 when the
+|               connection did its --churn requests, -1 on failure
+|
+|   DATE:       Feb 13, 2018
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Function to initiate send loop. Clients keeps sending a packet
+|               of PKTSIZE and reading the echo from the server until the end
+|               of the cool-down (or, in churn mode, until the connection has
+|               done its requests). Only requests completing inside the
+|               measurement window are counted in the results; the time series
+|               gets them all. In kv mode every packet is a freshly built
+|               GET/SET/DEL request and the response status is checked. In
+|               integrity mode every packet is a new checksummed frame and
+|               the echo is verified. With --adaptive every request first
+|               takes an in-flight slot and hands its round trip back with
+|               it. The socket is always closed before returning.
+------------------------------------------------------------------------------*/
+int send_loop(struct clt_nw_var nw, struct clt_run *run)
+{
+    char _send_buff[PKTSIZE];
+    char _recv_buff[PKTSIZE];
+    uint64_t _t1, _t2;
+    int _bytes_recv;
+    int _bytes_sent;
+    int _requests = 0;
+    int _held = 0;
+    int _ret = 0;
+
+    memset(_send_buff, 'A', PKTSIZE);
+
+    // send loop (until the end of the cool-down)
+    while(1)
+    {
+        if(clt_cfg.adaptive)
+        {
+            if(adapt_acquire(clt_cfg.run_end) == -1)
+                break;  // run ended while waiting for a slot
+            _held = 1;
+        }
+
+        if(clt_cfg.kv)
+            build_kv_request(_send_buff, &run->rng, &run->kv);
+        else if(clt_cfg.integrity)
+            verify_fill(_send_buff, PKTSIZE, clt_cfg.client_base + omp_get_thread_num(), ++run->seq);
+
+        _t1 = now_ns(); // start timer
+
+        // send oacket
+        if ((_bytes_sent = send(nw.sd, _send_buff, PKTSIZE, MSG_NOSIGNAL)) == -1)
+        {
+            if(_requests == 0)
+                conn_stats[omp_get_thread_num()].resets++;
+            printf("\tError sending\n");
+      	    printf("\tError code: %s\n\n", strerror(errno));
+            _ret = -1;
+            break;
+        }
+
+        _requests++;
+
+        // read echo
+        if((_bytes_recv = recv(nw.sd, _recv_buff, PKTSIZE, MSG_WAITALL)) <= 0
+           && _requests == 1)  // dropped before first echo (e.g. backlog overflow)
+            conn_stats[omp_get_thread_num()].resets++;
+        rearm_quickack(nw.sd, clt_cfg.profile);
+
+        if(_bytes_recv == -1)
+        {
+            printf("\tClient %d error reading\n", omp_get_thread_num());
+      	    printf("\tError code: %s\n\n", strerror(errno));
+            _ret = -1;
+            break;
+        }
+        else if(_bytes_recv == 0) // server shutdown
+        {
+            printf("\nServer shutdown\n\n");
+            break;
+        }
+
+        if(clt_cfg.integrity && check_echo(_recv_buff, _bytes_recv, run) == -1)
+        {
+            _ret = -1;
+            break;
+        }
+        if(clt_cfg.kv)
+            check_kv_response(_recv_buff, &run->kv);
+
+        _t2 = now_ns(); // stop timer
+        series_add(_bytes_recv, _t2 - _t1);
+        if(_held)
+        {
+            adapt_release(_t2 - _t1);
+            _held = 0;
+        }
+
+        // only the measurement window counts
+        if(_t2 >= clt_cfg.measure_start && _t2 < clt_cfg.measure_end)
+        {
+            run->stats.requests++; // update client requests
+            update_bytes_struct(&run->stats.bytes, _bytes_recv);
+            run->total_time += (_t2 - _t1) / 1e6;   // in milliseconds
+            hist_add(&conn_stats[omp_get_thread_num()].rtt, _t2 - _t1);
+        }
+
+        // check for end of run
+        if(_t2 >= clt_cfg.run_end)
+            break;
+
+        if(clt_cfg.churn > 0 && _requests == clt_cfg.churn)
+        {
+            _ret = 1;
+            break;
+        }
+    }
+
+    if(_held)
+        adapt_release(0);   // failed request, slot back without a sample
+
+    if(clt_cfg.churn > 0)
+        set_linger(nw.sd, 0);   // reset on close, no TIME_WAIT
+    close(nw.sd);
+    __sync_fetch_and_sub(&clt_active, 1);
+
+    return _ret;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int check_echo(const char *buff, int len, struct clt_run *run)
+|                   *buff : echo received
+|                   len   : bytes received
+|                   *run  : client's state (sequence number just sent)
+|
+|   RETURN:     0 if the connection can go on, -1 after a short echo (the
+|               stream is out of step)
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Verifies an integrity mode echo and counts the outcome. The
+|               first VERIFY_REPORTS bad echoes of a client are described.
+------------------------------------------------------------------------------*/
+int check_echo(const char *buff, int len, struct clt_run *run)
+{
+    struct connect_stats *_cs = &conn_stats[omp_get_thread_num()];
+    uint64_t _stream = clt_cfg.client_base + omp_get_thread_num();
+    int _bad = _cs->corrupt + _cs->misordered + _cs->short_echoes;
+
+    if(len < PKTSIZE)
+    {
+        _cs->short_echoes++;
+        if(_bad < VERIFY_REPORTS)
+            printf("\tClient %d: short echo of request %llu (%d of %d bytes)\n", omp_get_thread_num(),
+                   (unsigned long long)run->seq, len, PKTSIZE);
+        return -1;
+    }
+
+    switch(verify_check(buff, len, _stream, run->seq))
+    {
+        case VERIFY_OK:
+            _cs->verified++;
+            break;
+        case VERIFY_CORRUPT:
+            _cs->corrupt++;
+            if(_bad < VERIFY_REPORTS)
+                printf("\tClient %d: echo of request %llu corrupted from byte %d\n", omp_get_thread_num(),
+                       (unsigned long long)run->seq, verify_first_diff(buff, len, _stream, run->seq));
+            break;
+        case VERIFY_MISORDERED:
+            _cs->misordered++;
+            if(_bad < VERIFY_REPORTS)
+                printf("\tClient %d: got request %llu of client %llu back instead of request %llu\n",
+                       omp_get_thread_num(), (unsigned long long)((struct verify_hdr *)buff)->seq,
+                       (unsigned long long)((struct verify_hdr *)buff)->stream, (unsigned long long)run->seq);
+            break;
+    }
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int build_kv_request(char *buff, uint64_t *rng, struct kv_counts *counts)
+|                   *buff   : PKTSIZE send buffer to encode the request into
+|                   *rng    : client's random state
+|                   *counts : client's kv operation counts
+|
+|   RETURN:     op of the request built
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Picks the operation from the read/write mix and the key from
+|               the configured distribution, then encodes the request.
+------------------------------------------------------------------------------*/
+int build_kv_request(char *buff, uint64_t *rng, struct kv_counts *counts)
+{
+    char _key[KV_MAXKEY];
+    int _klen, _op;
+
+    _klen = snprintf(_key, sizeof(_key), "key:%llu",
+                     (unsigned long long)keydist_next(&clt_cfg.keys, rng));
+
+    if(rand_unit(rng) < clt_cfg.read_ratio)
+    {
+        _op = KV_GET;
+        counts->gets++;
+    }
+    else if(rand_unit(rng) < clt_cfg.del_ratio)
+    {
+        _op = KV_DEL;
+        counts->dels++;
+    }
+    else
+    {
+        _op = KV_SET;
+        counts->sets++;
+    }
+
+    kv_encode(buff, _op, _key, _klen, kv_value, clt_cfg.vlen);
+    return _op;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void check_kv_response(char *buff, struct kv_counts *counts)
+|                   *buff   : response received from the server
+|                   *counts : client's kv operation counts
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Counts misses and errors reported in the response header.
+------------------------------------------------------------------------------*/
+void check_kv_response(char *buff, struct kv_counts *counts)
+{
+    struct kv_hdr _hdr;
+
+    memcpy(&_hdr, buff, sizeof(_hdr));
+    if(_hdr.status == KV_NOTFOUND)
+        counts->misses++;
+    else if(_hdr.status != KV_OK)
+        counts->errors++;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void spawn_clients(char *ip, char *port)
+|                   *ip : cmd arg that holds the servers IP
+|                   *port : cmd arg that holds teh servers listening port
+|
+|   RETURN:     void
+|
+|   DATE:       Feb 13, 2018
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       high level function that is called by openmp. connects to a host
+|               specified by '*ip' and '*port' once the client's ramp slot has
+|               come up. Once connected it calls the send_loop function in
+|               order to initiate data transfer. The ramp slots count from a
+|               first barrier; the phases of the run are laid out at a second
+|               one, once every client has made its first connect. Every
+|               client reaches both barriers, whether its connect worked or
+|               not.
+------------------------------------------------------------------------------*/
+void spawn_clients(char *ip, char *port)
+{
+    struct clt_nw_var _nw;
+    struct clt_run _run;
+    time_t _t;
+    int _ret, _ok, _connected = 0;
+    int _backoff = CHURN_BACKOFF;
+
+    get_host_info(&_nw, ip, port);
+
+    memset(&_run, 0, sizeof(_run));
+    _run.rng = 0x9e3779b97f4a7c15ull ^ ((uint64_t)(clt_cfg.client_base + omp_get_thread_num()) << 32 | (uint64_t)now_ns());
+    init_bytes_struct(&(_run.stats.bytes));
+
+    // every client thread is up, the ramp starts now
+    #pragma omp barrier
+    #pragma omp single
+    clt_cfg.start_ns = now_ns();
+
+    wait_ramp_slot(clt_cfg.client_base + omp_get_thread_num());
+
+    if((_ok = open_idle(_nw, &_run)) == 0)
+    {
+        _t = time(NULL);
+        _run.stats.tm = *localtime(&_t);    // time of first connection
+        _nw.l_port = next_local_port(&_run);
+        _nw.l_ip = next_local_addr(&_run);
+        _connected = connect_to_host(&_nw) == 0;
+    }
+
+    // every client has connected (or failed to), start the clock for all
+    #pragma omp barrier
+    #pragma omp single
+    {
+        wait_connected();
+        set_phases(now_ns());
+    }
+
+    if(_ok == -1)
+        return;
+
+    // one connection, or a new one every --churn requests until the run ends
+    while(1)
+    {
+        if(_connected)
+            _ret = send_loop(_nw, &_run);
+        else
+            _ret = clt_cfg.churn > 0 ? 1 : -1;
+
+        if(_ret != 1 || now_ns() >= clt_cfg.run_end)
+            break;
+
+        if(_connected)
+            _backoff = CHURN_BACKOFF;
+        else
+            churn_backoff(&_backoff);
+
+        _nw.l_port = next_local_port(&_run);
+        _nw.l_ip = next_local_addr(&_run);
+        _connected = connect_to_host(&_nw) == 0;
+    }
+
+    close_idle(&_run);
+    conn_stats[omp_get_thread_num()].requests = _run.stats.requests;
+    if(_run.stats.requests == 0)
+        return;
+
+    printf("- Client %d: Disconnecting\n", omp_get_thread_num());
+    if(clt_cfg.kv)
+        printf("- Client %d: GET %d (%d miss) SET %d DEL %d ERR %d\n", omp_get_thread_num(),
+               _run.kv.gets, _run.kv.misses, _run.kv.sets, _run.kv.dels, _run.kv.errors);
+    append_clt_data(_run.stats, _run.total_time / _run.stats.requests);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void set_phases(uint64_t t0)
+|                   t0 : start of the run
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Lays out warm-up, measurement window and cool-down from 't0'.
+|               Called by one client thread once all of them have connected
+|               (and by the --procs coordinator, to know the window too).
+------------------------------------------------------------------------------*/
+void set_phases(uint64_t t0)
+{
+    clt_cfg.measure_start = t0 + clt_cfg.warmup_secs * 1000000000ull;
+    clt_cfg.measure_end = clt_cfg.measure_start + clt_cfg.run_secs * 1000000000ull;
+    clt_cfg.run_end = clt_cfg.measure_end + clt_cfg.cooldown_secs * 1000000000ull;
+    if(clt_cfg.adaptive)
+        adapt_window(clt_cfg.measure_start, clt_cfg.measure_end);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   double measured_secs()
+|
+|   RETURN:     length of the measurement window so far (s)
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Whole window once it has ended, less if the run stopped early
+|               (e.g. the server shut down). Rates are requests over this.
+------------------------------------------------------------------------------*/
+double measured_secs()
+{
+    uint64_t _end = now_ns();
+
+    if(_end > clt_cfg.measure_end)
+        _end = clt_cfg.measure_end;
+    if(_end <= clt_cfg.measure_start)
+        return 1e-9;
+
+    return (_end - clt_cfg.measure_start) / 1e9;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void wait_ramp_slot(int client)
+|                   client : client (thread) number
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Sleeps until this client is allowed to connect. With --ramp
+|               client i connects i/RATE seconds after the start, with --steps
+|               N:MS clients connect N at a time every MS milliseconds.
+------------------------------------------------------------------------------*/
+void wait_ramp_slot(int client)
+{
+    uint64_t _at = clt_cfg.start_ns, _now;
+    struct timespec _ts;
+
+    if(clt_cfg.ramp_rate > 0)
+        _at += (uint64_t)(client / clt_cfg.ramp_rate * 1e9);
+    else if(clt_cfg.step_size > 0)
+        _at += (uint64_t)(client / clt_cfg.step_size) * clt_cfg.step_ms * 1000000ull;
+    else
+        return;
+
+    if((_now = now_ns()) >= _at)
+        return;
+
+    _ts.tv_sec = (_at - _now) / 1000000000ull;
+    _ts.tv_nsec = (_at - _now) % 1000000000ull;
+    while(nanosleep(&_ts, &_ts) == -1 && errno == EINTR)
+        ;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void churn_backoff(int *backoff)
+|                   *backoff : ms to wait, doubled for the next failure
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Called in churn mode after a failed connect. Sleeps for
+|               '*backoff' ms, or until the end of the run if that is sooner,
+|               and doubles the wait up to CHURN_MAXBACKOFF. The caller resets
+|               it to CHURN_BACKOFF once a connect works.
+------------------------------------------------------------------------------*/
+void churn_backoff(int *backoff)
+{
+    uint64_t _wait = *backoff * 1000000ull, _now = now_ns();
+    struct timespec _ts;
+
+    if(_now >= clt_cfg.run_end)
+        return;
+    if(_wait > clt_cfg.run_end - _now)
+        _wait = clt_cfg.run_end - _now;
+
+    _ts.tv_sec = _wait / 1000000000ull;
+    _ts.tv_nsec = _wait % 1000000000ull;
+    while(nanosleep(&_ts, &_ts) == -1 && errno == EINTR)
+        ;
+
+    if((*backoff *= 2) > CHURN_MAXBACKOFF)
+        *backoff = CHURN_MAXBACKOFF;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int next_local_port(struct clt_run *run)
+|                   *run : client's run state
+|
+|   RETURN:     local port to bind the next connection to, 0 to let the kernel
+|               pick one
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Splits the --ports range evenly between the clients and walks
+|               each client through its own slice, so clients never compete
+|               for the same local port.
+------------------------------------------------------------------------------*/
+int next_local_port(struct clt_run *run)
+{
+    int _slice, _lo;
+
+    if(clt_cfg.port_lo == 0)
+        return 0;
+
+    _slice = (clt_cfg.port_hi - clt_cfg.port_lo + 1) / clt_cfg.clients;
+    _lo = clt_cfg.port_lo + (clt_cfg.client_base + omp_get_thread_num()) * _slice;
+
+    run->next_port = (run->next_port + 1) % _slice;
+    return _lo + run->next_port;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   in_addr_t next_local_addr(struct clt_run *run)
+|                   *run : client's run state
+|
+|   RETURN:     local address (network order) to bind the next connection to,
+|               0 to let the kernel pick one
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Walks the connections of a client round-robin over the
+|               --src-spread loopback addresses 127.0.0.1-127.0.0.N, starting
+|               at the client's own offset so clients don't all pile onto
+|               127.0.0.1 first.
+------------------------------------------------------------------------------*/
+in_addr_t next_local_addr(struct clt_run *run)
+{
+    int _k;
+
+    if(clt_cfg.src_spread == 0)
+        return 0;
+
+    _k = (clt_cfg.client_base + omp_get_thread_num() + run->next_src++) % clt_cfg.src_spread;
+    return htonl(INADDR_LOOPBACK + _k);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int open_idle(struct clt_nw_var nw, struct clt_run *run)
+|                   nw   : clients network variables (host to connect to)
+|                   *run : client's run state, holds the idle sockets
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Opens the client's --idle connections. They never send; they
+|               only exist to grow the server's connection count. Failed
+|               connects are classified like any other and don't stop the
+|               client, so the connect report shows where a limit was hit.
+------------------------------------------------------------------------------*/
+int open_idle(struct clt_nw_var nw, struct clt_run *run)
+{
+    if(clt_cfg.idle == 0)
+        return 0;
+
+    if((run->idle = malloc(clt_cfg.idle * sizeof(int))) == NULL)
+    {
+        printf("\tError allocating idle connections\n");
+        printf("\tError code: %s\n\n", strerror(errno));
+        return -1;
+    }
+
+    for(int i = 0; i < clt_cfg.idle; i++)
+    {
+        nw.l_port = next_local_port(run);
+        nw.l_ip = next_local_addr(run);
+        if(connect_to_host(&nw) == 0)
+            run->idle[run->nidle++] = nw.sd;
+    }
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void close_idle(struct clt_run *run)
+|                   *run : client's run state
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Closes the client's idle connections once its run is over.
+------------------------------------------------------------------------------*/
+void close_idle(struct clt_run *run)
+{
+    for(int i = 0; i < run->nidle; i++)
+        close(run->idle[i]);
+    __sync_fetch_and_sub(&clt_active, run->nidle);
+
+    free(run->idle);
+    run->idle = NULL;
+    run->nidle = 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void check_port_range()
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Prints the kernel's ephemeral port range used for churn
+|               connections when no --ports range is given, and warns when it
+|               is small compared to the number of clients.
+------------------------------------------------------------------------------*/
+void check_port_range()
+{
+    FILE *_f;
+    int _lo, _hi;
+
+    if(clt_cfg.port_lo > 0)
+    {
+        printf("- Local port range: %d-%d (explicit)\n", clt_cfg.port_lo, clt_cfg.port_hi);
+        return;
+    }
+
+    if((_f = fopen("/proc/sys/net/ipv4/ip_local_port_range", "r")) == NULL)
+        return;
+
+    if(fscanf(_f, "%d %d", &_lo, &_hi) == 2)
+    {
+        printf("- Local port range: %d-%d (%d ports)\n", _lo, _hi, _hi - _lo + 1);
+        if(_hi - _lo + 1 < 16 * clt_cfg.clients)
+            printf("\tWarning: small ephemeral port range, consider --ports LO-HI\n");
+    }
+    fclose(_f);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void classify_connect_error(struct connect_stats *cs, int err)
+|                   *cs : client's connect stats
+|                   err : errno of the failed connect
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Counts a failed connect under its failure class. A full listen
+|               backlog usually shows up as a timeout (SYN dropped) or as a
+|               reset (tcp_abort_on_overflow, or a reset before the first echo
+|               counted by send_loop).
+------------------------------------------------------------------------------*/
+void classify_connect_error(struct connect_stats *cs, int err)
+{
+    if(err == ECONNREFUSED)
+        cs->refused++;
+    else if(err == ETIMEDOUT)
+        cs->timeouts++;
+    else if(err == ECONNRESET)
+        cs->resets++;
+    else
+        cs->other++;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void merge_connect_stats(struct connect_stats *dst,
+|                                        const struct connect_stats *src)
+|                   *dst : stats to add to
+|                   *src : stats to add
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Adds the histograms and counters of 'src' to 'dst'.
+------------------------------------------------------------------------------*/
+void merge_connect_stats(struct connect_stats *dst, const struct connect_stats *src)
+{
+    hist_merge(&dst->lat, &src->lat);
+    hist_merge(&dst->rtt, &src->rtt);
+    dst->ok += src->ok;
+    dst->refused += src->refused;
+    dst->timeouts += src->timeouts;
+    dst->resets += src->resets;
+    dst->other += src->other;
+    dst->requests += src->requests;
+    dst->verified += src->verified;
+    dst->corrupt += src->corrupt;
+    dst->misordered += src->misordered;
+    dst->short_echoes += src->short_echoes;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void report_connect_stats(const struct connect_stats *stats, int n)
+|                   *stats : array of per client (or per process) stats
+|                   n      : number of entries in 'stats'
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Merges the stats and prints the summary, connection and
+|               request rates and the connect and request latency histograms
+|               to stdout and the client log file.
+------------------------------------------------------------------------------*/
+void report_connect_stats(const struct connect_stats *stats, int n)
+{
+    struct connect_stats _total;
+    FILE *_out[2] = {stdout, NULL};
+    double _secs = measured_secs();
+
+    memset(&_total, 0, sizeof(_total));
+    hist_init(&_total.lat);
+    hist_init(&_total.rtt);
+    for(int i = 0; i < n; i++)
+        merge_connect_stats(&_total, &stats[i]);
+
+    pthread_mutex_lock(&lock);
+    _out[1] = fopen(CLTLOGFILE, "a");
+    for(int i = 0; i < 2 && _out[i] != NULL; i++)
+    {
+        fprintf(_out[i], "\nConnects: %d ok, %d refused, %d timed out, %d reset, %d other\n",
+                _total.ok, _total.refused, _total.timeouts, _total.resets, _total.other);
+        fprintf(_out[i], "Rates: %.1f connections/sec, %.1f requests/sec over %.1f sec\n",
+                _total.ok / _secs, _total.requests / _secs, _secs);
+        if(clt_cfg.integrity)
+            fprintf(_out[i], "Integrity: %ld echoes verified, %ld corrupted, %ld misordered, %ld short\n",
+                    _total.verified, _total.corrupt, _total.misordered, _total.short_echoes);
+        if(clt_cfg.adaptive)
+            adapt_report(_out[i], _secs);
+        hist_print(_out[i], "Connect latency", &_total.lat, 1);
+        hist_print(_out[i], "Request latency", &_total.rtt, 0);
+    }
+    if(_out[1] != NULL)
+        fclose(_out[1]);
+    pthread_mutex_unlock(&lock);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void get_host_info(struct clt_nw_var *nw, char *ip, char *port)
+|                   *nw : pointer to clients network variables
+|                   *ip : cmd arg that hold the servers IP
+|                   *port : cmd arg that holds the servers listening port
+|
+|   RETURN:     void
+|
+|   DATE:       Feb 13, 2018
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Copies the cmd args holding the servers ip and listening port
+|               ('*ip' and '*port' respectivly) into the appropriate fields
+|               of the clients network data struct pointed to by '*nw'.
+------------------------------------------------------------------------------*/
+void get_host_info(struct clt_nw_var *nw, char *ip, char *port)
+{
+    nw->h_ip = inet_addr(ip);
+    nw->h_port = htons(atoi(port));
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void print_nw_struct(struct clt_nw_var nw)
+|                   nw : client network variables struct to print
+|
+|   RETURN:     void
+|
+|   DATE:       Feb 13, 2018
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Funcion used for testing. Simply prints the contents of 'nw'
+------------------------------------------------------------------------------*/
+void print_nw_struct(struct clt_nw_var nw)
+{
+    printf("\nsock: %d\nport: %d\nip: %lu\n\n", nw.sd, nw.h_port, nw.h_ip);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void print_usage()
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Prints the usage message.
+------------------------------------------------------------------------------*/
+void print_usage()
+{
+    printf("\nUsage: ./clt [OPTIONS] <HOST IP> <PORT> <NUM OF CLIENTS>\n\n");
+    printf("  -k, --kv                  send key-value requests instead of echo\n");
+    printf("      --keys N              key space (default %d)\n", DEFKEYS);
+    printf("      --dist uniform|zipf[:S]  key distribution (default uniform, S %.2f)\n", DEFZIPF);
+    printf("      --reads R             fraction of requests that are GETs (default 0.9)\n");
+    printf("      --dels R              fraction of writes that are DELs (default 0)\n");
+    printf("      --vlen N              SET value size (default %d)\n", DEFVLEN);
+    printf("      --ramp RATE           connect RATE clients per second\n");
+    printf("      --steps N:MS          connect N clients every MS milliseconds\n");
+    printf("      --connect-timeout MS  connect timeout (default %d)\n", DEFCONNTIMEOUT);
+    printf("      --churn K             reconnect after every K requests\n");
+    printf("      --ports LO-HI         bind connections to local ports LO-HI\n");
+    printf("      --procs P             split clients over P pinned processes\n");
+    printf("      --profile NAME        socket options (default default)\n");
+    printf("      --autotune            benchmark every profile for %d sec each\n", AUTOTUNE_SECS);
+    printf("      --unix PATH           connect to a unix stream socket (HOST IP and\n");
+    printf("                            PORT are then only used by --compare)\n");
+    printf("      --seqpacket PATH      connect to a unix seqpacket socket\n");
+    printf("      --compare             benchmark tcp against the unix socket\n");
+    printf("      --idle M              each client also holds M idle connections\n");
+    printf("      --src-spread N        bind connections to 127.0.0.1-127.0.0.N\n");
+    printf("      --integrity           send checksummed, numbered frames and verify\n");
+    printf("                            every echo\n");
+    printf("      --series PATH         write requests/sec, bytes/sec, connections\n");
+    printf("                            and latency every interval as CSV (JSON lines\n");
+    printf("                            if PATH ends in .json, - for stdout)\n");
+    printf("      --interval MS         time series period (default %d)\n", DEFINTERVAL);
+    printf("      --duration S          measurement window (default %d)\n", TIMEOUT);
+    printf("      --warmup S            send for S seconds before the window\n");
+    printf("      --cooldown S          keep sending S seconds after the window\n");
+    printf("      --find-knee US        find the most clients (up to NUM OF CLIENTS)\n");
+    printf("                            served with p99 <= US and no errors\n");
+    printf("      --adaptive aimd|gradient  limit requests in flight (up to NUM OF\n");
+    printf("                            CLIENTS) by round trip time\n\n");
+    printf("Socket profiles:\n");
+    for(int i = 0; profile_at(i) != NULL; i++)
+        printf("  %-10s %s\n", profile_at(i)->name, profile_at(i)->desc);
+    printf("\n");
 }
@@ -0,0 +1,164 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     deque.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that implements the Chase-Lev work-stealing deque, with
+|               the memory orderings of Le et al. ("Correct and Efficient
+|               Work-Stealing for Weak Memory Models", PPoPP 2013). The owning
+|               thread pushes and takes at the bottom without locks (LIFO, so
+|               it keeps working on what it touched last); other threads steal
+|               the oldest item from the top with a single CAS. Only a take
+|               racing a steal for the last item needs the CAS on the owner
+|               side.
+|
+|               The deque does not grow: its users bound how much they push
+|               (one epoll batch) and deque_push() reports a full deque.
+------------------------------------------------------------------------------*/
+#include "../include/deque.h"
+#include <string.h>
+
+/* ---- Macros ---- */
+#define MASK (DEQUESIZE - 1)
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void deque_init(struct ws_deque *d)
+|                   *d : deque to initialize
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Empties a deque.
+------------------------------------------------------------------------------*/
+void deque_init(struct ws_deque *d)
+{
+    memset(d, 0, sizeof *d);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int deque_push(struct ws_deque *d, void *item)
+|                   *d    : deque owned by the caller
+|                   *item : item to push (not NULL or DEQUE_ABORT)
+|
+|   RETURN:     0 on success, -1 if the deque is full
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Owner only. Pushes an item at the bottom and publishes it to
+|               thieves with a release fence.
+------------------------------------------------------------------------------*/
+int deque_push(struct ws_deque *d, void *item)
+{
+    long _b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    long _t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+
+    if(_b - _t >= DEQUESIZE)
+        return -1;
+
+    __atomic_store_n(&d->slots[_b & MASK], item, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&d->bottom, _b + 1, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void *deque_take(struct ws_deque *d)
+|                   *d : deque owned by the caller
+|
+|   RETURN:     newest item, DEQUE_EMPTY if there is none
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Owner only. Reserves the bottom item, then checks whether a
+|               thief got there first; only the last item is contended.
+------------------------------------------------------------------------------*/
+void *deque_take(struct ws_deque *d)
+{
+    long _b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+    long _t;
+    void *_item;
+
+    __atomic_store_n(&d->bottom, _b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    _t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+
+    if(_t > _b)     // empty
+    {
+        __atomic_store_n(&d->bottom, _b + 1, __ATOMIC_RELAXED);
+        return DEQUE_EMPTY;
+    }
+
+    _item = __atomic_load_n(&d->slots[_b & MASK], __ATOMIC_RELAXED);
+    if(_t == _b)    // last item, race the thieves for it
+    {
+        if(!__atomic_compare_exchange_n(&d->top, &_t, _t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            _item = DEQUE_EMPTY;
+        __atomic_store_n(&d->bottom, _b + 1, __ATOMIC_RELAXED);
+    }
+
+    return _item;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void *deque_steal(struct ws_deque *d)
+|                   *d : another thread's deque
+|
+|   RETURN:     oldest item, DEQUE_EMPTY if there is none, DEQUE_ABORT if
+|               another thread won the race for it
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Any thread. Takes the top item by advancing top with a CAS.
+------------------------------------------------------------------------------*/
+void *deque_steal(struct ws_deque *d)
+{
+    long _t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    long _b;
+    void *_item;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    _b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+
+    if(_t >= _b)
+        return DEQUE_EMPTY;
+
+    _item = __atomic_load_n(&d->slots[_t & MASK], __ATOMIC_RELAXED);
+    if(!__atomic_compare_exchange_n(&d->top, &_t, _t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return DEQUE_ABORT;
+
+    return _item;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   long deque_size(struct ws_deque *d)
+|                   *d : deque
+|
+|   RETURN:     number of items (a snapshot when read by another thread)
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Returns how many items the deque holds.
+------------------------------------------------------------------------------*/
+long deque_size(struct ws_deque *d)
+{
+    long _n = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+
+    return _n > 0 ? _n : 0;
+}
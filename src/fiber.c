@@ -0,0 +1,368 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     fiber.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that provides fibers: cooperative user-space threads
+|               that run blocking-style code without an OS thread each. Every
+|               fiber gets a small mmap'd stack with a PROT_NONE guard region
+|               below it and finished fibers keep their stack in a pool for the
+|               next one. Switching is a hand-rolled x86-64 routine that only
+|               saves the callee-saved registers and swaps stack pointers, so
+|               it costs a few nanoseconds instead of a kernel round trip.
+|               Being x86-64 only, this file and the fiber backend are only
+|               built for that target (see the makefile).
+|
+|               Each thread owns one scheduler. A fiber runs until it parks
+|               (fiber_park); whoever owns the event it waits for puts it back
+|               on the ready queue with fiber_ready(). Fibers never move
+|               between threads.
+------------------------------------------------------------------------------*/
+#include "../include/fiber.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#if !defined(__x86_64__)
+#error "fiber.c switches contexts in x86-64 assembly"
+#endif
+
+/* ---- Macros ---- */
+#define SAVED_REGS 7        // rbp rbx r12 r13 r14 r15, MXCSR + x87 control word
+
+/* --- Global ---- */
+static __thread struct fiber_sched *fiber_cur_sched = NULL;
+
+/*
+ * void fiber_switch(void **save_sp, void *load_sp)
+ *
+ * Pushes the callee-saved registers on the current stack, then the MXCSR
+ * and the x87 control word (callee-saved too under the SysV ABI) in one
+ * slot, stores the stack pointer in *save_sp, loads load_sp and restores
+ * what was saved there. The ret then resumes whatever called fiber_switch on
+ * that stack (or, for a new fiber, enters fiber_entry). Caller-saved
+ * registers are already dead across the call, so nothing else needs saving.
+ */
+__asm__(
+    ".text\n"
+    ".globl fiber_switch\n"
+    ".type fiber_switch, @function\n"
+    "fiber_switch:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size fiber_switch, .-fiber_switch\n"
+);
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   static void fiber_entry()
+|
+|   RETURN:     never returns
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       First code a new fiber runs (fiber_switch 'returns' into it).
+|               Runs the fiber's body then switches back to the scheduler for
+|               good; the scheduler recycles the stack.
+------------------------------------------------------------------------------*/
+static void fiber_entry()
+{
+    struct fiber_sched *_s = fiber_cur_sched;
+    struct fiber *_f = _s->current;
+
+    _f->fn(_f->arg);
+
+    _f->done = 1;
+    fiber_switch(&_f->sp, _s->sp);
+    abort();    // a finished fiber is never switched back to
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void fiber_sched_init(struct fiber_sched *s, size_t stack_size,
+|                                     size_t guard_size)
+|                   *s         : scheduler of the calling thread
+|                   stack_size : usable stack of each fiber (bytes)
+|                   guard_size : guard region below each stack (bytes)
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Sets up an empty scheduler and makes it the calling thread's.
+|               Sizes are rounded up to whole pages.
+------------------------------------------------------------------------------*/
+void fiber_sched_init(struct fiber_sched *s, size_t stack_size, size_t guard_size)
+{
+    size_t _page = 4096;
+
+    memset(s, 0, sizeof *s);
+    s->stack_size = (stack_size + _page - 1) / _page * _page;
+    s->guard_size = (guard_size + _page - 1) / _page * _page;
+    fiber_cur_sched = s;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void fiber_sched_free(struct fiber_sched *s)
+|                   *s : scheduler to tear down
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Releases the pooled stacks and those of the fibers still
+|               alive, which never run again. Whatever those fibers held must
+|               have been released by their owner first. The counters are
+|               kept for reporting.
+------------------------------------------------------------------------------*/
+void fiber_sched_free(struct fiber_sched *s)
+{
+    struct fiber *_f;
+
+    while((_f = s->pool) != NULL)
+    {
+        s->pool = _f->next;
+        munmap(_f->stack, _f->map_size);
+        free(_f);
+    }
+    s->npool = 0;
+
+    while((_f = s->alive) != NULL)
+    {
+        s->alive = _f->live_next;
+        munmap(_f->stack, _f->map_size);
+        free(_f);
+    }
+    s->ready_head = s->ready_tail = NULL;
+    s->live = 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   struct fiber *fiber_create(struct fiber_sched *s,
+|                                          void (*fn)(void *), void *arg)
+|                   *s   : scheduler to run the fiber on
+|                   *fn  : body of the fiber
+|                   *arg : argument passed to fn
+|
+|   RETURN:     new fiber (already on the ready queue), NULL on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Takes a finished fiber from the pool (or maps a new stack with
+|               a guard region) and lays out its stack so the first switch to
+|               it enters fiber_entry with the alignment of a normal call.
+------------------------------------------------------------------------------*/
+struct fiber *fiber_create(struct fiber_sched *s, void (*fn)(void *), void *arg)
+{
+    struct fiber *_f;
+    uintptr_t *_top;
+
+    if((_f = s->pool) != NULL)
+    {
+        s->pool = _f->next;
+        s->npool--;
+    }
+    else
+    {
+        if((_f = malloc(sizeof *_f)) == NULL)
+            return NULL;
+
+        _f->map_size = s->guard_size + s->stack_size;
+        _f->stack = mmap(NULL, _f->map_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if(_f->stack == MAP_FAILED)
+        {
+            printf("\tError mapping fiber stack\n");
+            printf("\tError code: %s\n\n", strerror(errno));
+            free(_f);
+            return NULL;
+        }
+        if(s->guard_size > 0)
+            mprotect(_f->stack, s->guard_size, PROT_NONE);
+        s->stacks++;
+    }
+
+    _f->fn = fn;
+    _f->arg = arg;
+    _f->done = 0;
+    _f->waiting = 0;
+    _f->next = NULL;
+
+    // [top-8] fake return address of fiber_entry, [top-16] fiber_entry for
+    // the ret in fiber_switch, below it the six registers it pops and, at
+    // the bottom, the creator's floating point control state it loads
+    _top = (uintptr_t *)(_f->stack + _f->map_size);
+    _top[-1] = 0;
+    _top[-2] = (uintptr_t)fiber_entry;
+    memset(&_top[-2 - SAVED_REGS], 0, SAVED_REGS * sizeof(uintptr_t));
+    __asm__ volatile("stmxcsr %0" : "=m"(*(uint32_t *)&_top[-2 - SAVED_REGS]));
+    __asm__ volatile("fnstcw %0" : "=m"(*((uint16_t *)&_top[-2 - SAVED_REGS] + 2)));
+    _f->sp = &_top[-2 - SAVED_REGS];
+
+    _f->live_prev = NULL;
+    _f->live_next = s->alive;
+    if(s->alive != NULL)
+        s->alive->live_prev = _f;
+    s->alive = _f;
+
+    s->created++;
+    if(++s->live > s->peak)
+        s->peak = s->live;
+
+    fiber_ready(s, _f);
+    return _f;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void fiber_ready(struct fiber_sched *s, struct fiber *f)
+|                   *s : scheduler the fiber belongs to
+|                   *f : parked fiber to run again
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Appends a fiber to the ready queue.
+------------------------------------------------------------------------------*/
+void fiber_ready(struct fiber_sched *s, struct fiber *f)
+{
+    f->next = NULL;
+    if(s->ready_tail != NULL)
+        s->ready_tail->next = f;
+    else
+        s->ready_head = f;
+    s->ready_tail = f;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int fiber_run_ready(struct fiber_sched *s)
+|                   *s : scheduler of the calling thread
+|
+|   RETURN:     number of fibers run
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Runs every fiber that is ready right now until it parks or
+|               finishes. Fibers made ready meanwhile wait for the next call,
+|               so the caller gets to poll for events in between.
+------------------------------------------------------------------------------*/
+int fiber_run_ready(struct fiber_sched *s)
+{
+    struct fiber *_f, *_last = s->ready_tail;
+    int _ran = 0;
+
+    while((_f = s->ready_head) != NULL)
+    {
+        s->ready_head = _f->next;
+        if(s->ready_head == NULL)
+            s->ready_tail = NULL;
+
+        s->current = _f;
+        s->switches++;
+        fiber_switch(&s->sp, _f->sp);
+        s->current = NULL;
+        _ran++;
+
+        if(_f->done)
+        {
+            if(_f->live_prev != NULL)
+                _f->live_prev->live_next = _f->live_next;
+            else
+                s->alive = _f->live_next;
+            if(_f->live_next != NULL)
+                _f->live_next->live_prev = _f->live_prev;
+            s->live--;
+            if(s->npool < FIBERPOOL)
+            {
+                _f->next = s->pool;
+                s->pool = _f;
+                s->npool++;
+            }
+            else
+            {
+                munmap(_f->stack, _f->map_size);
+                free(_f);
+            }
+        }
+
+        if(_f == _last)
+            break;
+    }
+
+    return _ran;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void fiber_park()
+|
+|   RETURN:     void (once the fiber has been made ready and run again)
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Suspends the calling fiber and returns to its scheduler. The
+|               caller must have arranged for someone to fiber_ready() it.
+------------------------------------------------------------------------------*/
+void fiber_park()
+{
+    struct fiber_sched *_s = fiber_cur_sched;
+
+    fiber_switch(&_s->current->sp, _s->sp);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   struct fiber *fiber_self()
+|
+|   RETURN:     fiber running on the calling thread, NULL outside of fibers
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Returns the running fiber.
+------------------------------------------------------------------------------*/
+struct fiber *fiber_self()
+{
+    return fiber_cur_sched != NULL ? fiber_cur_sched->current : NULL;
+}
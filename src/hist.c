@@ -0,0 +1,236 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     hist.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that provides a fixed size log-linear latency histogram.
+|               Values (nanoseconds) are bucketed by their power of two and
+|               HIST_SUBBITS further bits, so adding a value is a few shifts
+|               and an increment and percentiles are accurate to ~12%. Each
+|               thread keeps its own histogram and they are merged for
+|               reporting, so the hot path never takes a lock.
+------------------------------------------------------------------------------*/
+#include "../include/hist.h"
+#include <string.h>
+#include <time.h>
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void hist_init(struct hist *h)
+|                   *h : histogram to clear
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Empties a histogram.
+------------------------------------------------------------------------------*/
+void hist_init(struct hist *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int hist_bucket(uint64_t v)
+|                   v : value
+|
+|   RETURN:     index of bucket holding 'v'
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Values below HIST_SUB map one to one, larger values map to
+|               their power of two group and the next HIST_SUBBITS bits.
+------------------------------------------------------------------------------*/
+int hist_bucket(uint64_t v)
+{
+    int _msb, _b;
+
+    if(v < HIST_SUB)
+        return (int)v;
+
+    _msb = 63 - __builtin_clzll(v);
+    _b = (_msb - HIST_SUBBITS + 1) * HIST_SUB + (int)((v >> (_msb - HIST_SUBBITS)) & (HIST_SUB - 1));
+
+    return _b < HIST_BUCKETS ? _b : HIST_BUCKETS - 1;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   uint64_t hist_bucket_low(int b)
+|                   b : bucket index
+|
+|   RETURN:     smallest value that falls in bucket 'b'
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Inverse of hist_bucket().
+------------------------------------------------------------------------------*/
+uint64_t hist_bucket_low(int b)
+{
+    int _group = b / HIST_SUB, _sub = b % HIST_SUB;
+
+    if(_group == 0)
+        return (uint64_t)_sub;
+
+    return (uint64_t)(HIST_SUB + _sub) << (_group - 1);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void hist_add(struct hist *h, uint64_t v)
+|                   *h : histogram
+|                   v  : value to record
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Records one value.
+------------------------------------------------------------------------------*/
+void hist_add(struct hist *h, uint64_t v)
+{
+    h->buckets[hist_bucket(v)]++;
+    h->count++;
+    h->sum += v;
+    if(v < h->min)
+        h->min = v;
+    if(v > h->max)
+        h->max = v;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void hist_merge(struct hist *dst, const struct hist *src)
+|                   *dst : histogram to add into
+|                   *src : histogram to add
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Adds every bucket of 'src' into 'dst'.
+------------------------------------------------------------------------------*/
+void hist_merge(struct hist *dst, const struct hist *src)
+{
+    for(int i = 0; i < HIST_BUCKETS; i++)
+        dst->buckets[i] += src->buckets[i];
+
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if(src->min < dst->min)
+        dst->min = src->min;
+    if(src->max > dst->max)
+        dst->max = src->max;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   uint64_t hist_percentile(const struct hist *h, double p)
+|                   *h : histogram
+|                   p  : percentile (0-100)
+|
+|   RETURN:     value at percentile 'p' (0 if histogram is empty)
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Walks the buckets until 'p' percent of the values are covered
+|               and returns the low edge of that bucket, clamped to min/max.
+------------------------------------------------------------------------------*/
+uint64_t hist_percentile(const struct hist *h, double p)
+{
+    uint64_t _target, _seen = 0, _v;
+
+    if(h->count == 0)
+        return 0;
+
+    _target = (uint64_t)(p / 100.0 * h->count);
+    if(_target >= h->count)
+        _target = h->count - 1;
+
+    for(int i = 0; i < HIST_BUCKETS; i++)
+    {
+        _seen += h->buckets[i];
+        if(_seen > _target)
+        {
+            _v = hist_bucket_low(i);
+            if(_v < h->min)
+                return h->min;
+            return _v > h->max ? h->max : _v;
+        }
+    }
+
+    return h->max;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void hist_print(FILE *out, const char *title, const struct hist *h,
+|                               int buckets)
+|                   *out    : stream to print to
+|                   *title  : label of the histogram
+|                   *h      : histogram
+|                   buckets : 1 to also print every non-empty bucket
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Prints count, mean and percentiles in microseconds.
+------------------------------------------------------------------------------*/
+void hist_print(FILE *out, const char *title, const struct hist *h, int buckets)
+{
+    if(h->count == 0)
+    {
+        fprintf(out, "%s: no samples\n", title);
+        return;
+    }
+
+    fprintf(out, "%s (us): n=%llu mean=%.1f min=%.1f p50=%.1f p90=%.1f p99=%.1f p99.9=%.1f max=%.1f\n",
+            title, (unsigned long long)h->count, h->sum / (double)h->count / 1000.0,
+            h->min / 1000.0, hist_percentile(h, 50) / 1000.0, hist_percentile(h, 90) / 1000.0,
+            hist_percentile(h, 99) / 1000.0, hist_percentile(h, 99.9) / 1000.0, h->max / 1000.0);
+
+    if(!buckets)
+        return;
+
+    for(int i = 0; i < HIST_BUCKETS; i++)
+        if(h->buckets[i] > 0)
+            fprintf(out, "\t>= %10.1f us\t%llu\n", hist_bucket_low(i) / 1000.0,
+                    (unsigned long long)h->buckets[i]);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   uint64_t now_ns()
+|
+|   RETURN:     monotonic time in nanoseconds
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Cheap monotonic timestamp used for latency measurements.
+------------------------------------------------------------------------------*/
+uint64_t now_ns()
+{
+    struct timespec _ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &_ts);
+    return (uint64_t)_ts.tv_sec * 1000000000ull + _ts.tv_nsec;
+}
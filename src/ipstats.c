@@ -0,0 +1,296 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     ipstats.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that aggregates connection statistics per client
+|               address (-a SECS) instead of logging one line per connection.
+|               A closing connection adds its requests, bytes and duration to
+|               its address's entry in an open addressed table keyed by the
+|               binary IPv4 address, so no string is formatted per
+|               connection. One summary line per address is appended to the
+|               server log every SECS seconds and at exit, which makes log
+|               volume follow the number of client hosts rather than the
+|               number of connections churned through.
+------------------------------------------------------------------------------*/
+#include "../include/ipstats.h"
+#include "../include/perthread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+/* --- Global ---- */
+struct ip_table ipstats = {NULL, 0, 0, 0, 0, NULL, PTHREAD_MUTEX_INITIALIZER};
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int ipstats_init(const char *logfile, int interval)
+|                   *logfile : server log the summaries are appended to
+|                   interval : seconds between summaries (0 = at exit only)
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Allocates the table and, for interval summaries, starts the
+|               reporter helper thread.
+------------------------------------------------------------------------------*/
+int ipstats_init(const char *logfile, int interval)
+{
+    if((ipstats.ents = calloc(IPSTATS_INITSIZE, sizeof *ipstats.ents)) == NULL)
+    {
+        printf("\tError allocating per-address stats table\n");
+        return -1;
+    }
+    ipstats.cap = IPSTATS_INITSIZE;
+    ipstats.logfile = logfile;
+    ipstats.interval = interval;
+
+    if(interval == 0)
+        return 0;
+
+    if(spawn_helper_thread(NULL, ipstats_reporter) == -1)
+    {
+        printf("\tError creating per-address stats reporter\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int ipstats_hdr(const char *logfile, int interval)
+|                   *logfile : name of file to write to
+|                   interval : seconds between summaries (0 = at exit only)
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Truncates the server log and writes the per-address table
+|               header, used instead of app_srv_hdr() when aggregating.
+------------------------------------------------------------------------------*/
+int ipstats_hdr(const char *logfile, int interval)
+{
+    FILE *_log;
+
+    if((_log = fopen(logfile, "w")) == NULL)
+    {
+        printf("\n\tFailed to open server's log file\n\n");
+        return -1;
+    }
+
+    if(interval > 0)
+        fprintf(_log, "Per-address totals, summarized every %d seconds and at exit\n\n", interval);
+    else
+        fprintf(_log, "Per-address totals, summarized at exit\n\n");
+    fprintf(_log, "HOSTNAME       \tCONNECTIONS\tREQUESTS\tBYTES TRANSFERRED\tAVG CONN (ms)\tMAX CONN (ms)\n");
+    fprintf(_log, "--------       \t-----------\t--------\t-----------------\t-------------\t-------------\n");
+    fclose(_log);
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void ipstats_add(uint32_t ip, uint64_t requests,
+|                                uint64_t bytes, uint64_t dur_ns)
+|                   ip       : client address (network order, 0 = unix)
+|                   requests : requests served on the connection
+|                   bytes    : bytes echoed on the connection
+|                   dur_ns   : how long the connection was open
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Adds a closed connection to its address's entry, creating the
+|               entry the first time the address is seen. The table doubles
+|               once it is IPSTATS_MAXLOAD % full; if that allocation fails the
+|               connection is still added while free slots remain.
+------------------------------------------------------------------------------*/
+void ipstats_add(uint32_t ip, uint64_t requests, uint64_t bytes, uint64_t dur_ns)
+{
+    struct ip_entry *_grown, *_e;
+    uint32_t _i, _j;
+
+    pthread_mutex_lock(&ipstats.lock);
+
+    // grow and rehash
+    if(ipstats.used >= ipstats.cap / 100 * IPSTATS_MAXLOAD
+       && (_grown = calloc(2 * ipstats.cap, sizeof *_grown)) != NULL)
+    {
+        for(_i = 0; _i < ipstats.cap; _i++)
+        {
+            if(ipstats.ents[_i].conns == 0)
+                continue;
+            _j = (ipstats.ents[_i].ip * 2654435761u) & (2 * ipstats.cap - 1);
+            while(_grown[_j].conns != 0)
+                _j = (_j + 1) & (2 * ipstats.cap - 1);
+            _grown[_j] = ipstats.ents[_i];
+        }
+        free(ipstats.ents);
+        ipstats.ents = _grown;
+        ipstats.cap *= 2;
+    }
+
+    _i = (ip * 2654435761u) & (ipstats.cap - 1);
+    while(ipstats.ents[_i].conns != 0 && ipstats.ents[_i].ip != ip)
+        _i = (_i + 1) & (ipstats.cap - 1);
+
+    if(ipstats.ents[_i].conns == 0)
+    {
+        if(ipstats.used + 1 >= ipstats.cap)    // keep a free slot to end probes
+        {
+            pthread_mutex_unlock(&ipstats.lock);
+            return;
+        }
+        ipstats.ents[_i].ip = ip;
+        ipstats.used++;
+    }
+
+    _e = &ipstats.ents[_i];
+    _e->conns++;
+    _e->requests += requests;
+    _e->bytes += bytes;
+    _e->dur_ns += dur_ns;
+    if(dur_ns > _e->max_ns)
+        _e->max_ns = dur_ns;
+
+    pthread_mutex_unlock(&ipstats.lock);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void *ipstats_reporter(void *arg)
+|                   *arg : unused
+|
+|   RETURN:     NULL
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Reporter thread, appends a summary every interval until the
+|               final one has been written.
+------------------------------------------------------------------------------*/
+void *ipstats_reporter(void *arg)
+{
+    (void)arg;
+
+    while(1)
+    {
+        for(int i = 0; i < ipstats.interval; i++)
+        {
+            sleep(1);
+            if(__atomic_load_n(&ipstats.done, __ATOMIC_ACQUIRE))
+                return NULL;
+        }
+        ipstats_write(0);
+    }
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int ipstats_cmp(const void *a, const void *b)
+|                   *a, *b : entries to compare
+|
+|   RETURN:     <0, 0 or >0 to sort by requests, busiest first
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       qsort() comparator of ipstats_write().
+------------------------------------------------------------------------------*/
+int ipstats_cmp(const void *a, const void *b)
+{
+    const struct ip_entry *_a = a, *_b = b;
+
+    return (_a->requests < _b->requests) - (_a->requests > _b->requests);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int ipstats_write(int final)
+|                   final : 1 for the summary at exit (stops the reporter)
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Appends one line per address, busiest first, with its totals
+|               so far. The table is copied under the lock and formatted
+|               without it, so closing connections only wait for the copy.
+------------------------------------------------------------------------------*/
+int ipstats_write(int final)
+{
+    struct ip_entry *_copy;
+    struct in_addr _addr;
+    struct tm _tm;
+    time_t _t;
+    uint64_t _conns = 0;
+    uint32_t _n = 0;
+    FILE *_log;
+
+    if(ipstats.ents == NULL)
+        return 0;
+
+    pthread_mutex_lock(&ipstats.lock);
+    if(ipstats.done || (_copy = malloc((ipstats.used + 1) * sizeof *_copy)) == NULL)
+    {
+        pthread_mutex_unlock(&ipstats.lock);
+        return -1;
+    }
+    for(uint32_t i = 0; i < ipstats.cap; i++)
+        if(ipstats.ents[i].conns != 0)
+            _copy[_n++] = ipstats.ents[i];
+    if(final)
+        __atomic_store_n(&ipstats.done, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&ipstats.lock);
+
+    qsort(_copy, _n, sizeof *_copy, ipstats_cmp);
+
+    if((_log = fopen(ipstats.logfile, "a")) == NULL)
+    {
+        printf("\n\tFailed to open server's log file\n\n");
+        free(_copy);
+        return -1;
+    }
+
+    _t = time(NULL);
+    localtime_r(&_t, &_tm);
+    fprintf(_log, "%s %d/%d/%d %d:%d:%d\n", final ? "Final" : "Summary", _tm.tm_year + 1900,
+            _tm.tm_mon + 1, _tm.tm_mday, _tm.tm_hour, _tm.tm_min, _tm.tm_sec);
+
+    for(uint32_t i = 0; i < _n; i++)
+    {
+        _addr.s_addr = _copy[i].ip;
+        fprintf(_log, "%-15s\t%u\t\t%llu\t\t%.2f MB\t\t%.2f\t\t%.2f\n",
+                _copy[i].ip != 0 ? inet_ntoa(_addr) : "unix", _copy[i].conns,
+                (unsigned long long)_copy[i].requests, _copy[i].bytes / 1e6,
+                _copy[i].dur_ns / 1e6 / _copy[i].conns, _copy[i].max_ns / 1e6);
+        _conns += _copy[i].conns;
+    }
+    fprintf(_log, "\n");
+    fclose(_log);
+
+    if(final)
+        printf("- Per-address stats: %u addresses, %llu connections (see %s)\n",
+               _n, (unsigned long long)_conns, ipstats.logfile);
+
+    free(_copy);
+    return 0;
+}
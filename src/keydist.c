@@ -0,0 +1,142 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     keydist.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that generates keys for the key-value workload. Keys
+|               are drawn either uniformly or from a zipfian distribution using
+|               the constant time method of Gray et al. (as used by YCSB). The
+|               zipf rank is scrambled with a hash so the hot keys land in
+|               different store shards instead of clustering at low key ids.
+------------------------------------------------------------------------------*/
+#include "../include/keydist.h"
+#include <math.h>
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int keydist_init(struct keydist *kd, enum key_dist dist,
+|                                uint64_t nkeys, double theta)
+|                   *kd   : generator to initialize
+|                   dist  : distribution to draw from
+|                   nkeys : size of key space
+|                   theta : zipf skew (ignored for uniform)
+|
+|   RETURN:     0 on success, -1 on invalid parameters
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Precomputes the zipf constants (O(nkeys), done once).
+------------------------------------------------------------------------------*/
+int keydist_init(struct keydist *kd, enum key_dist dist, uint64_t nkeys, double theta)
+{
+    double _zeta2 = 0;
+
+    if(nkeys < 1 || (dist == DIST_ZIPF && (theta <= 0 || theta >= 1)))
+        return -1;
+
+    kd->dist = dist;
+    kd->nkeys = nkeys;
+    kd->theta = theta;
+
+    if(dist == DIST_ZIPF)
+    {
+        kd->zetan = 0;
+        for(uint64_t i = 1; i <= nkeys; i++)
+        {
+            kd->zetan += 1.0 / pow((double)i, theta);
+            if(i == 2)
+                _zeta2 = kd->zetan;
+        }
+        if(nkeys < 2)
+            _zeta2 = kd->zetan;
+
+        kd->alpha = 1.0 / (1.0 - theta);
+        kd->eta = (1.0 - pow(2.0 / nkeys, 1.0 - theta)) / (1.0 - _zeta2 / kd->zetan);
+    }
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   uint64_t keydist_next(const struct keydist *kd, uint64_t *rng)
+|                   *kd  : generator
+|                   *rng : caller's (per thread) random state
+|
+|   RETURN:     next key id in 0..nkeys-1
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Draws the next key id.
+------------------------------------------------------------------------------*/
+uint64_t keydist_next(const struct keydist *kd, uint64_t *rng)
+{
+    double _u, _uz;
+    uint64_t _rank;
+
+    if(kd->dist == DIST_UNIFORM)
+        return xorshift64(rng) % kd->nkeys;
+
+    _u = rand_unit(rng);
+    _uz = _u * kd->zetan;
+    if(_uz < 1.0)
+        _rank = 0;
+    else if(_uz < 1.0 + pow(0.5, kd->theta))
+        _rank = 1;
+    else
+        _rank = (uint64_t)(kd->nkeys * pow(kd->eta * _u - kd->eta + 1.0, kd->alpha));
+    if(_rank >= kd->nkeys)
+        _rank = kd->nkeys - 1;
+
+    // scramble rank so hot keys spread over the key space
+    _rank = (_rank + 1) * 0x9e3779b97f4a7c15ull;
+    _rank ^= _rank >> 31;
+    return _rank % kd->nkeys;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   uint64_t xorshift64(uint64_t *state)
+|                   *state : random state (must not be 0)
+|
+|   RETURN:     next pseudo random number
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       xorshift64* generator. Cheap enough to call per request.
+------------------------------------------------------------------------------*/
+uint64_t xorshift64(uint64_t *state)
+{
+    uint64_t _x = *state;
+
+    _x ^= _x >> 12;
+    _x ^= _x << 25;
+    _x ^= _x >> 27;
+    *state = _x;
+
+    return _x * 0x2545f4914f6cdd1dull;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   double rand_unit(uint64_t *state)
+|                   *state : random state
+|
+|   RETURN:     pseudo random number in [0, 1)
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Uniform double built from the top 53 bits of xorshift64.
+------------------------------------------------------------------------------*/
+double rand_unit(uint64_t *state)
+{
+    return (xorshift64(state) >> 11) * (1.0 / 9007199254740992.0);
+}
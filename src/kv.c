@@ -0,0 +1,400 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     kv.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that provides an in-memory key-value store and the tiny
+|               binary GET/SET/DEL protocol spoken over the echo servers'
+|               fixed PKTSIZE frames. Every frame starts with a kv_hdr followed
+|               by the key and (for SET and GET responses) the value.
+|
+|               The store is split into shards (one per core by default), each
+|               protected by its own lock. A shard is an open addressed table
+|               probed linearly over a packed array of 32 bit hash tags, so a
+|               lookup scans tags 16 to a cache line and only touches an entry
+|               when its tag matches.
+------------------------------------------------------------------------------*/
+#include "../include/kv.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int kv_init(struct kv_store *kv, int nshards)
+|                   *kv     : store to initialize
+|                   nshards : number of independently locked shards
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Allocates an empty store of 'nshards' shards of KV_SHARDCAP
+|               slots each.
+------------------------------------------------------------------------------*/
+int kv_init(struct kv_store *kv, int nshards)
+{
+    kv->nshards = nshards;
+    if(posix_memalign((void **)&kv->shards, 64, nshards * sizeof *kv->shards) != 0)
+        return -1;
+
+    for(int i = 0; i < nshards; i++)
+    {
+        struct kv_shard *_s = &kv->shards[i];
+
+        pthread_mutex_init(&_s->lock, NULL);
+        _s->cap = KV_SHARDCAP;
+        _s->used = 0;
+        _s->live = 0;
+        _s->tags = calloc(_s->cap, sizeof *_s->tags);
+        _s->entries = malloc(_s->cap * sizeof *_s->entries);
+        if(_s->tags == NULL || _s->entries == NULL)
+        {
+            printf("\tError allocating key-value shard\n");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void kv_handle(struct kv_store *kv, char *frame, int len)
+|                   *kv    : store to run the request against
+|                   *frame : request frame, overwritten with the response
+|                   len    : size of frame
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Decodes a request frame, runs it against the store and
+|               encodes the response into the same frame. GET responses carry
+|               the value, SET and DEL responses only a status.
+------------------------------------------------------------------------------*/
+void kv_handle(struct kv_store *kv, char *frame, int len)
+{
+    struct kv_hdr _hdr;
+    char *_key = frame + sizeof(_hdr);
+    char _val[KV_MAXVAL];
+    int _vlen = 0, _status;
+
+    memcpy(&_hdr, frame, sizeof(_hdr));
+
+    if(_hdr.klen == 0 || _hdr.klen > KV_MAXKEY || _hdr.vlen > KV_MAXVAL
+       || (int)(sizeof(_hdr) + _hdr.klen + _hdr.vlen) > len)
+        _status = KV_BADREQ;
+    else if(_hdr.op == KV_GET)
+    {
+        _vlen = kv_get(kv, _key, _hdr.klen, _val);
+        _status = (_vlen == -1) ? KV_NOTFOUND : KV_OK;
+    }
+    else if(_hdr.op == KV_SET)
+        _status = (kv_set(kv, _key, _hdr.klen, _key + _hdr.klen, _hdr.vlen) == -1) ? KV_FULL : KV_OK;
+    else if(_hdr.op == KV_DEL)
+        _status = (kv_del(kv, _key, _hdr.klen) == -1) ? KV_NOTFOUND : KV_OK;
+    else
+        _status = KV_BADREQ;
+
+    _hdr.status = _status;
+    _hdr.vlen = (_status == KV_OK && _hdr.op == KV_GET) ? _vlen : 0;
+    if(_hdr.vlen > 0)
+        memcpy(_key + _hdr.klen, _val, _hdr.vlen);
+    memcpy(frame, &_hdr, sizeof(_hdr));
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int kv_probe(struct kv_shard *s, uint32_t tag, const char *key,
+|                            int klen, int *free_slot)
+|                   *s    : shard to search
+|                   tag   : hash tag of key
+|                   *key  : key to look for
+|                   klen  : length of key
+|                   *free_slot : set to first reusable slot seen (-1 if none)
+|
+|   RETURN:     slot holding key, -1 if not present
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Linear probe over the shard's tag array starting at the key's
+|               home slot. Stops at the first never-used slot.
+------------------------------------------------------------------------------*/
+static int kv_probe(struct kv_shard *s, uint32_t tag, const char *key, int klen, int *free_slot)
+{
+    uint32_t _mask = s->cap - 1;
+    uint32_t _i = tag & _mask;
+
+    *free_slot = -1;
+    for(uint32_t n = 0; n < s->cap; n++, _i = (_i + 1) & _mask)
+    {
+        if(s->tags[_i] == KV_TAG_EMPTY)
+        {
+            if(*free_slot == -1)
+                *free_slot = _i;
+            return -1;
+        }
+        if(s->tags[_i] == KV_TAG_DEAD)
+        {
+            if(*free_slot == -1)
+                *free_slot = _i;
+            continue;
+        }
+        if(s->tags[_i] == tag && s->entries[_i].klen == klen
+           && memcmp(s->entries[_i].key, key, klen) == 0)
+            return _i;
+    }
+
+    return -1;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   static int kv_grow(struct kv_shard *s)
+|                   *s : shard to grow (lock held)
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Doubles the shard's capacity and reinserts its live entries,
+|               dropping tombstones.
+------------------------------------------------------------------------------*/
+static int kv_grow(struct kv_shard *s)
+{
+    uint32_t *_old_tags = s->tags;
+    struct kv_entry *_old_entries = s->entries;
+    uint32_t _old_cap = s->cap, _mask;
+
+    s->cap *= 2;
+    s->tags = calloc(s->cap, sizeof *s->tags);
+    s->entries = malloc(s->cap * sizeof *s->entries);
+    if(s->tags == NULL || s->entries == NULL)
+    {
+        free(s->tags);
+        free(s->entries);
+        s->tags = _old_tags;
+        s->entries = _old_entries;
+        s->cap = _old_cap;
+        return -1;
+    }
+
+    _mask = s->cap - 1;
+    for(uint32_t i = 0; i < _old_cap; i++)
+    {
+        uint32_t _j;
+
+        if(_old_tags[i] <= KV_TAG_DEAD)
+            continue;
+        for(_j = _old_tags[i] & _mask; s->tags[_j] != KV_TAG_EMPTY; _j = (_j + 1) & _mask)
+            ;
+        s->tags[_j] = _old_tags[i];
+        s->entries[_j] = _old_entries[i];
+    }
+    s->used = s->live;
+
+    free(_old_tags);
+    free(_old_entries);
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int kv_get(struct kv_store *kv, const char *key, int klen, char *val)
+|                   *kv  : store
+|                   *key : key to look up
+|                   klen : length of key
+|                   *val : buffer of KV_MAXVAL bytes receiving the value
+|
+|   RETURN:     length of value, -1 if key is not present
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Copies the value stored under 'key' into '*val'.
+------------------------------------------------------------------------------*/
+int kv_get(struct kv_store *kv, const char *key, int klen, char *val)
+{
+    uint32_t _tag = kv_hash(key, klen);
+    struct kv_shard *_s = &kv->shards[(_tag >> 16) % kv->nshards];
+    int _slot, _free, _vlen = -1;
+
+    pthread_mutex_lock(&_s->lock);
+    if((_slot = kv_probe(_s, _tag, key, klen, &_free)) != -1)
+    {
+        _vlen = _s->entries[_slot].vlen;
+        memcpy(val, _s->entries[_slot].val, _vlen);
+    }
+    pthread_mutex_unlock(&_s->lock);
+
+    return _vlen;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int kv_set(struct kv_store *kv, const char *key, int klen,
+|                          const char *val, int vlen)
+|                   *kv  : store
+|                   *key : key to store under
+|                   klen : length of key
+|                   *val : value to store
+|                   vlen : length of value
+|
+|   RETURN:     0 on success, -1 if the shard could not grow
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Inserts or overwrites 'key'. The shard doubles once live plus
+|               deleted slots pass 3/4 of its capacity.
+------------------------------------------------------------------------------*/
+int kv_set(struct kv_store *kv, const char *key, int klen, const char *val, int vlen)
+{
+    uint32_t _tag = kv_hash(key, klen);
+    struct kv_shard *_s = &kv->shards[(_tag >> 16) % kv->nshards];
+    int _slot, _free;
+
+    pthread_mutex_lock(&_s->lock);
+    if((_slot = kv_probe(_s, _tag, key, klen, &_free)) == -1)
+    {
+        if((_s->used + 1) * 4 > _s->cap * 3)
+        {
+            if(kv_grow(_s) == -1)
+            {
+                pthread_mutex_unlock(&_s->lock);
+                return -1;
+            }
+            kv_probe(_s, _tag, key, klen, &_free);
+        }
+
+        _slot = _free;
+        if(_s->tags[_slot] == KV_TAG_EMPTY)
+            _s->used++;
+        _s->live++;
+        _s->tags[_slot] = _tag;
+        _s->entries[_slot].klen = klen;
+        memcpy(_s->entries[_slot].key, key, klen);
+    }
+
+    _s->entries[_slot].vlen = vlen;
+    memcpy(_s->entries[_slot].val, val, vlen);
+    pthread_mutex_unlock(&_s->lock);
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int kv_del(struct kv_store *kv, const char *key, int klen)
+|                   *kv  : store
+|                   *key : key to delete
+|                   klen : length of key
+|
+|   RETURN:     0 on success, -1 if key is not present
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Removes 'key', leaving a tombstone so later probes continue
+|               past the slot.
+------------------------------------------------------------------------------*/
+int kv_del(struct kv_store *kv, const char *key, int klen)
+{
+    uint32_t _tag = kv_hash(key, klen);
+    struct kv_shard *_s = &kv->shards[(_tag >> 16) % kv->nshards];
+    int _slot, _free;
+
+    pthread_mutex_lock(&_s->lock);
+    if((_slot = kv_probe(_s, _tag, key, klen, &_free)) != -1)
+    {
+        _s->tags[_slot] = KV_TAG_DEAD;
+        _s->live--;
+    }
+    pthread_mutex_unlock(&_s->lock);
+
+    return _slot == -1 ? -1 : 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int kv_encode(char *frame, int op, const char *key, int klen,
+|                             const char *val, int vlen)
+|                   *frame : frame to write the request into
+|                   op     : enum kv_op
+|                   *key   : key
+|                   klen   : length of key
+|                   *val   : value (SET only, may be NULL)
+|                   vlen   : length of value
+|
+|   RETURN:     bytes of frame used
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Encodes a request frame. Used by the client.
+------------------------------------------------------------------------------*/
+int kv_encode(char *frame, int op, const char *key, int klen, const char *val, int vlen)
+{
+    struct kv_hdr _hdr;
+
+    _hdr.op = op;
+    _hdr.status = 0;
+    _hdr.klen = klen;
+    _hdr.vlen = (op == KV_SET) ? vlen : 0;
+    _hdr.pad = 0;
+
+    memcpy(frame, &_hdr, sizeof(_hdr));
+    memcpy(frame + sizeof(_hdr), key, klen);
+    if(_hdr.vlen > 0)
+        memcpy(frame + sizeof(_hdr) + klen, val, _hdr.vlen);
+
+    return sizeof(_hdr) + klen + _hdr.vlen;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   uint32_t kv_hash(const char *key, int klen)
+|                   *key : key to hash
+|                   klen : length of key
+|
+|   RETURN:     hash tag of key (never KV_TAG_EMPTY or KV_TAG_DEAD)
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       FNV-1a followed by a murmur3 finalizer so both the low bits
+|               (slot) and high bits (shard) are well mixed.
+------------------------------------------------------------------------------*/
+uint32_t kv_hash(const char *key, int klen)
+{
+    uint32_t _h = 2166136261u;
+
+    for(int i = 0; i < klen; i++)
+    {
+        _h ^= (unsigned char)key[i];
+        _h *= 16777619u;
+    }
+
+    _h ^= _h >> 16;
+    _h *= 0x85ebca6bu;
+    _h ^= _h >> 13;
+    _h *= 0xc2b2ae35u;
+    _h ^= _h >> 16;
+
+    return (_h <= KV_TAG_DEAD) ? _h + 2 : _h;
+}
@@ -9,6 +9,10 @@
 #include "../include/clt_thread.h"
 #include <stdio.h>
 #include <unistd.h>
+#include <sys/file.h>
+
+/* --- Global ---- */
+pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
 
 
 /*------------------------------------------------------------------------------
@@ -44,7 +48,8 @@ int app_srv_hdr(char *filename)
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   int app_clt_hdr()
+|   FUNCTION:   int app_clt_hdr(int secs)
+|                   secs : measurement window of each client
 |
 |   RETURN:     0 on success, -1 on failure
 |
@@ -54,7 +59,7 @@ int app_srv_hdr(char *filename)
 |
 |   DESC:       Appends a table header to the clients log file.
 ------------------------------------------------------------------------------*/
-int app_clt_hdr()
+int app_clt_hdr(int secs)
 {
     FILE *_log;
 
@@ -66,7 +71,7 @@ int app_clt_hdr()
 
     if(ftell(_log) == 0) // if no header found in log file
     {
-        fprintf(_log, "Packet Size: %d\tTransmission Duration (each client): %d seconds\n\n", PKTSIZE, TIMEOUT);
+        fprintf(_log, "Packet Size: %d\tTransmission Duration (each client): %d seconds\n\n", PKTSIZE, secs);
         fprintf(_log, "CONNECTION TIME \t\tREQUESTS\t\tDATA TRANSFERRED\tAVG RESPONSE TIME\n");
         fprintf(_log, "--------------- \t\t--------\t\t----------------\t-----------------\n");
     }
@@ -98,6 +103,7 @@ int append_srv_data(char *filename, struct srv_log_stats stats)
     if((_log = fopen(filename, "a")) == NULL)
     {
         printf("\n\tFailed to open server's log file\n\n");
+        pthread_mutex_unlock(&lock);
         return -1;
     }
 
@@ -138,17 +144,21 @@ int append_srv_data(char *filename, struct srv_log_stats stats)
 |
 |   DESC:       Appends client statistical data in 'stats' to the client log
 |               file as well as the average server response time specified by
-|               't'.
+|               't'. Client threads serialize on 'lock' and load generator
+|               processes on an flock() of the file, so lines never interleave.
 ------------------------------------------------------------------------------*/
 int append_clt_data(struct clt_log_stats stats, double t)
 {
     FILE *_log;
 
+    pthread_mutex_lock(&lock);
     if((_log = fopen(CLTLOGFILE, "a")) == NULL)
     {
+        pthread_mutex_unlock(&lock);
         printf("\n\tFailed to open client's log file\n\n");
         return -1;
     }
+    flock(fileno(_log), LOCK_EX);
 
     // append time of connection
     fprintf(_log, "%d/%d/%d ", stats.tm.tm_year + 1900, stats.tm.tm_mon + 1, stats.tm.tm_mday);
@@ -168,6 +178,10 @@ int append_clt_data(struct clt_log_stats stats, double t)
     // append average response time from server
     fprintf(_log, "%f ms\n", t);
 
+    fflush(_log);
+    flock(fileno(_log), LOCK_UN);
+    fclose(_log);
+    pthread_mutex_unlock(&lock);
     return 0;
 }
 
@@ -198,6 +212,7 @@ int append_total_clients(char *filename, int total)
     fprintf(_log, "-------------------------------------------------------------------------------------------\n");
     fprintf(_log, "\nTotal Client Connections: %d", total);
 
+    fclose(_log);
     return 0;
 }
 
@@ -0,0 +1,128 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     memstat.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that measures what connections cost in memory. The
+|               user side is the growth of the server's resident set, the
+|               kernel side the growth of slab memory (socket, file, dentry and
+|               epoll objects) plus tcp buffer memory, all divided by the
+|               number of open connections. Slab and tcp memory are system
+|               wide, so with the client on the same host they include the
+|               client's sockets too.
+------------------------------------------------------------------------------*/
+#include "../include/memstat.h"
+#include <string.h>
+#include <unistd.h>
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int mem_sample(struct mem_sample *m)
+|                   *m : sample to fill in
+|
+|   RETURN:     0 on success, -1 if /proc could not be read
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Reads /proc/self/statm, /proc/meminfo and /proc/net/sockstat.
+------------------------------------------------------------------------------*/
+int mem_sample(struct mem_sample *m)
+{
+    long _page = sysconf(_SC_PAGESIZE);
+    char _line[256];
+    long _pages, _kb;
+    FILE *_f;
+
+    memset(m, 0, sizeof(*m));
+
+    if((_f = fopen("/proc/self/statm", "r")) == NULL)
+        return -1;
+    if(fscanf(_f, "%*d %ld", &_pages) == 1)
+        m->rss = _pages * _page;
+    fclose(_f);
+
+    if((_f = fopen("/proc/meminfo", "r")) == NULL)
+        return -1;
+    while(fgets(_line, sizeof(_line), _f) != NULL)
+        if(sscanf(_line, "Slab: %ld kB", &_kb) == 1)
+            m->slab = _kb * 1024;
+    fclose(_f);
+
+    if((_f = fopen("/proc/net/sockstat", "r")) == NULL)
+        return -1;
+    while(fgets(_line, sizeof(_line), _f) != NULL)
+    {
+        char *_mem = strstr(_line, " mem ");
+
+        if(strncmp(_line, "TCP:", 4) == 0 && _mem != NULL && sscanf(_mem, " mem %ld", &_pages) == 1)
+            m->tcp_mem = _pages * _page;
+    }
+    fclose(_f);
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void mem_report(FILE *out, long conns, const struct mem_sample *base)
+|                   *out  : stream to print to
+|                   conns : open connections
+|                   *base : sample taken before any connection was accepted
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Prints user and kernel bytes per connection since 'base'.
+------------------------------------------------------------------------------*/
+void mem_report(FILE *out, long conns, const struct mem_sample *base)
+{
+    struct mem_sample _now;
+    long _user, _kernel;
+
+    if(conns <= 0 || mem_sample(&_now) == -1)
+        return;
+
+    _user = _now.rss - base->rss;
+    _kernel = (_now.slab - base->slab) + (_now.tcp_mem - base->tcp_mem);
+
+    fprintf(out, "- %ld conns: user %ld B/conn, kernel %ld B/conn "
+            "(rss %.1f MB, slab %.1f MB, tcp buffers %.1f MB)\n",
+            conns, _user / conns, _kernel / conns, _now.rss / 1048576.0,
+            _now.slab / 1048576.0, _now.tcp_mem / 1048576.0);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   long next_scale_step(long n)
+|                   n : current step (0 for the first one)
+|
+|   RETURN:     next step of the 1-2-5 series starting at 1000
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Connection counts at which memory gets reported: 1000, 2000,
+|               5000, 10000, 20000, 50000, ...
+------------------------------------------------------------------------------*/
+long next_scale_step(long n)
+{
+    long _decade = 1000;
+
+    if(n < 1000)
+        return 1000;
+
+    while(_decade * 10 <= n)
+        _decade *= 10;
+
+    if(n < 2 * _decade)
+        return 2 * _decade;
+    if(n < 5 * _decade)
+        return 5 * _decade;
+    return 10 * _decade;
+}
@@ -0,0 +1,166 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     perthread.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module with the thread plumbing shared by the stats modules of
+|               the server and the client.
+|
+|               A slot registry gives every thread its own slot of counters,
+|               created on the thread's first use and linked into a live list
+|               that readers walk under the registry lock. When a thread exits
+|               (the thread backend has one per connection) a thread-specific
+|               data destructor lets the owning module fold the slot into its
+|               retired total, then unlinks and frees it.
+|
+|               Helper threads (reporters, publishers, dumpers) are started
+|               with SIGINT blocked, so SIGINT keeps reaching the thread that
+|               waits for connections.
+------------------------------------------------------------------------------*/
+#include "../include/perthread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+static void slots_retire(void *arg);
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int slots_init(struct slot_reg *reg, size_t size,
+|                              void (*init)(void *), void (*retire)(void *))
+|                   *reg    : registry, statically set to SLOTS_INITIALIZER
+|                   size    : size of a slot (struct slot_link first)
+|                   *init   : sets up a new zeroed slot, may be NULL
+|                   *retire : folds the slot of an exiting thread, called
+|                             with the registry lock held
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Creates the thread-specific data key whose destructor retires
+|               a thread's slot. Slots are rounded up to whole cache lines.
+------------------------------------------------------------------------------*/
+int slots_init(struct slot_reg *reg, size_t size, void (*init)(void *), void (*retire)(void *))
+{
+    reg->size = (size + 63) & ~(size_t)63;
+    reg->init = init;
+    reg->retire = retire;
+
+    return pthread_key_create(&reg->key, slots_retire) == 0 ? 0 : -1;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void *slots_get(struct slot_reg *reg, void **mine)
+|                   *reg  : registry
+|                   **mine: the caller's thread local pointer to its slot
+|
+|   RETURN:     the calling thread's slot, NULL if it could not be allocated
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Creates the slot on the thread's first use and links it into
+|               the live list; after that it is a thread local load.
+------------------------------------------------------------------------------*/
+void *slots_get(struct slot_reg *reg, void **mine)
+{
+    struct slot_link *_slot = *mine;
+
+    if(_slot != NULL)
+        return _slot;
+
+    if((_slot = aligned_alloc(64, reg->size)) == NULL)
+        return NULL;
+    memset(_slot, 0, reg->size);
+    _slot->reg = reg;
+    if(reg->init != NULL)
+        reg->init(_slot);
+
+    pthread_mutex_lock(&reg->lock);
+    _slot->id = reg->nslots++;
+    _slot->next = reg->live;
+    if(reg->live != NULL)
+        reg->live->prev = _slot;
+    reg->live = _slot;
+    pthread_mutex_unlock(&reg->lock);
+
+    pthread_setspecific(reg->key, _slot);
+    *mine = _slot;
+    return _slot;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   static void slots_retire(void *arg)
+|                   *arg : slot of the exiting thread
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Thread exit destructor: has the owning module fold the slot
+|               into its retired total, unlinks it and frees it.
+------------------------------------------------------------------------------*/
+static void slots_retire(void *arg)
+{
+    struct slot_link *_slot = arg;
+    struct slot_reg *_reg = _slot->reg;
+
+    pthread_mutex_lock(&_reg->lock);
+    _reg->retire(_slot);
+
+    if(_slot->prev != NULL)
+        _slot->prev->next = _slot->next;
+    else
+        _reg->live = _slot->next;
+    if(_slot->next != NULL)
+        _slot->next->prev = _slot->prev;
+    pthread_mutex_unlock(&_reg->lock);
+
+    free(_slot);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int spawn_helper_thread(pthread_t *thread, void *(*run)(void *))
+|                   *thread : set to the new thread, NULL to start it detached
+|                   *run    : thread body, called with a NULL argument
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Starts a helper thread with SIGINT blocked (a new thread
+|               inherits the creator's mask), then restores the caller's
+|               mask. Other signals the caller blocked stay blocked in both.
+------------------------------------------------------------------------------*/
+int spawn_helper_thread(pthread_t *thread, void *(*run)(void *))
+{
+    pthread_attr_t _attr;
+    pthread_t _thread;
+    sigset_t _set, _old;
+    int _ret;
+
+    pthread_attr_init(&_attr);
+    if(thread == NULL)
+        pthread_attr_setdetachstate(&_attr, PTHREAD_CREATE_DETACHED);
+
+    sigemptyset(&_set);
+    sigaddset(&_set, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &_set, &_old);
+    _ret = pthread_create(thread != NULL ? thread : &_thread, &_attr, run, NULL);
+    pthread_sigmask(SIG_SETMASK, &_old, NULL);
+
+    pthread_attr_destroy(&_attr);
+    return _ret == 0 ? 0 : -1;
+}
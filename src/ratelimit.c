@@ -0,0 +1,234 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     ratelimit.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that limits the request rate of each client IPv4
+|               address with a token bucket (--rate R requests/sec, --burst B).
+|               Buckets live in one open addressed table keyed by the binary
+|               address. A bucket is 16 bytes, four share a cache line and the
+|               whole table is 1 MB, so tens of thousands of client addresses
+|               stay cache resident. Buckets never move, so a connection looks
+|               its bucket up once when accepted and keeps the pointer.
+|               Only creating a bucket takes the table lock; a bucket's refill
+|               stamp and tokens share one 64-bit word that rl_wait() updates
+|               with a compare and swap, so requests never serialise on it.
+|
+|               The engine checks for a token before it reads a new request.
+|               Without one, event loops that support it stop reading the
+|               connection until the bucket has refilled (see conn_service),
+|               blocking backends sleep; nothing is ever closed.
+------------------------------------------------------------------------------*/
+#include "../include/ratelimit.h"
+#include "../include/hist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+/* --- Global ---- */
+struct rl_table rl = {NULL, 0, 0, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER};
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int rl_init(int rate, int burst)
+|                   rate  : requests per second allowed per client address
+|                   burst : requests allowed back to back (bucket size)
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Allocates the bucket table, aligned so no bucket straddles a
+|               cache line.
+------------------------------------------------------------------------------*/
+int rl_init(int rate, int burst)
+{
+    if((rl.buckets = aligned_alloc(64, RL_BUCKETS * sizeof *rl.buckets)) == NULL)
+    {
+        printf("\tError allocating rate limit table\n");
+        return -1;
+    }
+
+    memset(rl.buckets, 0, RL_BUCKETS * sizeof *rl.buckets);
+    rl.rate = rate;
+    rl.burst = burst * 1000;
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   struct rl_bucket *rl_lookup(uint32_t ip)
+|                   ip : client IPv4 address (network order)
+|
+|   RETURN:     bucket of the address, NULL if limiting is off or the table
+|               is full
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Finds the address's bucket, creating a full one for a new
+|               address. Past RL_MAXLOAD new addresses are not limited rather
+|               than evicting buckets that connections still point at.
+------------------------------------------------------------------------------*/
+struct rl_bucket *rl_lookup(uint32_t ip)
+{
+    struct rl_bucket *_b = NULL;
+    uint32_t _i;
+
+    if(rl.buckets == NULL || ip == 0)
+        return NULL;
+
+    _i = (ip * 2654435761u) >> 16;    // top bits of a multiplicative hash
+
+    pthread_mutex_lock(&rl.lock);
+    for(int n = 0; n < RL_BUCKETS; n++, _i = (_i + 1) & (RL_BUCKETS - 1))
+    {
+        if(rl.buckets[_i].ip == ip)
+        {
+            _b = &rl.buckets[_i];
+            break;
+        }
+
+        if(rl.buckets[_i].ip == 0)
+        {
+            if(rl.used >= RL_BUCKETS / 100 * RL_MAXLOAD)
+            {
+                rl.overflow++;
+                break;
+            }
+            _b = &rl.buckets[_i];
+            _b->ip = ip;
+            _b->state = (uint64_t)(uint32_t)(now_ns() / 1000000) << 32 | (uint32_t)rl.burst;
+            rl.used++;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&rl.lock);
+
+    return _b;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int rl_wait(struct rl_bucket *b, int held)
+|                   *b   : bucket of the connection's client address
+|                   held : 1 if this request was already held back before
+|
+|   RETURN:     0 if a token was taken, else ms until the next token
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Refills the bucket for the time since its last refill then
+|               takes one token for the next request, in one compare and swap
+|               of the bucket's state (retried if another connection of the
+|               address got in first). The clock is read after the state so
+|               the refill stamp never goes back. A throttle is counted once
+|               per request, when it is first held back.
+------------------------------------------------------------------------------*/
+int rl_wait(struct rl_bucket *b, int held)
+{
+    uint64_t _old, _new;
+    uint32_t _now;
+    int64_t _tokens;
+    int _wait;
+
+    _old = __atomic_load_n(&b->state, __ATOMIC_RELAXED);
+    do
+    {
+        _now = now_ns() / 1000000;
+        _tokens = (uint32_t)_old + (int64_t)(uint32_t)(_now - (uint32_t)(_old >> 32)) * rl.rate;
+        if(_tokens > rl.burst)
+            _tokens = rl.burst;
+
+        _wait = 0;
+        if(_tokens >= 1000)
+            _tokens -= 1000;
+        else
+            _wait = (1000 - _tokens + rl.rate - 1) / rl.rate;
+
+        _new = (uint64_t)_now << 32 | (uint32_t)_tokens;
+    } while(!__atomic_compare_exchange_n(&b->state, &_old, _new, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    if(_wait > 0 && !held)
+        __atomic_fetch_add(&b->throttled, 1, __ATOMIC_RELAXED);
+
+    return _wait;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void rl_set_deferrable()
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Called by a non-blocking backend that handles CONN_DEFER.
+|               Connections of other non-blocking backends are not limited,
+|               they have no way to hold a request back without stalling
+|               every other connection of the loop.
+------------------------------------------------------------------------------*/
+void rl_set_deferrable()
+{
+    rl.deferrable = 1;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void rl_report(FILE *out)
+|                   *out : stream to print to
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Prints the number of addresses tracked, throttles in total and
+|               the most throttled addresses. Nothing is printed when rate
+|               limiting is off.
+------------------------------------------------------------------------------*/
+void rl_report(FILE *out)
+{
+    struct rl_bucket *_top[RL_TOP] = {NULL};
+    struct in_addr _addr;
+    long _total = 0;
+    int _j;
+
+    if(rl.buckets == NULL)
+        return;
+
+    pthread_mutex_lock(&rl.lock);
+    for(int i = 0; i < RL_BUCKETS; i++)
+    {
+        if(rl.buckets[i].ip == 0)
+            continue;
+
+        _total += rl.buckets[i].throttled;
+
+        // insertion into the top list, most throttled first
+        for(_j = RL_TOP; _j > 0 && (_top[_j - 1] == NULL || _top[_j - 1]->throttled < rl.buckets[i].throttled); _j--)
+            if(_j < RL_TOP)
+                _top[_j] = _top[_j - 1];
+        if(_j < RL_TOP)
+            _top[_j] = &rl.buckets[i];
+    }
+
+    fprintf(out, "\nRate limit (%d req/s per address, burst %d)\n", rl.rate, rl.burst / 1000);
+    fprintf(out, "- %d addresses tracked, %ld throttled requests, %ld connections unlimited (table full)\n",
+            rl.used, _total, rl.overflow);
+    for(int i = 0; i < RL_TOP && _top[i] != NULL && _top[i]->throttled > 0; i++)
+    {
+        _addr.s_addr = _top[i]->ip;
+        fprintf(out, "- %-15s %u throttled\n", inet_ntoa(_addr), _top[i]->throttled);
+    }
+    pthread_mutex_unlock(&rl.lock);
+}
@@ -0,0 +1,397 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     series.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that writes a time series of a run (--series PATH),
+|               used by both the server and the client. Every interval
+|               (default 1 s) one line is appended with the requests/sec,
+|               bytes/sec, open connections and latency percentiles of that
+|               interval, as CSV or, when PATH ends in .json, as JSON lines,
+|               so warm-up, stalls and decay show up while the run goes.
+|
+|               Each thread counts into a slot of its own. Only the owner
+|               writes a slot, with relaxed atomic stores, and the reporter
+|               thread reads every slot the same way, so recording a request
+|               takes no lock and no shared cache line. Counters only grow;
+|               the reporter keeps the previous snapshot and reports the
+|               difference, which is also how an interval's histogram is
+|               obtained. Slots of exiting threads are folded into a retired
+|               total (the thread backend has one thread per connection), see
+|               perthread.c.
+|               The same slots feed the server's shared memory stats page
+|               (see shmstat.c), which also counts event loop wake ups.
+------------------------------------------------------------------------------*/
+#include "../include/series.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* --- Global ---- */
+struct series series = {0};
+
+static struct slot_reg series_slots = SLOTS_INITIALIZER;
+static struct series_slot series_retired;           // folded slots of exited threads
+static struct series_slot series_prev;              // totals at the last snapshot
+static __thread void *series_mine = NULL;
+
+static void *series_reporter(void *arg);
+static void series_snapshot(uint64_t now);
+static void series_fold(struct series_slot *dst, struct series_slot *src);
+static void series_retire(void *arg);
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int series_init(const char *path, int interval_ms, int *active)
+|                   *path       : file to write to, "-" for stdout
+|                   interval_ms : ms between snapshots
+|                   *active     : open connection count to sample
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Opens the output, writes the CSV header and starts the
+|               reporter helper thread.
+------------------------------------------------------------------------------*/
+int series_init(const char *path, int interval_ms, int *active)
+{
+    const char *_ext = strrchr(path, '.');
+
+    if(strcmp(path, "-") == 0)
+        series.out = stdout;
+    else if((series.out = fopen(path, "w")) == NULL)
+    {
+        printf("\tError opening time series file %s\n", path);
+        return -1;
+    }
+
+    if(series_keep() == -1)
+        return -1;
+
+    series.json = _ext != NULL && strcmp(_ext, ".json") == 0;
+    series.interval_ms = interval_ms;
+    series.active = active;
+    series.t0 = now_ns();
+
+    if(!series.json)
+        fprintf(series.out, "time_s,requests_per_s,mbytes_per_s,active,lat_samples,"
+                            "p50_us,p90_us,p99_us,p999_us\n");
+
+    __atomic_store_n(&series.on, 1, __ATOMIC_RELEASE);
+
+    if(spawn_helper_thread(&series.thread, series_reporter) == -1)
+    {
+        printf("\tError creating time series reporter\n");
+        series.on = 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int series_keep()
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Starts keeping per-thread slots, for the time series or the
+|               stats page, whichever asks first. Later calls do nothing.
+------------------------------------------------------------------------------*/
+int series_keep()
+{
+    if(series.keep)
+        return 0;
+
+    if(slots_init(&series_slots, sizeof(struct series_slot), NULL, series_retire) == -1)
+    {
+        printf("\tError creating time series key\n");
+        return -1;
+    }
+
+    __atomic_store_n(&series.keep, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void series_add(uint64_t bytes, uint64_t lat_ns)
+|                   bytes  : bytes the request moved
+|                   lat_ns : its latency, 0 if it was not timed
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Counts one request in the calling thread's slot. Does nothing
+|               unless slots are being kept.
+------------------------------------------------------------------------------*/
+void series_add(uint64_t bytes, uint64_t lat_ns)
+{
+    struct series_slot *_slot;
+    int _b;
+
+    if(!series.keep || (_slot = slots_get(&series_slots, &series_mine)) == NULL)
+        return;
+
+    // single writer: plain increments published with relaxed stores
+    __atomic_store_n(&_slot->requests, _slot->requests + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&_slot->bytes, _slot->bytes + bytes, __ATOMIC_RELAXED);
+    if(lat_ns != 0)
+    {
+        _b = hist_bucket(lat_ns);
+        __atomic_store_n(&_slot->lat[_b], _slot->lat[_b] + 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&_slot->lat_count, _slot->lat_count + 1, __ATOMIC_RELAXED);
+    }
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void series_loop(int events)
+|                   events : events the wait returned (0 on timeout or error)
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Counts one wake up of the calling thread's event loop. Like
+|               series_add(), only while slots are being kept.
+------------------------------------------------------------------------------*/
+void series_loop(int events)
+{
+    struct series_slot *_slot;
+
+    if(!series.keep || (_slot = slots_get(&series_slots, &series_mine)) == NULL)
+        return;
+
+    __atomic_store_n(&_slot->loops, _slot->loops + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&_slot->events, _slot->events + events, __ATOMIC_RELAXED);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int series_collect(struct series_slot *total,
+|                                  struct series_slot *threads, int max)
+|                   *total   : set to the sum of every slot, retired included
+|                   *threads : set to copies of the first 'max' live slots
+|                   max      : room in 'threads' (may be 0)
+|
+|   RETURN:     number of live slots
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Snapshot of the counters, read the same way the reporter
+|               reads them. Live slots are listed newest first.
+------------------------------------------------------------------------------*/
+int series_collect(struct series_slot *total, struct series_slot *threads, int max)
+{
+    int _n = 0;
+
+    pthread_mutex_lock(&series_slots.lock);
+    *total = series_retired;
+    for(struct slot_link *l = series_slots.live; l != NULL; l = l->next, _n++)
+    {
+        series_fold(total, (struct series_slot *)l);
+        if(_n < max)
+        {
+            memset(&threads[_n], 0, sizeof(threads[_n]));
+            series_fold(&threads[_n], (struct series_slot *)l);
+            threads[_n].link.id = l->id;
+        }
+    }
+    pthread_mutex_unlock(&series_slots.lock);
+
+    return _n;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void series_stop()
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Stops the reporter, which writes the last (partial) interval,
+|               and closes the output.
+------------------------------------------------------------------------------*/
+void series_stop()
+{
+    if(!series.on)
+        return;
+
+    __atomic_store_n(&series.stop, 1, __ATOMIC_RELEASE);
+    pthread_join(series.thread, NULL);
+    series.on = 0;
+
+    if(series.out != stdout)
+        fclose(series.out);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   static void *series_reporter(void *arg)
+|                   *arg : unused
+|
+|   RETURN:     NULL
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Reporter thread. Snapshots are due at fixed offsets from the
+|               start so the intervals don't drift; the thread naps in short
+|               steps so series_stop() is not kept waiting a whole interval.
+------------------------------------------------------------------------------*/
+static void *series_reporter(void *arg)
+{
+    uint64_t _due = series.t0, _now;
+    struct timespec _ts = {0, SERIES_NAP * 1000000L};
+
+    (void)arg;
+    _due += series.interval_ms * 1000000ull;
+
+    while(1)
+    {
+        if(__atomic_load_n(&series.stop, __ATOMIC_ACQUIRE))
+        {
+            series_snapshot(now_ns());
+            return NULL;
+        }
+
+        if((_now = now_ns()) >= _due)
+        {
+            series_snapshot(_now);
+            _due += series.interval_ms * 1000000ull;
+            continue;
+        }
+
+        if(_due - _now < SERIES_NAP * 1000000ull)
+            _ts.tv_nsec = _due - _now;
+        else
+            _ts.tv_nsec = SERIES_NAP * 1000000L;
+        nanosleep(&_ts, NULL);
+    }
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   static void series_snapshot(uint64_t now)
+|                   now : time of the snapshot
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Sums every slot, subtracts the previous sums and writes the
+|               interval's line.
+------------------------------------------------------------------------------*/
+static void series_snapshot(uint64_t now)
+{
+    static uint64_t _last = 0;
+    struct series_slot _sum;
+    struct hist _delta;
+    double _secs, _t;
+
+    if(_last == 0)
+        _last = series.t0;
+    _secs = (now - _last) / 1e9;
+    _t = (now - series.t0) / 1e9;
+    _last = now;
+    if(_secs <= 0)
+        return;
+
+    series_collect(&_sum, NULL, 0);
+
+    // the interval's histogram is the growth of the buckets since the last snapshot
+    hist_init(&_delta);
+    for(int i = 0; i < HIST_BUCKETS; i++)
+        _delta.buckets[i] = _sum.lat[i] - series_prev.lat[i];
+    _delta.count = _sum.lat_count - series_prev.lat_count;
+    _delta.min = 0;
+    _delta.max = UINT64_MAX;
+
+    if(series.json)
+        fprintf(series.out, "{\"time_s\":%.3f,\"requests_per_s\":%.1f,\"mbytes_per_s\":%.3f,"
+                "\"active\":%d,\"lat_samples\":%llu,\"p50_us\":%.1f,\"p90_us\":%.1f,"
+                "\"p99_us\":%.1f,\"p999_us\":%.1f}\n", _t,
+                (_sum.requests - series_prev.requests) / _secs,
+                (_sum.bytes - series_prev.bytes) / _secs / 1e6,
+                series.active != NULL ? __atomic_load_n(series.active, __ATOMIC_RELAXED) : 0,
+                (unsigned long long)_delta.count,
+                hist_percentile(&_delta, 50) / 1e3, hist_percentile(&_delta, 90) / 1e3,
+                hist_percentile(&_delta, 99) / 1e3, hist_percentile(&_delta, 99.9) / 1e3);
+    else
+        fprintf(series.out, "%.3f,%.1f,%.3f,%d,%llu,%.1f,%.1f,%.1f,%.1f\n", _t,
+                (_sum.requests - series_prev.requests) / _secs,
+                (_sum.bytes - series_prev.bytes) / _secs / 1e6,
+                series.active != NULL ? __atomic_load_n(series.active, __ATOMIC_RELAXED) : 0,
+                (unsigned long long)_delta.count,
+                hist_percentile(&_delta, 50) / 1e3, hist_percentile(&_delta, 90) / 1e3,
+                hist_percentile(&_delta, 99) / 1e3, hist_percentile(&_delta, 99.9) / 1e3);
+    fflush(series.out);
+
+    series_prev = _sum;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   static void series_fold(struct series_slot *dst, struct series_slot *src)
+|                   *dst : totals to add to
+|                   *src : slot to add (may be written concurrently)
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Adds the counters of 'src' to 'dst'. A request being recorded
+|               meanwhile lands in this snapshot or the next.
+------------------------------------------------------------------------------*/
+static void series_fold(struct series_slot *dst, struct series_slot *src)
+{
+    dst->requests += __atomic_load_n(&src->requests, __ATOMIC_RELAXED);
+    dst->bytes += __atomic_load_n(&src->bytes, __ATOMIC_RELAXED);
+    dst->lat_count += __atomic_load_n(&src->lat_count, __ATOMIC_RELAXED);
+    for(int i = 0; i < HIST_BUCKETS; i++)
+        dst->lat[i] += __atomic_load_n(&src->lat[i], __ATOMIC_RELAXED);
+    dst->loops += __atomic_load_n(&src->loops, __ATOMIC_RELAXED);
+    dst->events += __atomic_load_n(&src->events, __ATOMIC_RELAXED);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   static void series_retire(void *arg)
+|                   *arg : slot of the exiting thread
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Called by the registry, with its lock held, when a thread
+|               exits: folds the slot into the retired total.
+------------------------------------------------------------------------------*/
+static void series_retire(void *arg)
+{
+    series_fold(&series_retired, arg);
+}
@@ -0,0 +1,215 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     shmstat.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that publishes the server's counters in a shared
+|               memory page, /dev/shm/srv_<pid>, for srvstat (or anything
+|               else) to map and read while the server runs: connections
+|               open and accepted, requests, bytes, sampled latency buckets
+|               and the counters of each thread, event loop wake ups
+|               included.
+|
+|               The hot path is not touched: requests are already counted
+|               in the time series' per-thread slots (see series.c), which
+|               are kept whenever the page is up. A publisher thread folds
+|               them every SHMSTAT_PERIOD ms and copies the result into the
+|               page under a seqlock. It is the only writer: it makes the
+|               sequence odd, writes, and makes it even again. A reader
+|               copies the data between two reads of the sequence and
+|               retries unless both were the same even number, so it never
+|               sees a torn update and never holds up the server. The page
+|               starts with a magic number, a layout version and its size so
+|               a reader built against another layout refuses it.
+------------------------------------------------------------------------------*/
+#include "../include/shmstat.h"
+#include "../include/series.h"
+#include "../include/perthread.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+
+/* --- Global ---- */
+struct shmstat shmstat = {0};
+
+static void *shmstat_publisher(void *arg);
+static void shmstat_publish();
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int shmstat_init(const char *backend, int *live, int *total)
+|                   *backend : name of the I/O model, shown by srvstat
+|                   *live    : open connection count to sample
+|                   *total   : accepted connection count to sample
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Creates and maps the page, fills in its header and starts
+|               the publisher helper thread.
+------------------------------------------------------------------------------*/
+int shmstat_init(const char *backend, int *live, int *total)
+{
+    struct shmstat_page *_page;
+    int _fd;
+
+    if(series_keep() == -1)
+        return -1;
+
+    snprintf(shmstat.name, sizeof(shmstat.name), SHMSTAT_NAME, (int)getpid());
+    if((_fd = shm_open(shmstat.name, O_CREAT | O_RDWR | O_TRUNC, 0644)) == -1)
+    {
+        printf("\tError creating stats page %s\n", shmstat.name);
+        printf("\tError code: %s\n\n", strerror(errno));
+        return -1;
+    }
+
+    if(ftruncate(_fd, sizeof(*_page)) == -1
+       || (_page = mmap(NULL, sizeof(*_page), PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0)) == MAP_FAILED)
+    {
+        printf("\tError mapping stats page %s\n", shmstat.name);
+        printf("\tError code: %s\n\n", strerror(errno));
+        close(_fd);
+        shm_unlink(shmstat.name);
+        return -1;
+    }
+    close(_fd);
+
+    // the file is zero filled, so the sequence starts even with empty data
+    _page->magic = SHMSTAT_MAGIC;
+    _page->version = SHMSTAT_VERSION;
+    _page->size = sizeof(*_page);
+    _page->pid = getpid();
+    _page->t_start = now_ns();
+    snprintf(_page->backend, sizeof(_page->backend), "%s", backend);
+
+    shmstat.page = _page;
+    shmstat.live = live;
+    shmstat.total = total;
+
+    if(spawn_helper_thread(&shmstat.thread, shmstat_publisher) == -1)
+    {
+        printf("\tError creating stats page publisher\n");
+        munmap(_page, sizeof(*_page));
+        shm_unlink(shmstat.name);
+        return -1;
+    }
+
+    shmstat.on = 1;
+    printf("- Stats page: %s%s\n", SHMSTAT_DIR, shmstat.name);
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void shmstat_stop()
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Stops the publisher and removes the page. A reader that still
+|               has it mapped keeps the last update; the name is gone, which
+|               is how it tells the server has exited.
+------------------------------------------------------------------------------*/
+void shmstat_stop()
+{
+    if(!shmstat.on)
+        return;
+
+    __atomic_store_n(&shmstat.stop, 1, __ATOMIC_RELEASE);
+    pthread_join(shmstat.thread, NULL);
+    shmstat.on = 0;
+
+    shm_unlink(shmstat.name);
+    munmap(shmstat.page, sizeof(*shmstat.page));
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   static void *shmstat_publisher(void *arg)
+|                   *arg : unused
+|
+|   RETURN:     NULL
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Publisher thread, updates the page every SHMSTAT_PERIOD ms
+|               and once more when stopped.
+------------------------------------------------------------------------------*/
+static void *shmstat_publisher(void *arg)
+{
+    struct timespec _ts = {0, SHMSTAT_PERIOD * 1000000L};
+
+    (void)arg;
+    while(!__atomic_load_n(&shmstat.stop, __ATOMIC_ACQUIRE))
+    {
+        shmstat_publish();
+        nanosleep(&_ts, NULL);
+    }
+    shmstat_publish();
+
+    return NULL;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   static void shmstat_publish()
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Folds the per-thread slots and writes the page's data under
+|               the seqlock. The update is built aside first so the sequence
+|               is odd only for the length of one copy.
+------------------------------------------------------------------------------*/
+static void shmstat_publish()
+{
+    static struct series_slot _threads[SHMSTAT_THREADS];
+    static struct shmstat_data _data;
+    struct shmstat_page *_page = shmstat.page;
+    struct series_slot _total;
+    uint64_t _seq;
+
+    _data.nthreads = series_collect(&_total, _threads, SHMSTAT_THREADS);
+    _data.shown = _data.nthreads < SHMSTAT_THREADS ? _data.nthreads : SHMSTAT_THREADS;
+    _data.t_update = now_ns();
+    _data.updates++;
+    _data.live = __atomic_load_n(shmstat.live, __ATOMIC_RELAXED);
+    _data.total = __atomic_load_n(shmstat.total, __ATOMIC_RELAXED);
+    _data.requests = _total.requests;
+    _data.bytes = _total.bytes;
+    _data.loops = _total.loops;
+    _data.events = _total.events;
+    _data.lat_count = _total.lat_count;
+    memcpy(_data.lat, _total.lat, sizeof(_data.lat));
+    for(int i = 0; i < _data.shown; i++)
+    {
+        _data.thread[i].id = _threads[i].link.id;
+        _data.thread[i].requests = _threads[i].requests;
+        _data.thread[i].bytes = _threads[i].bytes;
+        _data.thread[i].loops = _threads[i].loops;
+        _data.thread[i].events = _threads[i].events;
+    }
+
+    // odd while writing; the fence keeps the data stores after it
+    _seq = _page->seq;
+    __atomic_store_n(&_page->seq, _seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&_page->data, &_data, sizeof(_data));
+    __atomic_store_n(&_page->seq, _seq + 2, __ATOMIC_RELEASE);
+}
@@ -3,17 +3,34 @@
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Module that provides socket wrapper function calls
+|   DESC:       Module that provides socket wrapper function calls and the
+|               socket option profiles shared by the servers and the client.
 ------------------------------------------------------------------------------*/
 #include "../include/socket.h"
 #include <stdio.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <errno.h>
 #include <string.h>
 #include <fcntl.h>
 #include <omp.h>
+#include <poll.h>
+#include <sys/resource.h>
+
+/* --- Global ---- */
+static const struct sock_profile profiles[] =
+{
+    // name        desc                                               nd qa sndbuf   rcvbuf   da tfo   lowat
+    {"default",    "kernel defaults",                                 0, 0, 0,       0,       0, 0,    0},
+    {"latency",    "no Nagle, quick acks, fast open, small send queue", 1, 1, 0,     0,       0, 256,  16384},
+    {"throughput", "Nagle on, 4 MB buffers",                          0, 0, 4 << 20, 4 << 20, 0, 0,    0},
+    {"manyconn",   "16 KB buffers, deferred accept, no Nagle",        1, 0, 16384,   16384,   1, 1024, 0},
+    {NULL, NULL, 0, 0, 0, 0, 0, 0, 0}
+};
+
+static int set_opt(int sd, int level, int name, int val, const char *what);
 
 
 /*------------------------------------------------------------------------------
@@ -129,6 +146,64 @@ int connect_socket(int sd, const struct sockaddr *addr, socklen_t len)
 }
 
 
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int connect_socket_timeout(int sd, const struct sockaddr *addr,
+|                                          socklen_t len, int ms)
+|                   sd    : socket descriptor to use for connection
+|                   *addr : addr to connect to
+|                   len   : size of addr
+|                   ms    : max time to wait for the handshake (ms)
+|
+|   RETURN:     0 on success, -1 on failure with errno set (ETIMEDOUT if the
+|               handshake did not complete within 'ms')
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Connects with a bounded wait by connecting non-blocking and
+|               polling for completion. The socket is left blocking again.
+|               Errors are not printed so callers can classify them quietly
+|               during connect storms.
+------------------------------------------------------------------------------*/
+int connect_socket_timeout(int sd, const struct sockaddr *addr, socklen_t len, int ms)
+{
+    struct pollfd _pfd;
+    socklen_t _errlen = sizeof(int);
+    int _flags, _err = 0, _ret;
+
+    _flags = fcntl(sd, F_GETFL, 0);
+    fcntl(sd, F_SETFL, _flags | O_NONBLOCK);
+
+    if((_ret = connect(sd, addr, len)) == -1 && errno == EINPROGRESS)
+    {
+        _pfd.fd = sd;
+        _pfd.events = POLLOUT;
+        while((_ret = poll(&_pfd, 1, ms)) == -1 && errno == EINTR)
+            ;
+
+        if(_ret == 0)
+            _err = ETIMEDOUT;
+        else if(_ret == -1)
+            _err = errno;
+        else
+            getsockopt(sd, SOL_SOCKET, SO_ERROR, &_err, &_errlen);
+    }
+    else if(_ret == -1)
+        _err = errno;
+
+    fcntl(sd, F_SETFL, _flags);
+
+    if(_err != 0)
+    {
+        errno = _err;
+        return -1;
+    }
+
+    return 0;
+}
+
+
 /*------------------------------------------------------------------------------
 |   FUNCTION:   int set_nonblocking(int *sd)
 |                   *sd : pointer to the socket to make non-blocking
@@ -205,6 +280,66 @@ int set_blocking(int *sd)
 }
 
 
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int set_reuseaddr(int sd)
+|                   sd : socket to set SO_REUSEADDR on
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Wrapper function to allow binding an address still held by a
+|               socket in TIME_WAIT.
+------------------------------------------------------------------------------*/
+int set_reuseaddr(int sd)
+{
+    int _optval = 1;
+
+    if(setsockopt(sd, SOL_SOCKET, SO_REUSEADDR, &_optval, sizeof(_optval)) == -1)
+    {
+        printf("\tError setting SO_REUSEADDR\n");
+        printf("\tError code: %s\n\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int set_linger(int sd, int secs)
+|                   sd   : socket to set SO_LINGER on
+|                   secs : linger time, 0 to reset the connection on close
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Wrapper function to enable SO_LINGER. With a linger time of 0
+|               close() sends a RST instead of a FIN, so the closing side does
+|               not keep the port in TIME_WAIT.
+------------------------------------------------------------------------------*/
+int set_linger(int sd, int secs)
+{
+    struct linger _lin;
+
+    _lin.l_onoff = 1;
+    _lin.l_linger = secs;
+    if(setsockopt(sd, SOL_SOCKET, SO_LINGER, &_lin, sizeof(_lin)) == -1)
+    {
+        printf("\tError setting SO_LINGER\n");
+        printf("\tError code: %s\n\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+
 /*------------------------------------------------------------------------------
 |   FUNCTION:   void fill_addr(struct sockaddr_in *addr, int domain, unsigned short port, unsigned long ip)
 |                   *addr  : addr struct to fill in
@@ -226,3 +361,245 @@ void fill_addr(struct sockaddr_in *addr, int domain, unsigned short port, unsign
     addr->sin_port = port;
     addr->sin_addr.s_addr = ip;
 }
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int fill_unix_addr(struct sockaddr_un *addr, const char *path)
+|                   *addr : addr struct to fill in
+|                   *path : socket file path
+|
+|   RETURN:     0 on success, -1 if the path does not fit
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Fills out sockaddr_un struct
+------------------------------------------------------------------------------*/
+int fill_unix_addr(struct sockaddr_un *addr, const char *path)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(addr->sun_path))
+    {
+        printf("\tError: unix socket path too long: %s\n\n", path);
+        return -1;
+    }
+    strcpy(addr->sun_path, path);
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   long raise_fd_limit()
+|
+|   RETURN:     the open file limit now in effect
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Raises RLIMIT_NOFILE as far as allowed: to fs.nr_open when the
+|               process may raise its hard limit, otherwise to the hard limit.
+------------------------------------------------------------------------------*/
+long raise_fd_limit()
+{
+    struct rlimit _rl;
+    long _nr_open = 0;
+    FILE *_f;
+
+    if(getrlimit(RLIMIT_NOFILE, &_rl) == -1)
+        return -1;
+
+    if((_f = fopen("/proc/sys/fs/nr_open", "r")) != NULL)
+    {
+        if(fscanf(_f, "%ld", &_nr_open) != 1)
+            _nr_open = 0;
+        fclose(_f);
+    }
+
+    if(_nr_open > 0 && (rlim_t)_nr_open > _rl.rlim_max)
+    {
+        struct rlimit _want = {(rlim_t)_nr_open, (rlim_t)_nr_open};
+
+        if(setrlimit(RLIMIT_NOFILE, &_want) == 0)
+            return _nr_open;
+    }
+
+    _rl.rlim_cur = _rl.rlim_max;
+    if(setrlimit(RLIMIT_NOFILE, &_rl) == -1)
+    {
+        printf("\tError raising open file limit\n");
+        printf("\tError code: %s\n\n", strerror(errno));
+        getrlimit(RLIMIT_NOFILE, &_rl);
+    }
+
+    return (long)_rl.rlim_cur;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   const struct sock_profile *find_profile(const char *name)
+|                   *name : profile name
+|
+|   RETURN:     pointer to profile, NULL if no profile has that name
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Looks up a socket profile by name.
+------------------------------------------------------------------------------*/
+const struct sock_profile *find_profile(const char *name)
+{
+    for(int i = 0; profiles[i].name != NULL; i++)
+        if(strcmp(profiles[i].name, name) == 0)
+            return &profiles[i];
+
+    return NULL;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   const struct sock_profile *profile_at(int i)
+|                   i : index of profile
+|
+|   RETURN:     i-th profile, NULL past the last one
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Lets callers walk the profile table (usage, autotuning).
+------------------------------------------------------------------------------*/
+const struct sock_profile *profile_at(int i)
+{
+    return profiles[i].name != NULL ? &profiles[i] : NULL;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int apply_listen_profile(int sd, const struct sock_profile *p)
+|                   sd : listening socket (before listen())
+|                   *p : profile to apply
+|
+|   RETURN:     0 on success, -1 if any option could not be set
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Sets the listener-only options. Buffer sizes are set here too
+|               because the window scale is negotiated from the listener's
+|               receive buffer during the handshake.
+------------------------------------------------------------------------------*/
+int apply_listen_profile(int sd, const struct sock_profile *p)
+{
+    int _ret = 0;
+
+    if(p->sndbuf > 0)
+        _ret |= set_opt(sd, SOL_SOCKET, SO_SNDBUF, p->sndbuf, "SO_SNDBUF");
+    if(p->rcvbuf > 0)
+        _ret |= set_opt(sd, SOL_SOCKET, SO_RCVBUF, p->rcvbuf, "SO_RCVBUF");
+    if(p->defer_accept > 0)
+        _ret |= set_opt(sd, IPPROTO_TCP, TCP_DEFER_ACCEPT, p->defer_accept, "TCP_DEFER_ACCEPT");
+    if(p->fastopen > 0)
+        _ret |= set_opt(sd, IPPROTO_TCP, TCP_FASTOPEN, p->fastopen, "TCP_FASTOPEN");
+
+    return _ret;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int apply_conn_profile(int sd, const struct sock_profile *p,
+|                                      int client)
+|                   sd     : connected socket, or client socket before connect()
+|                   *p     : profile to apply
+|                   client : 1 when called on a client socket before connect()
+|
+|   RETURN:     0 on success, -1 if any option could not be set
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Sets the per-connection options. On the client side fast open
+|               uses TCP_FASTOPEN_CONNECT, so connect() itself is unchanged.
+------------------------------------------------------------------------------*/
+int apply_conn_profile(int sd, const struct sock_profile *p, int client)
+{
+    int _ret = 0;
+
+    if(p->nodelay)
+        _ret |= set_opt(sd, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+    if(p->quickack)
+        _ret |= set_opt(sd, IPPROTO_TCP, TCP_QUICKACK, 1, "TCP_QUICKACK");
+    if(p->sndbuf > 0)
+        _ret |= set_opt(sd, SOL_SOCKET, SO_SNDBUF, p->sndbuf, "SO_SNDBUF");
+    if(p->rcvbuf > 0)
+        _ret |= set_opt(sd, SOL_SOCKET, SO_RCVBUF, p->rcvbuf, "SO_RCVBUF");
+    if(p->notsent_lowat > 0)
+        _ret |= set_opt(sd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, p->notsent_lowat, "TCP_NOTSENT_LOWAT");
+#ifdef TCP_FASTOPEN_CONNECT
+    if(client && p->fastopen > 0)
+        _ret |= set_opt(sd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, 1, "TCP_FASTOPEN_CONNECT");
+#else
+    (void)client;
+#endif
+
+    return _ret;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void rearm_quickack(int sd, const struct sock_profile *p)
+|                   sd : connected socket
+|                   *p : profile in use
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       TCP_QUICKACK is not sticky, the kernel drops back to delayed
+|               acks on its own, so profiles using it re-arm it after reads.
+------------------------------------------------------------------------------*/
+void rearm_quickack(int sd, const struct sock_profile *p)
+{
+    int _optval = 1;
+
+    if(p->quickack)
+        setsockopt(sd, IPPROTO_TCP, TCP_QUICKACK, &_optval, sizeof(_optval));
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   static int set_opt(int sd, int level, int name, int val,
+|                                  const char *what)
+|                   sd    : socket
+|                   level : option level
+|                   name  : option name
+|                   val   : integer value
+|                   *what : option name for the error message
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Sets one integer socket option, printing an error on failure.
+------------------------------------------------------------------------------*/
+static int set_opt(int sd, int level, int name, int val, const char *what)
+{
+    if(setsockopt(sd, level, name, &val, sizeof(val)) == -1)
+    {
+        printf("\tError setting %s\n", what);
+        printf("\tError code: %s\n\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,498 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     srv.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that represents the echo server program. The program
+|               takes in 1 cmd argument and optional flags:
+|                   - host port
+|                   - -b : backend (I/O model) to run
+|                   - -n : worker threads / shards for pooled backends
+|                   - -d : how new connections are dispatched to shards
+|                   - -m : max connections per shard
+|                   - -w : synthetic work done per request
+|                   - -k : serve the key-value protocol instead of echo
+|                   - -S : time 1 in N requests stage by stage
+|                   - -t : record an event trace (dumped on SIGUSR1 / exit)
+|                   - -p : socket option profile
+|                   - -u : also listen on a unix stream socket
+|                   - --seqpacket : also listen on a unix seqpacket socket
+|                   - -M : scale mode for very large connection counts
+|                   - --stack, --guard : connection thread stack and guard size
+|                   - --thread-cache : idle connection threads kept for reuse
+|                   - --no-steal : steal backend without stealing (baseline)
+|                   - --max-conns, --max-lag, --reject : admission control
+|                   - --rate, --burst : per client address request rate limit
+|                   - -a : log per client address totals every N secs instead
+|                          of a line per connection
+|                   - --series, --interval : time series of the run
+|
+|                   Usage: ./srv [-b BACKEND] [-n THREADS] [-d rr|ll]
+|                                [-m MAX PER SHARD] [-w WORK]
+|                                [-k [--kv-shards N]] [-S N] [-t]
+|                                [-p PROFILE] [-u PATH] [--seqpacket PATH]
+|                                [-M] [--stack KB] [--guard KB]
+|                                [--thread-cache N] [--no-steal]
+|                                [--max-conns N] [--max-lag US]
+|                                [--reject close|pause]
+|                                [--rate R [--burst B]] [-a SECS]
+|                                [--series PATH [--interval MS]] <PORT>
+|
+|               Every backend shares the same connection/echo/stats core in
+|               srv_engine.c and only differs in how it waits for sockets to
+|               become ready. The srv_thread, srv_poll, srv_epoll and srv_fiber
+|               targets are this program built with a different default
+|               backend. Every server publishes its counters in the stats
+|               page /dev/shm/srv_<pid> (see shmstat.c), watched with srvstat.
+------------------------------------------------------------------------------*/
+#include "../include/srv_engine.h"
+#include "../include/srv_thread.h"
+#include "../include/srv_pool.h"
+#include "../include/srv_poll.h"
+#include "../include/srv_pollshard.h"
+#include "../include/srv_epoll.h"
+#include "../include/srv_fiber.h"
+#include "../include/srv_steal.h"
+#include "../include/log.h"
+#include "../include/socket.h"
+#include "../include/work.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#ifndef DEFBACKEND
+#define DEFBACKEND "epoll"
+#endif
+
+/* --- Global ---- */
+static const struct srv_backend *backends[] =
+{
+    &thread_backend,
+    &pool_backend,
+    &poll_backend,
+    &pollshard_backend,
+    &epoll_backend,
+#if defined(__x86_64__)     // fiber switching is x86-64 assembly
+    &fiber_backend,
+#endif
+    &steal_backend,
+    NULL
+};
+
+/* ---- Function Prototypes ---- */
+int parse_args(int argc, char **argv, struct srv_nw_var *nw, struct srv_config *cfg);
+int valid_port(char *port);
+const struct srv_backend *find_backend(const char *name);
+void print_usage(char *prog);
+
+/*==============================================================================
+|   FUNCTION:   int main(int argc, char **argv)
+|                   argc   : number of cmd args
+|                   **argv : array of args
+|
+|   RETURN:     0 on success
+|
+|   DATE:       Feb 19, 2018
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Main entry point of the program.
+==============================================================================*/
+int main(int argc, char **argv)
+{
+    struct srv_nw_var nw_var;
+    struct srv_config cfg;
+
+    if(!parse_args(argc, argv, &nw_var, &cfg))  // check for valid args
+        exit(1);
+
+    // append header to server log file
+    if((cfg.aggregate >= 0 ? ipstats_hdr(cfg.logfile, cfg.aggregate) : app_srv_hdr(cfg.logfile)) == -1)
+        exit(1);
+
+    if(run_srv(&nw_var, &cfg) == -1)
+        exit(1);
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int parse_args(int argc, char **argv, struct srv_nw_var *nw,
+|                              struct srv_config *cfg)
+|                   argc   : number of cmd args
+|                   **argv : array of args
+|                   *nw    : network variables to fill in (port)
+|                   *cfg   : runtime options to fill in
+|
+|   RETURN:     1 on true, 0 on false
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Parses the option flags and the port argument. Returns true (1)
+|               if args are valid, otherwise prints the usage and returns
+|               false (0).
+------------------------------------------------------------------------------*/
+int parse_args(int argc, char **argv, struct srv_nw_var *nw, struct srv_config *cfg)
+{
+    static struct option _opts[] =
+    {
+        {"backend", required_argument, NULL, 'b'},
+        {"threads", required_argument, NULL, 'n'},
+        {"dispatch", required_argument, NULL, 'd'},
+        {"shard-max", required_argument, NULL, 'm'},
+        {"work",    required_argument, NULL, 'w'},
+        {"kv",      no_argument,       NULL, 'k'},
+        {"kv-shards", required_argument, NULL, 'K'},
+        {"sample",  required_argument, NULL, 'S'},
+        {"trace",   no_argument,       NULL, 't'},
+        {"profile", required_argument, NULL, 'p'},
+        {"unix",    required_argument, NULL, 'u'},
+        {"seqpacket", required_argument, NULL, 'Q'},
+        {"scale",   no_argument,       NULL, 'M'},
+        {"stack",   required_argument, NULL, 'Z'},
+        {"guard",   required_argument, NULL, 'G'},
+        {"thread-cache", required_argument, NULL, 'C'},
+        {"no-steal", no_argument,      NULL, 'N'},
+        {"max-conns", required_argument, NULL, 'X'},
+        {"max-lag", required_argument, NULL, 'L'},
+        {"reject",  required_argument, NULL, 'R'},
+        {"rate",    required_argument, NULL, 'r'},
+        {"burst",   required_argument, NULL, 'B'},
+        {"aggregate", required_argument, NULL, 'a'},
+        {"series",  required_argument, NULL, 'E'},
+        {"interval", required_argument, NULL, 'i'},
+        {"help",    no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int _opt;
+
+    cfg->backend = find_backend(DEFBACKEND);
+    cfg->threads = DEFTHREADS;
+    cfg->dispatch = DISPATCH_RR;
+    cfg->shard_max = 0;
+    cfg->work.model = WORK_NONE;
+    cfg->work.arg = 0;
+    cfg->handler = HANDLER_ECHO;
+    cfg->kv_shards = sysconf(_SC_NPROCESSORS_ONLN);
+    cfg->sample = DEFSAMPLE;
+    cfg->trace = 0;
+    cfg->profile = find_profile("default");
+    cfg->scale = 0;
+    cfg->idle_timeout = IDLETIMEOUT;
+    cfg->stack_kb = DEFSTACK;
+    cfg->guard_kb = DEFGUARD;
+    cfg->thread_cache = DEFTHREADCACHE;
+    cfg->steal = 1;
+    cfg->max_conns = 0;
+    cfg->max_lag_us = 0;
+    cfg->reject = REJECT_CLOSE;
+    cfg->rate = 0;
+    cfg->burst = 0;
+    cfg->aggregate = -1;
+    cfg->series = NULL;
+    cfg->interval_ms = DEFINTERVAL;
+    nw->unix_path = NULL;
+    nw->seq_path = NULL;
+
+    while((_opt = getopt_long(argc, argv, "b:n:d:m:w:kS:tp:u:Ma:h", _opts, NULL)) != -1)
+    {
+        switch(_opt)
+        {
+            case 'b':
+                if((cfg->backend = find_backend(optarg)) == NULL)
+                {
+                    printf("\nError: Unknown backend: %s.\n", optarg);
+                    print_usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'n':
+                if((cfg->threads = atoi(optarg)) < 1)
+                {
+                    printf("\nError: Invalid number of threads: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'd':
+                if(strcmp(optarg, "rr") == 0)
+                    cfg->dispatch = DISPATCH_RR;
+                else if(strcmp(optarg, "ll") == 0)
+                    cfg->dispatch = DISPATCH_LL;
+                else
+                {
+                    printf("\nError: Invalid dispatch policy: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'm':
+                if((cfg->shard_max = atoi(optarg)) < 0)
+                {
+                    printf("\nError: Invalid shard max: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'w':
+                if(parse_work(optarg, &cfg->work) == -1)
+                {
+                    printf("\nError: Invalid work model: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'k':
+                cfg->handler = HANDLER_KV;
+                break;
+            case 'K':
+                if((cfg->kv_shards = atoi(optarg)) < 1)
+                {
+                    printf("\nError: Invalid number of kv shards: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'S':
+                if(!isdigit(optarg[0]) || (cfg->sample = atoi(optarg)) < 0)
+                {
+                    printf("\nError: Invalid sample rate: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 't':
+                cfg->trace = 1;
+                break;
+            case 'p':
+                if((cfg->profile = find_profile(optarg)) == NULL)
+                {
+                    printf("\nError: Unknown socket profile: %s.\n", optarg);
+                    print_usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'u':
+                nw->unix_path = optarg;
+                break;
+            case 'Q':
+                nw->seq_path = optarg;
+                break;
+            case 'M':
+                cfg->scale = 1;
+                cfg->idle_timeout = -1;     // idle connections are the point
+                break;
+            case 'Z':
+                if((cfg->stack_kb = atoi(optarg)) < 1)
+                {
+                    printf("\nError: Invalid stack size: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'G':
+                if(!isdigit(optarg[0]) || (cfg->guard_kb = atoi(optarg)) < 0)
+                {
+                    printf("\nError: Invalid guard size: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'C':
+                if(!isdigit(optarg[0]) || (cfg->thread_cache = atoi(optarg)) < 0)
+                {
+                    printf("\nError: Invalid thread cache size: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'N':
+                cfg->steal = 0;
+                break;
+            case 'X':
+                if(!isdigit(optarg[0]) || (cfg->max_conns = atoi(optarg)) < 0)
+                {
+                    printf("\nError: Invalid connection limit: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'L':
+                if(!isdigit(optarg[0]) || (cfg->max_lag_us = atol(optarg)) < 0)
+                {
+                    printf("\nError: Invalid loop lag limit: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'R':
+                if((cfg->reject = parse_reject(optarg)) == -1)
+                {
+                    printf("\nError: Invalid reject policy: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'r':
+                if(!isdigit(optarg[0]) || (cfg->rate = atoi(optarg)) < 0)
+                {
+                    printf("\nError: Invalid request rate: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'B':
+                if((cfg->burst = atoi(optarg)) < 1)
+                {
+                    printf("\nError: Invalid burst size: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'a':
+                if(!isdigit(optarg[0]) || (cfg->aggregate = atoi(optarg)) < 0)
+                {
+                    printf("\nError: Invalid summary interval: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            case 'E':
+                cfg->series = optarg;
+                break;
+            case 'i':
+                if((cfg->interval_ms = atoi(optarg)) < 1)
+                {
+                    printf("\nError: Invalid time series interval: %s.\n\n", optarg);
+                    return 0;
+                }
+                break;
+            default:
+                print_usage(argv[0]);
+                return 0;
+        }
+    }
+
+    // check valid number of args (1 port)
+    if(argc - optind != 1)
+    {
+        print_usage(argv[0]);
+        return 0;
+    }
+
+    if(!valid_port(argv[optind]))
+        return 0;
+
+    nw->port = atoi(argv[optind]);     // extract port from cmd arg
+    if(cfg->burst == 0)
+        cfg->burst = cfg->rate > 0 ? cfg->rate : 1;    // a second's worth by default
+    snprintf(cfg->logfile, LOGNAMESIZE, SRVLOGFMT, cfg->backend->name);
+    snprintf(cfg->tracefile, LOGNAMESIZE, TRACEFMT, cfg->backend->name);
+
+    return 1;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int valid_port(char *port)
+|                   *port : port argument
+|
+|   RETURN:     1 on true, 0 on false
+|
+|   DATE:       Feb 19, 2018
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Checks for a valid port. Returns true (1) if the port is valid,
+|               otherwise returns false (0).
+------------------------------------------------------------------------------*/
+int valid_port(char *port)
+{
+    // check for valid port
+    for(int i = 0; port[i] != '\0'; i++)
+        if(!isdigit(port[i]))
+        {
+            printf("\nError: Invalid port: %s.\n\n", port);
+            return 0;
+        }
+
+    return 1;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   const struct srv_backend *find_backend(const char *name)
+|                   *name : name of backend
+|
+|   RETURN:     pointer to backend, NULL if no backend has that name
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Looks up a backend in the backend table by name.
+------------------------------------------------------------------------------*/
+const struct srv_backend *find_backend(const char *name)
+{
+    for(int i = 0; backends[i] != NULL; i++)
+        if(strcmp(backends[i]->name, name) == 0)
+            return backends[i];
+
+    return NULL;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void print_usage(char *prog)
+|                   *prog : name the program was invoked with
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Prints the usage message along with the available backends.
+------------------------------------------------------------------------------*/
+void print_usage(char *prog)
+{
+    printf("\nUsage: %s [OPTIONS] <PORT>\n\n", prog);
+    printf("  -b, --backend NAME     I/O model (default %s)\n", DEFBACKEND);
+    printf("  -n, --threads N        worker threads / shards (default %d)\n", DEFTHREADS);
+    printf("  -d, --dispatch rr|ll   shard dispatch: round-robin or least loaded\n");
+    printf("  -m, --shard-max N      max connections per shard (default no max)\n");
+    printf("  -w, --work MODEL       per-request work: none, spin:NS, touch:BYTES,\n");
+    printf("                         hash or block:MS (default none)\n");
+    printf("  -k, --kv               serve GET/SET/DEL against an in-memory store\n");
+    printf("      --kv-shards N      store shards (default one per core)\n");
+    printf("  -S, --sample N         time 1 in N requests per stage, 0 = off\n");
+    printf("                         (default %d)\n", DEFSAMPLE);
+    printf("  -t, --trace            record an event trace, written as Chrome JSON\n");
+    printf("                         on SIGUSR1 and at exit\n");
+    printf("  -p, --profile NAME     socket options (default default)\n");
+    printf("  -u, --unix PATH        also listen on a unix stream socket\n");
+    printf("      --seqpacket PATH   also listen on a unix seqpacket socket\n");
+    printf("  -M, --scale            scale mode: raise the fd limit, deep backlog,\n");
+    printf("                         no per-connection output, no idle timeout and\n");
+    printf("                         memory per connection reported as clients grow\n");
+    printf("      --stack KB         connection thread / fiber stack (default %d)\n", DEFSTACK);
+    printf("      --guard KB         guard region below each stack (default %d)\n", DEFGUARD);
+    printf("      --thread-cache N   idle threads kept for reuse, 0 = exit on\n");
+    printf("                         disconnect (default %d)\n", DEFTHREADCACHE);
+    printf("      --no-steal         steal backend: keep connections on the worker\n");
+    printf("                         that accepted them (sharded baseline)\n");
+    printf("      --max-conns N      admit at most N open connections\n");
+    printf("      --max-lag US       shed new connections while the event loop lag\n");
+    printf("                         is over US microseconds (epoll, poll)\n");
+    printf("      --reject POLICY    close: accept and reset (default), pause: stop\n");
+    printf("                         accepting until load drops (epoll, poll)\n");
+    printf("      --rate R           at most R requests/sec per client address, held\n");
+    printf("                         back rather than dropped (epoll, thread, pool)\n");
+    printf("      --burst B          requests a client address may send at once\n");
+    printf("                         (default R)\n");
+    printf("  -a, --aggregate SECS   log totals per client address every SECS\n");
+    printf("                         seconds (0 = at exit) instead of a line per\n");
+    printf("                         connection\n");
+    printf("      --series PATH      write requests/sec, bytes/sec, connections and\n");
+    printf("                         latency every interval as CSV (JSON lines if\n");
+    printf("                         PATH ends in .json, - for stdout)\n");
+    printf("      --interval MS      time series period (default %d)\n\n", DEFINTERVAL);
+    printf("Backends:\n");
+    for(int i = 0; backends[i] != NULL; i++)
+        printf("  %-10s %s\n", backends[i]->name, backends[i]->desc);
+    printf("\nSocket profiles:\n");
+    for(int i = 0; profile_at(i) != NULL; i++)
+        printf("  %-10s %s\n", profile_at(i)->name, profile_at(i)->desc);
+    printf("\n");
+}
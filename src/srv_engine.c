@@ -0,0 +1,995 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     srv_engine.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that holds the server logic shared by every backend
+|               (thread, pool, poll, epoll). It sets up the listening socket,
+|               installs the SIGINT handler and provides the connection core:
+|               accepting a client, assembling PKTSIZE requests, echoing them
+|               back and logging the connection's statistics once it closes.
+|               Sampled requests are timed stage by stage (see srv_timing.c).
+|               Backends only decide *when* a connection gets serviced, so
+|               measured differences come from the I/O model alone.
+------------------------------------------------------------------------------*/
+#define _GNU_SOURCE                 // accept4
+#include "../include/srv_engine.h"
+#include "../include/socket.h"
+#include "../include/log.h"
+#include "../include/work.h"
+#include "../include/kv.h"
+#include "../include/srv_timing.h"
+#include "../include/trace.h"
+#include "../include/hist.h"
+#include "../include/memstat.h"
+#include "../include/admit.h"
+#include "../include/ratelimit.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+
+/* --- Global ---- */
+volatile sig_atomic_t srv_stop = 0;
+int total_clts = 0;
+int live_clts = 0;                          // connections open right now
+static struct srv_nw_var *srv_nw;
+static struct srv_config *srv_cfg;
+static struct kv_store srv_kv;
+static struct mem_sample mem_base;          // memory before any connection (scale mode)
+static long scale_next = 0;                 // live connections of next memory report
+static long scale_peak = 0;                 // most connections open at once
+static __thread char conn_scratch[PKTSIZE]; // per-thread receive buffer
+static __thread int (*io_wait)(int, short) = NULL;  // yields instead of poll (fibers)
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int run_srv(struct srv_nw_var *nw, struct srv_config *cfg)
+|                   *nw  : pointer to servers network variables
+|                   *cfg : runtime options (selected backend etc.)
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       High level function to run the server. Sets up the server and
+|               the SIGINT interupt handler and then hands the listening socket
+|               to the selected backend. Once the backend returns the total
+|               number of clients is appended to the log file. The key-value
+|               store is only allocated when the kv handler is selected.
+------------------------------------------------------------------------------*/
+int run_srv(struct srv_nw_var *nw, struct srv_config *cfg)
+{
+    int _ret;
+
+    srv_nw = nw;
+    srv_cfg = cfg;
+
+    if(cfg->scale)
+    {
+        printf("- Scale mode: open file limit %ld\n", raise_fd_limit());
+        mem_sample(&mem_base);
+        scale_next = next_scale_step(0);
+    }
+
+    if(setup_srv(nw, cfg->backend->listen_nonblocking) == -1)
+        return -1;
+
+    if(set_SIGINT() == -1)
+        return -1;
+
+    if(cfg->handler == HANDLER_KV)
+    {
+        if(kv_init(&srv_kv, cfg->kv_shards) == -1)
+            return -1;
+        printf("- Key-value store: %d shards\n", cfg->kv_shards);
+    }
+
+    if(timing_init(cfg->sample) == -1)
+        return -1;
+
+    admit_init(cfg->max_conns, cfg->max_lag_us, cfg->reject);
+
+    if(cfg->rate > 0)
+    {
+        if(rl_init(cfg->rate, cfg->burst) == -1)
+            return -1;
+        printf("- Rate limit: %d req/s per client address, burst %d\n", cfg->rate, cfg->burst);
+    }
+
+    if(cfg->trace && trace_init(cfg->tracefile) == -1)
+        return -1;
+
+    if(cfg->aggregate >= 0 && ipstats_init(cfg->logfile, cfg->aggregate) == -1)
+        return -1;
+
+    if(cfg->series != NULL && series_init(cfg->series, cfg->interval_ms, &live_clts) == -1)
+        return -1;
+
+    shmstat_init(cfg->backend->name, &live_clts, &total_clts);  // optional, runs without it
+
+    printf("- Socket profile: %s\n", cfg->profile->name);
+    printf("- Backend: %s\n\n", cfg->backend->name);
+    _ret = cfg->backend->run(nw, cfg);
+
+    series_stop();
+    shmstat_stop();
+    ipstats_write(1);
+    append_total_clients(cfg->logfile, total_clts);
+    if(cfg->scale)
+        printf("- Peak open connections: %ld\n", scale_peak);
+    report_both(cfg->logfile, admit_report);
+    report_both(cfg->logfile, rl_report);
+    report_both(cfg->logfile, timing_report);
+    trace_dump(cfg->tracefile);
+
+    for(int i = 0; i < nw->nlisten; i++)
+        if(nw->listen[i].path != NULL)
+            unlink(nw->listen[i].path);
+
+    return _ret;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int setup_srv(struct srv_nw_var *nw, int nonblocking)
+|                   *nw : pointer to servers network variables
+|                   nonblocking : 1 to make the listening socket non-blocking
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Feb 22, 2018
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       High level function to setup the server. Uses the networking
+|               related variables held in '*nw' to:
+|                   - create a socket
+|                   - set socket option to reuse address
+|                   - set socket to non-blocking (if requested)
+|                   - bind socket
+|                   - set socket to listen
+|               then adds the unix stream / seqpacket listeners, if any.
+------------------------------------------------------------------------------*/
+int setup_srv(struct srv_nw_var *nw, int nonblocking)
+{
+    struct srv_listener *_tcp = &nw->listen[0];
+    int _optval = 1;
+
+    nw->nlisten = 1;
+    _tcp->kind = LISTEN_TCP;
+    _tcp->path = NULL;
+    if(create_socket(&(_tcp->sd), AF_INET, SOCK_STREAM, 0) == -1)
+        return -1;
+
+    bzero((char *)&(nw->srv_addr), sizeof(struct sockaddr_in));
+    fill_addr(&(nw->srv_addr), AF_INET, htons(nw->port), htonl(INADDR_ANY));
+
+    setsockopt(_tcp->sd, SOL_SOCKET, SO_REUSEADDR, &_optval, sizeof(_optval));
+    apply_listen_profile(_tcp->sd, srv_cfg->profile);
+
+    if(nonblocking && set_nonblocking(&(_tcp->sd)) == -1)
+        return -1;
+
+    if(bind_socket(_tcp->sd, (struct sockaddr *)&(nw->srv_addr), sizeof(nw->srv_addr)) == -1)
+        return -1;
+
+    if(listen_socket(_tcp->sd, srv_cfg->scale ? SCALEBACKLOG : BACKLOG) == -1)
+        return -1;
+
+    printf("- Listening on tcp port %d\n", nw->port);
+
+    if(nw->unix_path != NULL && setup_unix(nw, nw->unix_path, LISTEN_UNIX, nonblocking) == -1)
+        return -1;
+
+    if(nw->seq_path != NULL && setup_unix(nw, nw->seq_path, LISTEN_SEQPACKET, nonblocking) == -1)
+        return -1;
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int setup_unix(struct srv_nw_var *nw, const char *path, int kind,
+|                              int nonblocking)
+|                   *nw         : server network variables
+|                   *path       : socket file to bind
+|                   kind        : LISTEN_UNIX or LISTEN_SEQPACKET
+|                   nonblocking : 1 to make the listener non-blocking
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Adds a unix domain listener next to the tcp one. A stale socket
+|               file left by an earlier run is removed first.
+------------------------------------------------------------------------------*/
+int setup_unix(struct srv_nw_var *nw, const char *path, int kind, int nonblocking)
+{
+    struct srv_listener *_l = &nw->listen[nw->nlisten];
+    struct sockaddr_un _addr;
+
+    if(fill_unix_addr(&_addr, path) == -1)
+        return -1;
+
+    if(create_socket(&(_l->sd), AF_UNIX, kind == LISTEN_SEQPACKET ? SOCK_SEQPACKET : SOCK_STREAM, 0) == -1)
+        return -1;
+
+    unlink(path);
+    if(nonblocking && set_nonblocking(&(_l->sd)) == -1)
+        return -1;
+
+    if(bind_socket(_l->sd, (struct sockaddr *)&_addr, sizeof(_addr)) == -1)
+        return -1;
+
+    if(listen_socket(_l->sd, srv_cfg->scale ? SCALEBACKLOG : BACKLOG) == -1)
+        return -1;
+
+    _l->kind = kind;
+    _l->path = path;
+    nw->nlisten++;
+    printf("- Listening on unix %s %s\n", kind == LISTEN_SEQPACKET ? "seqpacket" : "stream", path);
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int set_SIGINT()
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Feb 20, 2018
+|
+|   AUTHOR:     Aman Abulla
+|
+|   DESC:       Function to set up SIGINT interupt handler. SA_RESTART is left
+|               off on purpose so blocking accept/poll/epoll_wait calls return
+|               EINTR and the backends can notice 'srv_stop'.
+------------------------------------------------------------------------------*/
+int set_SIGINT()
+{
+    struct sigaction act;
+    act.sa_handler = close_fd;
+    act.sa_flags = 0;
+
+    if ((sigemptyset (&act.sa_mask) == -1 || sigaction (SIGINT, &act, NULL) == -1))
+    {
+            printf("\n\tFailed to set SIGINT handler\n");
+            return -1;
+    }
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void block_SIGINT()
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Blocks SIGINT in the calling thread. Worker threads call this
+|               so the signal is always delivered to the thread sitting in
+|               accept/poll/epoll_wait, which then sees EINTR.
+------------------------------------------------------------------------------*/
+void block_SIGINT()
+{
+    sigset_t _set;
+
+    sigemptyset(&_set);
+    sigaddset(&_set, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &_set, NULL);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void set_io_wait(int (*wait)(int sd, short events))
+|                   *wait : called instead of poll() when a socket would block
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Installs the calling thread's I/O wait. Backends that run
+|               several connections per thread without an event loop in the
+|               way (fibers) use it so a full send buffer parks only the
+|               connection instead of the thread.
+------------------------------------------------------------------------------*/
+void set_io_wait(int (*wait)(int sd, short events))
+{
+    io_wait = wait;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int srv_accept(int sd_listen, int nonblocking, struct srv_conn **conn)
+|                   sd_listen   : listening socket to accept on
+|                   nonblocking : 1 to make the new client socket non-blocking
+|                   **conn      : set to the new connection on success
+|
+|   RETURN:     0 on success, 1 if no connection is pending (non-blocking
+|               listener) or the listeners were just paused, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Accepts a client connection and allocates the connection state
+|               shared by every backend (socket, request buffer and stats).
+|               Unix domain clients are logged as "unix" and get no tcp
+|               socket options. In scale mode nothing is printed per
+|               connection and memory per connection is reported every time
+|               the number of open connections reaches the next step. Backends
+|               accept on several threads at once, so the acceptor that moves
+|               the step on (compare and swap) is the only one to report it,
+|               and the peak is raised the same way.
+|               Connections over the admission limits (admit.c) are reset
+|               and counted, or left in the backlog when the backend pauses
+|               its listeners instead.
+------------------------------------------------------------------------------*/
+int srv_accept(int sd_listen, int nonblocking, struct srv_conn **conn)
+{
+    struct sockaddr_storage _clt_addr;
+    socklen_t _clt_addr_len = sizeof(_clt_addr);
+    struct srv_conn *_conn;
+    time_t _t;
+    long _step, _peak;
+    int _sd, _live, _flags, _why;
+
+    // scale mode takes the socket non-blocking straight from accept4, saving
+    // two fcntl calls (and a line of output) per connection
+    _flags = nonblocking && srv_cfg->scale ? SOCK_NONBLOCK : 0;
+    while(1)
+    {
+        // pause policy: leave connections in the backlog, the loop stops
+        // watching its listeners
+        if(admit.pausable && (_why = admit_check(live_clts)) != ADMIT_OK)
+        {
+            admit_pause(_why);
+            return 1;
+        }
+
+        _clt_addr_len = sizeof(_clt_addr);
+        if((_sd = accept4(sd_listen, (struct sockaddr *)&_clt_addr, &_clt_addr_len, _flags)) == -1)
+        {
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+                return 1;
+
+            if(!srv_stop)
+            {
+                printf("\tError accepting connection\n");
+                printf("\tError code: %s\n\n", strerror(errno));
+            }
+            return -1;
+        }
+
+        if((_why = admit_check(live_clts)) == ADMIT_OK)
+            break;
+
+        // close policy: reset it right away, the client fails fast
+        admit_reject(_why);
+        set_linger(_sd, 0);
+        close(_sd);
+    }
+
+    if(nonblocking && !_flags && set_nonblocking(&_sd) == -1)
+    {
+        close(_sd);
+        return -1;
+    }
+
+    if(_clt_addr.ss_family == AF_INET)
+        apply_conn_profile(_sd, srv_cfg->profile, 0);
+
+    if((_conn = malloc(sizeof *_conn)) == NULL)
+    {
+        printf("\tError allocating connection\n");
+        close(_sd);
+        return -1;
+    }
+
+    // setup stats struct
+    _conn->sd = _sd;
+    _conn->rlen = 0;
+    _conn->t_ready = 0;
+    _conn->next = NULL;
+    _conn->prev = NULL;
+    _conn->owner = NULL;
+    _conn->buff = NULL;
+    _conn->defer_ms = 0;
+    _conn->out = NULL;
+    _conn->olen = 0;
+    _conn->wait_out = 0;
+    _conn->peer = 0;
+    if(_clt_addr.ss_family == AF_INET)
+        _conn->peer = ((struct sockaddr_in *)&_clt_addr)->sin_addr.s_addr;
+    _conn->t_accept = now_ns();
+    _conn->rl = NULL;
+    if(_conn->peer != 0 && (!nonblocking || rl.deferrable))
+        _conn->rl = rl_lookup(_conn->peer);
+    _conn->stats.sd = _sd;
+    _conn->stats.requests = 0;
+    _t = time(NULL);
+    _conn->stats.tm = *localtime(&_t);     // time of new connection
+    if(_clt_addr.ss_family == AF_INET)
+        strcpy(_conn->stats.clt_ip, inet_ntoa(((struct sockaddr_in *)&_clt_addr)->sin_addr));
+    else
+        strcpy(_conn->stats.clt_ip, "unix");
+    init_bytes_struct(&(_conn->stats.bytes));
+
+    TRACE(TR_ACCEPT, _sd);
+    __sync_fetch_and_add(&total_clts, 1);
+    _live = __sync_add_and_fetch(&live_clts, 1);
+    if(!srv_cfg->scale)
+    {
+        if(srv_cfg->aggregate < 0)  // aggregation only drops the per-connection line
+            printf("- Client connected: %s\n", _conn->stats.clt_ip);
+    }
+    else if(_live >= (_step = __atomic_load_n(&scale_next, __ATOMIC_RELAXED))
+            && __atomic_compare_exchange_n(&scale_next, &_step, next_scale_step(_live), 0,
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        mem_report(stdout, _live, &mem_base);  // this thread claimed the step
+
+    _peak = __atomic_load_n(&scale_peak, __ATOMIC_RELAXED);
+    while(_live > _peak && !__atomic_compare_exchange_n(&scale_peak, &_peak, _live, 1,
+                                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;   // _peak reloaded, retry while still below
+
+    *conn = _conn;
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int srv_accept_any(struct srv_nw_var *nw, int nonblocking,
+|                                  struct srv_conn **conn)
+|                   *nw         : server network variables
+|                   nonblocking : 1 to make the new client socket non-blocking
+|                   **conn      : set to the new connection on success
+|
+|   RETURN:     0 on success, -1 on failure (or once the server is stopping)
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Blocking accept over every listener, for the backends with a
+|               dedicated accept loop. With more than one listener it polls
+|               them and accepts from a ready one, starting after the listener
+|               served last so no endpoint starves the others.
+------------------------------------------------------------------------------*/
+int srv_accept_any(struct srv_nw_var *nw, int nonblocking, struct srv_conn **conn)
+{
+    static int _last = 0;
+    struct pollfd _pfd[MAXLISTEN];
+    int _i;
+
+    if(nw->nlisten == 1)
+        return srv_accept(nw->listen[0].sd, nonblocking, conn);
+
+    for(_i = 0; _i < nw->nlisten; _i++)
+    {
+        _pfd[_i].fd = nw->listen[_i].sd;
+        _pfd[_i].events = POLLIN;
+    }
+
+    while(!srv_stop)
+    {
+        if(poll(_pfd, nw->nlisten, -1) == -1)
+        {
+            if(errno == EINTR)
+                continue;
+
+            printf("\tError polling listeners\n");
+            printf("\tError code: %s\n\n", strerror(errno));
+            return -1;
+        }
+
+        for(int n = 1; n <= nw->nlisten; n++)
+        {
+            _i = (_last + n) % nw->nlisten;
+            if(_pfd[_i].revents & POLLIN)
+            {
+                _last = _i;
+                return srv_accept(nw->listen[_i].sd, nonblocking, conn);
+            }
+        }
+    }
+
+    return -1;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   struct srv_listener *find_listener(struct srv_nw_var *nw, void *ptr)
+|                   *nw  : server network variables
+|                   *ptr : event tag (listener or connection)
+|
+|   RETURN:     the listener 'ptr' points at, NULL for connections
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Lets event loops that tag registrations with pointers tell the
+|               listeners apart from connections.
+------------------------------------------------------------------------------*/
+struct srv_listener *find_listener(struct srv_nw_var *nw, void *ptr)
+{
+    for(int i = 0; i < nw->nlisten; i++)
+        if(ptr == &nw->listen[i])
+            return &nw->listen[i];
+
+    return NULL;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void close_listeners(struct srv_nw_var *nw)
+|                   *nw : server network variables
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Closes every listening socket.
+------------------------------------------------------------------------------*/
+void close_listeners(struct srv_nw_var *nw)
+{
+    for(int i = 0; i < nw->nlisten; i++)
+        close(nw->listen[i].sd);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int conn_service(struct srv_conn *conn)
+|                   *conn : connection to service
+|
+|   RETURN:     CONN_AGAIN when the socket has been drained (non-blocking),
+|               CONN_CLOSED when the client disconnected, CONN_ERROR on error,
+|               CONN_DEFER when the client is over its rate limit
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Reads from the client until the socket would block, echoing
+|               every complete PKTSIZE request. Requests are received into a
+|               per-thread buffer; only a request still partial when the socket
+|               runs dry is parked in a buffer of its own until the rest
+|               arrives, so idle connections carry no buffer. On a blocking
+|               socket this only returns once the client is gone, which makes
+|               it the whole echo loop of the thread based backends.
+|
+|               A sampled request starts when the backend hands the connection
+|               over (non-blocking) or when its first bytes arrive (blocking,
+|               where time spent in recv() is client think time). A sample
+|               that finds the socket empty is restamped on the next call.
+|
+|               A complete request of a rate limited client (ratelimit.c)
+|               with no token left is held: blocking backends sleep until the
+|               bucket refills, event loops get CONN_DEFER with the wait in
+|               conn->defer_ms and call again once it has passed, which
+|               picks the held request back up without reading. defer_ms
+|               stays set until the request gets its token, so a held request
+|               is counted as throttled once however often it is retried.
+|
+|               A response that does not fit in a non-blocking socket's send
+|               buffer is kept on the connection and CONN_WRITE is returned;
+|               the event loop waits for the socket to become writable and
+|               calls again, which sends the rest before reading any further.
+|               A client that sends without reading its echoes thus stalls
+|               only itself.
+------------------------------------------------------------------------------*/
+int conn_service(struct srv_conn *conn)
+{
+    int _nonblocking = srv_cfg->backend->nonblocking;
+    struct timespec _ts;
+    int _bytes_recv, _wait, _flushed;
+    char *_buff;
+
+    while(1)
+    {
+        if(conn->olen > 0 && (_flushed = conn_flush(conn)) != 0)
+            return _flushed == -1 ? CONN_ERROR : CONN_WRITE;
+
+        _buff = conn->buff != NULL ? conn->buff : conn_scratch;
+
+        if(conn->rlen < PKTSIZE)   // else a request held back by the rate limit
+        {
+            if(conn->rlen == 0 && _nonblocking && (conn->t_ready != 0 || timing_sample()))
+                conn->t_ready = now_ns();
+
+            // read socket
+            _bytes_recv = recv(conn->sd, _buff + conn->rlen, PKTSIZE - conn->rlen, 0);
+            if(_bytes_recv == -1)
+            {
+                if(errno == EAGAIN || errno == EWOULDBLOCK)
+                    return conn_park(conn) == -1 ? CONN_ERROR : CONN_AGAIN;
+                if(errno == EINTR)
+                    continue;
+
+                printf("\tError reading\n");
+                printf("\tError code: %s\n\n", strerror(errno));
+                return CONN_ERROR;
+            }
+            if(_bytes_recv == 0) // client disconnected
+                return CONN_CLOSED;
+
+            TRACE(TR_RECV, _bytes_recv);
+            rearm_quickack(conn->sd, srv_cfg->profile);
+
+            if(conn->rlen == 0 && !_nonblocking && timing_sample())
+                conn->t_ready = now_ns();
+
+            conn->rlen += _bytes_recv;
+            if(conn->rlen < PKTSIZE)   // wait for rest of request
+                continue;
+        }
+
+        // over the rate limit, hold the request until the bucket has a token
+        while(conn->rl != NULL && (_wait = rl_wait(conn->rl, conn->defer_ms != 0)) > 0)
+        {
+            conn->defer_ms = _wait;
+            if(_nonblocking)
+                return conn_park(conn) == -1 ? CONN_ERROR : CONN_DEFER;
+            _ts.tv_sec = _wait / 1000;
+            _ts.tv_nsec = (_wait % 1000) * 1000000L;
+            nanosleep(&_ts, NULL);
+        }
+        conn->defer_ms = 0;
+
+        if(conn_request(conn, _buff) == -1)
+            return CONN_ERROR;
+
+        if(conn->buff != NULL)
+        {
+            free(conn->buff);
+            conn->buff = NULL;
+        }
+    }
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int conn_park(struct srv_conn *conn)
+|                   *conn : connection leaving conn_service with a request
+|                           (partial or held back) in the scratch buffer
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Moves the received bytes to a buffer of the connection's own,
+|               the scratch buffer is reused by other connections.
+------------------------------------------------------------------------------*/
+int conn_park(struct srv_conn *conn)
+{
+    if(conn->rlen > 0 && conn->buff == NULL)
+    {
+        if((conn->buff = malloc(PKTSIZE)) == NULL)
+            return -1;
+        memcpy(conn->buff, conn_scratch, conn->rlen);
+    }
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int conn_request(struct srv_conn *conn, char *buff)
+|                   *conn : connection the request arrived on
+|                   *buff : complete PKTSIZE request
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Handles one complete request sitting in 'buff':
+|               updates the stats, runs the configured synthetic work and the
+|               request handler, then sends the frame back to the client. The
+|               echo handler leaves the frame as is, the kv handler replaces it
+|               with the store's response. Sampled requests are stamped after
+|               each stage and recorded once the response is sent. Every
+|               request is counted in the time series, with its latency when
+|               it was sampled.
+------------------------------------------------------------------------------*/
+int conn_request(struct srv_conn *conn, char *buff)
+{
+    uint64_t _t_recv = 0, _t_handler = 0, _t_send = 0;
+    int _left;
+
+    if(conn->t_ready != 0)
+        _t_recv = now_ns();
+
+    conn->stats.requests++;   // update client requests
+    conn->rlen = 0;
+
+    do_work(&srv_cfg->work, buff, PKTSIZE);
+
+    if(srv_cfg->handler == HANDLER_KV)
+        kv_handle(&srv_kv, buff, PKTSIZE);
+
+    if(conn->t_ready != 0)
+        _t_handler = now_ns();
+
+    // write to socket (echo / response), keeping what did not fit
+    if((_left = send_all(conn->sd, buff, PKTSIZE)) == -1)
+        return -1;
+    if(_left > 0)
+    {
+        if((conn->out = malloc(_left)) == NULL)
+            return -1;
+        memcpy(conn->out, buff + PKTSIZE - _left, _left);
+        conn->olen = _left;
+    }
+
+    TRACE(TR_SEND, PKTSIZE);
+
+    if(conn->t_ready != 0)
+    {
+        _t_send = now_ns();
+        timing_record(conn->t_ready, _t_recv, _t_handler, _t_send);
+        _t_send -= conn->t_ready;
+        conn->t_ready = 0;
+    }
+    series_add(PKTSIZE, _t_send);
+
+    update_bytes_struct(&(conn->stats.bytes), PKTSIZE);
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int send_all(int sd, const char *buff, int len)
+|                   sd    : socket to write to
+|                   *buff : data to send
+|                   len   : number of bytes to send
+|
+|   RETURN:     bytes left unsent (0 once all were sent), -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Sends as much of '*buff' as the socket takes. Blocking sockets
+|               take it all. When a non-blocking socket fills up, the
+|               thread's I/O wait, if installed (fibers), waits for it to
+|               drain; since other connections then run on this thread, the
+|               rest is first copied off the shared scratch buffer. Without
+|               one the function returns what is left and the caller keeps
+|               it, so an event loop never blocks on one slow reader.
+------------------------------------------------------------------------------*/
+int send_all(int sd, const char *buff, int len)
+{
+    char _copy[PKTSIZE];
+    int _bytes_sent;
+
+    while(len > 0)
+    {
+        if((_bytes_sent = send(sd, buff, len, MSG_NOSIGNAL)) == -1)
+        {
+            if(errno == EINTR)
+                continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                if(io_wait != NULL && len <= PKTSIZE)
+                {
+                    if(buff != _copy)
+                    {
+                        memcpy(_copy, buff, len);
+                        buff = _copy;
+                    }
+                    io_wait(sd, POLLOUT);
+                    continue;
+                }
+                return len;
+            }
+
+            printf("\tError sending\n");
+            printf("\tError code: %s\n\n", strerror(errno));
+            return -1;
+        }
+
+        buff += _bytes_sent;
+        len -= _bytes_sent;
+    }
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int conn_flush(struct srv_conn *conn)
+|                   *conn : connection with a response tail pending
+|
+|   RETURN:     0 once the tail is sent, 1 if some is still pending, -1 on
+|               failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Sends what is left of the last response (see conn_request).
+------------------------------------------------------------------------------*/
+int conn_flush(struct srv_conn *conn)
+{
+    int _left;
+
+    if((_left = send_all(conn->sd, conn->out, conn->olen)) == -1)
+        return -1;
+
+    if(_left > 0)
+    {
+        memmove(conn->out, conn->out + conn->olen - _left, _left);
+        conn->olen = _left;
+        return 1;
+    }
+
+    free(conn->out);
+    conn->out = NULL;
+    conn->olen = 0;
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void conn_close(struct srv_conn *conn)
+|                   *conn : connection to close
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Closes the client socket, writes the connection's statistics to
+|               the server log file and frees the connection state. In scale
+|               mode connections are only counted, not printed or logged one
+|               by one. When aggregating (-a) they are added to the totals of
+|               their client address instead (ipstats.c).
+------------------------------------------------------------------------------*/
+void conn_close(struct srv_conn *conn)
+{
+    TRACE(TR_CLOSE, conn->sd);
+    close(conn->sd);
+    __sync_sub_and_fetch(&live_clts, 1);
+
+    if(srv_cfg->aggregate >= 0)
+        ipstats_add(conn->peer, conn->stats.requests, (uint64_t)conn->stats.requests * PKTSIZE,
+                    now_ns() - conn->t_accept);
+    else if(!srv_cfg->scale)
+    {
+        printf("- Client disconnected: %s\n", conn->stats.clt_ip);
+        TRACE(TR_LOG_BEGIN, 0);
+        append_srv_data(srv_cfg->logfile, conn->stats);    // write to log file
+        TRACE(TR_LOG_END, 0);
+    }
+
+    free(conn->buff);
+    free(conn->out);
+    free(conn);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void conn_link(struct srv_conn **head, struct srv_conn *conn)
+|                   **head : list of open connections
+|                   *conn  : connection to add
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Adds a connection to a backend's list of the connections it
+|               holds, so they can be closed when the server stops. The
+|               caller provides any locking.
+------------------------------------------------------------------------------*/
+void conn_link(struct srv_conn **head, struct srv_conn *conn)
+{
+    conn->prev = NULL;
+    conn->next = *head;
+    if(*head != NULL)
+        (*head)->prev = conn;
+    *head = conn;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void conn_unlink(struct srv_conn **head, struct srv_conn *conn)
+|                   **head : list of open connections
+|                   *conn  : connection to remove
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Removes a connection from the list conn_link() put it on.
+------------------------------------------------------------------------------*/
+void conn_unlink(struct srv_conn **head, struct srv_conn *conn)
+{
+    if(conn->prev != NULL)
+        conn->prev->next = conn->next;
+    else
+        *head = conn->next;
+    if(conn->next != NULL)
+        conn->next->prev = conn->prev;
+    conn->next = conn->prev = NULL;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void report_both(const char *logfile, void (*report)(FILE *out))
+|                   *logfile : server log file
+|                   *report  : prints a report to a stream
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Prints an end of run report (sampled request timing,
+|               admission control) to stdout and appends it to the server log
+|               file.
+------------------------------------------------------------------------------*/
+void report_both(const char *logfile, void (*report)(FILE *out))
+{
+    FILE *_log;
+
+    report(stdout);
+
+    pthread_mutex_lock(&lock);
+    if((_log = fopen(logfile, "a")) != NULL)
+    {
+        report(_log);
+        fclose(_log);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void close_fd()
+|
+|   RETURN:     void
+|
+|   DATE:       Feb 20, 2018
+|
+|   AUTHOR:     Aman Abdulla, Alex Zielinski
+|
+|   DESC:       Function to execute when SIGINT signal is encountered.
+|               Terminates server's listening sockets and flags the backend
+|               to stop.
+------------------------------------------------------------------------------*/
+void close_fd()
+{
+    printf("\n\n- Terminating\n");
+    srv_stop = 1;
+    if(srv_nw != NULL)
+        close_listeners(srv_nw);
+}
@@ -3,175 +3,35 @@
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Module that represents an asynchronous edge triggered server
-|               program. The program takes in 1 additional cmd argument:
-|                   - host port
+|   DESC:       Backend that represents an asynchronous edge triggered server.
+|               The server listens for incoming connections. Once a connection
+|               has been accepted it will be added to the epoll event array
+|               where it will be monitored for events.
 |
-|                             Usage: ./clt <PORT>
-|
-|               The program will then listen on PORT for any incoming
-|               connections. Once a connection has been accepted it will be
-|               added to the epoll event array where it will be monitored for
-|               events.
+|                             Usage: ./srv -b epoll <PORT>
 ------------------------------------------------------------------------------*/
 #include "../include/srv_epoll.h"
-#include "../include/socket.h"
-#include "../include/log.h"
+#include "../include/srv_engine.h"
+#include "../include/hist.h"
+#include "../include/timer.h"
 #include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h>
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
-#include <arpa/inet.h>
-#include <signal.h>
-#include <pthread.h>
 #include <sys/epoll.h>
-#include <ctype.h>
 
 /* --- Global ---- */
-struct srv_nw_var nw_var;
-
-/*==============================================================================
-|   FUNCTION:   int main(int argc, char **argv)
-|                   argc   : number of cmd args
-|                   **argv : array of args
-|
-|   RETURN:     0 on success
-|
-|   DATE:       Feb 24, 2018
-|
-|   AUTHOR:     Alex Zielinski
-|
-|   DESC:       Main entry point of the program.
-==============================================================================*/
-int main(int argc, char **argv)
-{
-    if(!valid_args(argc, argv[ARG_PORT]))   // check for valid args
-        exit(1);
-
-    nw_var.port = atoi(argv[ARG_PORT]);     // extract port from cmd arg
-
-    if(app_srv_hdr(SRVLOGFILE) == -1)       // append header to server log file
-        exit(1);
-
-    if(run_srv(&nw_var) == -1)
-        exit(1);
-
-    return 0;
-}
-
-
-/*------------------------------------------------------------------------------
-|   FUNCTION:   int valid_args(int arg, char *port)
-|                   arg   : number of cmd ARGSNUM
-|                   *port : port argument
-|
-|   RETURN:     1 on true, 0 on false
-|
-|   DATE:       Feb 19, 2018
-|
-|   AUTHOR:     Alex Zielinski
-|
-|   DESC:       Checks for valid arguments (valid num of arg and valid port).
-|               Returns true (1) if args are valid, otherwise returns false (0).
-------------------------------------------------------------------------------*/
-int valid_args(int arg, char *port)
-{
-    // check valid number of args (2)
-    if(arg != ARGSNUM)
-    {
-        printf("\nUsage: ./srv_epoll <PORT>\n\n");
-        return 0;
-    }
-
-    // check for valid port
-    for(int i = 0; port[i] != '\0'; i++)
-        if(!isdigit(port[i]))
-        {
-            printf("\nError: Invalid port: %s.\n\n", port);
-            return 0;
-        }
-
-    return 1;
-}
-
-
-/*------------------------------------------------------------------------------
-|   FUNCTION:   int run_srv(struct srv_nw_var *nw)
-|                   *nw : pointer to clients network variables
-|
-|   RETURN:     0 on success, -1 on failure
-|
-|   DATE:       Feb 24, 2018
-|
-|   AUTHOR:     Alex Zielinski
-|
-|   DESC:       High level function to run the server. Sets up the server and
-|               the SIGINT interupt handler and then runs the epoll loop that
-|               listens for incoming connections and monitors socket events.
-------------------------------------------------------------------------------*/
-int run_srv(struct srv_nw_var *nw)
+const struct srv_backend epoll_backend =
 {
-    if(setup_srv(nw) == -1)
-        return -1;
-
-    if(set_SIGINT() == -1)
-        return -1;
-
-    if(run_epoll_loop(*nw) == -1)
-        return -1;
-
-    return 0;
-}
-
-
-/*------------------------------------------------------------------------------
-|   FUNCTION:   int setup_srv(struct srv_nw_var *nw)
-|                   *nw : pointer to clients network variables
-|
-|   RETURN:     0 on success, -1 on failure
-|
-|   DATE:       Feb 22, 2018
-|
-|   AUTHOR:     Alex Zielinski
-|
-|   DESC:       High level function to setup the server. Uses the networking
-|               related variables held in '*nw' to:
-|                   - create a socket
-|                   - set socket option to reuse address
-|                   - set socket to non-blocking
-|                   - bind socket
-|                   - set socket to listen
-------------------------------------------------------------------------------*/
-int setup_srv(struct srv_nw_var *nw)
-{
-    int _optval = 1;
-
-    if(create_socket(&(nw->sd_listen), AF_INET, SOCK_STREAM, 0) == -1)
-        return -1;
-
-    bzero((char *)&(nw->srv_addr), sizeof(struct sockaddr_in));
-    fill_addr(&(nw->srv_addr), AF_INET, htons(nw->port), htonl(INADDR_ANY));
-
-    setsockopt(nw->sd_listen, SOL_SOCKET, SO_REUSEADDR, &_optval, sizeof(_optval));
-
-    if(set_nonblocking(&(nw->sd_listen)) == -1)
-        return -1;
-
-    if(bind_socket(nw->sd_listen, (struct sockaddr *)&(nw->srv_addr), sizeof(nw->srv_addr)) == -1)
-        return -1;
-
-    if(listen_socket(nw->sd_listen, BACKLOG) == -1)
-        return -1;
-
-    return 0;
-}
+    "epoll", "single threaded edge triggered epoll loop", 1, 1, run_epoll_loop
+};
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   int run_epoll_loop(struct srv_nw_var nw)
-|                   nw : clients network variables
+|   FUNCTION:   int run_epoll_loop(struct srv_nw_var *nw, struct srv_config *cfg)
+|                   *nw  : pointer to servers network variables
+|                   *cfg : runtime options
 |
 |   RETURN:     0 on success, -1 on failure
 |
@@ -182,203 +42,247 @@ int setup_srv(struct srv_nw_var *nw)
 |   DESC:       Function that runs the epoll loop. Incoming connections are
 |               accepted and the new socket is added to the epoll event array.
 |               epoll then monitors the array for any socket events and
-|               accomodates those events accordingly (echos back data);
+|               accomodates those events accordingly (echos back data). Each
+|               event carries a pointer to its connection so no lookup is
+|               needed to find a client's state. The event batch starts small
+|               and doubles every time epoll_wait fills it, so a loop with a
+|               million mostly idle sockets only pays for the events that are
+|               actually ready at once. Each pass is timed for the admission
+|               controller's loop lag; under the pause policy the listeners
+|               are taken out of the interest set while over the limits.
+|               Requests of rate limited clients are held: the connection
+|               leaves the interest set and a timer brings it back once its
+|               bucket has refilled, so the loop never sleeps for one client.
+|               Due timers run after the event batch, so no event still to
+|               be handled can point to a connection they closed.
 ------------------------------------------------------------------------------*/
-int run_epoll_loop(struct srv_nw_var nw)
+int run_epoll_loop(struct srv_nw_var *nw, struct srv_config *cfg)
 {
+    struct epoll_event *_events, *_grown;
     struct epoll_event _event;
-    struct epoll_event _events[MAXEVENTS];
-    struct srv_log_stats _stats[MAXEVENTS];
-    char _recv_buff[PKTSIZE];
-    int _esd, _ready, _bytes_recv, _bytes_sent, _total_clts = 0;
-    int _timeout = (0.1 * 60 * 1000); // set timeout to 15 sec
+    int _batch = EVENTBATCH;
+    struct srv_listener *_l;
+    struct srv_conn *_conn;
+    struct timer_heap _timers;
+    uint64_t _t;
+    int _esd, _ready, _fired;
+
+    if((_events = malloc(_batch * sizeof *_events)) == NULL)
+        return -1;
 
-    for(int i = 0; i < MAXEVENTS; i++) // init stats array
-        _stats[i].sd = -1;
+    if(timer_init(&_timers) == -1)
+    {
+        free(_events);
+        return -1;
+    }
 
     // create epoll socket descriptor
-    if((_esd = epoll_create(MAXEVENTS)) == -1)
+    if((_esd = epoll_create1(0)) == -1)
     {
         printf("\tError creating epoll file descriptor\n");
         printf("\tError code: %s\n\n", strerror(errno));
+        free(_events);
         return -1;
     }
 
     // set event of interest and edge trigger on epoll instance _esd
-    _event.data.fd = nw.sd_listen;
-    _event.events = EPOLLIN | EPOLLET | EPOLLHUP | EPOLLERR;
-    if((epoll_ctl(_esd, EPOLL_CTL_ADD, nw.sd_listen, &_event)) == -1)
+    for(int i = 0; i < nw->nlisten; i++)
     {
-        printf("\tError adding server sock to epoll event loop\n");
-        printf("\tError code: %s\n\n", strerror(errno));
-        close(_esd);
-        return -1;
+        _event.data.ptr = &nw->listen[i];   // listener entries mark listening sockets
+        _event.events = EPOLLIN | EPOLLET;
+        if((epoll_ctl(_esd, EPOLL_CTL_ADD, nw->listen[i].sd, &_event)) == -1)
+        {
+            printf("\tError adding server sock to epoll event loop\n");
+            printf("\tError code: %s\n\n", strerror(errno));
+            close(_esd);
+            free(_events);
+            timer_free(&_timers);
+            return -1;
+        }
     }
 
+    admit_set_pausable();
+    rl_set_deferrable();
+
     // epoll loop
-    while(1)
+    while(!srv_stop)
     {
         // wait for event
-        _ready = epoll_wait(_esd, _events, MAXEVENTS, _timeout);
+        TRACE(TR_WAIT, 0);
+        _ready = epoll_wait(_esd, _events, _batch,
+                            timer_timeout(&_timers, now_ns(), admit_paused() ? ADMIT_RECHECK : cfg->idle_timeout));
+        TRACE(TR_WAKE, _ready > 0 ? _ready : 0);
+        series_loop(_ready > 0 ? _ready : 0);
+        _t = now_ns();
         if(_ready == -1) // error
         {
+            if(errno == EINTR)
+                continue;
+
             printf("\tEPoll Failed\n");
             printf("\tError code: %s\n\n", strerror(errno));
-            close(nw.sd_listen);
+            close_listeners(nw);
             close(_esd);
-            return -1;
-        }
-
-        if(_ready == 0)  // timeout
-        {
-            printf("\n- Timeout....Terminating\n");
-            close(nw.sd_listen);
-            close(_esd);
-            append_total_clients(SRVLOGFILE, _total_clts);
+            free(_events);
+            timer_free(&_timers);
             return -1;
         }
 
         // process events
         for(int i = 0; i < _ready; i++)
         {
-            if(_events[i].events & (EPOLLHUP & EPOLLERR)) // error on socket
+            if((_l = find_listener(nw, _events[i].data.ptr)) != NULL) // connection request
             {
-                printf("\tError: epoll EPOLLERR\n");
-                close(_events[i].data.fd);
-            }
-            else if(_events[i].data.fd == nw.sd_listen) // connection request
-            {
-                while(1)
+                while(srv_accept(_l->sd, 1, &_conn) == 0)
                 {
-                    struct sockaddr_in _clt_addr;
-                    socklen_t _clt_addr_len;
-                    int _new_sd;
-
-                    _clt_addr_len = sizeof(_clt_addr);
-
-                    // accept connection
-                    if((_new_sd = accept(nw.sd_listen, (struct sockaddr *)&_clt_addr, &_clt_addr_len)) == -1)
-                    {
-                        if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-                        {
-                            break; // done processing incoming connections
-                        }
-
-                        printf("\tError accepting connection\n");
-                        printf("\tError code: %s\n\n", strerror(errno));
-                        close(nw.sd_listen);
-                        break;
-                    }
-
-                    if(set_nonblocking(&_new_sd) == -1)
-                        return -1;
-
                     // add new socket to epoll loop
-                    _event.data.fd = _new_sd;
+                    _event.data.ptr = _conn;
                     _event.events = EPOLLIN | EPOLLET;
-                    if((epoll_ctl(_esd, EPOLL_CTL_ADD, _new_sd, &_event)) == -1)
+                    if((epoll_ctl(_esd, EPOLL_CTL_ADD, _conn->sd, &_event)) == -1)
                     {
-                        printf("\tError adding server sock to epoll event loop\n");
+                        printf("\tError adding client sock to epoll event loop\n");
                         printf("\tError code: %s\n\n", strerror(errno));
-                        close(_esd);
-                        return -1;
+                        conn_close(_conn);
                     }
-
-                    _total_clts++;
-                    printf("- Client connected: %s\n",  inet_ntoa(_clt_addr.sin_addr));
-
-                    for(int j = 0; j < MAXEVENTS; j++) // save new client to stats array
-                        if(_stats[j].sd == -1)
-                        {
-                            _stats[j].sd = _new_sd;
-                            time_t t = time(NULL);
-                            _stats[j].tm = *localtime(&t); // time of new connection
-                            _stats[j].requests = 0;
-                            strcpy(_stats[j].clt_ip, inet_ntoa(_clt_addr.sin_addr));
-                            break;
-                        }
                 }
+
+                if(admit_paused())  // over the limits, stop watching the listeners
+                    epoll_listen(_esd, nw, 0);
             }
-            else // data ready to be read
+            else // data ready to be read (or hang up / error)
             {
-                // read socket
-                _bytes_recv = recv(_events[i].data.fd, _recv_buff, PKTSIZE, MSG_WAITALL);
-                if(_bytes_recv == 0) // client disconnected
-                {
-                    for(int j = 0; j < MAXEVENTS; j++) // save client stats
-                        if(_stats[j].sd == _events[j].data.fd)
-                        {
-                            _stats[j].sd = -1;
-                            printf("- Client disconnected: %s\n", _stats[i].clt_ip);
-                            break;
-                        }
+                _conn = _events[i].data.ptr;
+                epoll_serviced(_esd, &_timers, _conn, conn_service(_conn), 0);
+            }
+        }
 
-                    close (_events[i].data.fd);
-                    append_srv_data(SRVLOGFILE, _stats[i]); // write to log file
-                }
-                else    // successfully read socket
-                {
-                    int j;
-                    for(j = 0; j < MAXEVENTS; j++) // save new client to stats array
-                        if(_stats[j].sd == _events[i].data.fd)
-                        {
-                            _stats[j].requests++;   // update client requests
-                            break;
-                        }
+        // held back requests whose bucket has refilled, after the batch so
+        // no event of it can refer to a connection closed here
+        for(_fired = 0; (_conn = timer_pop_due(&_timers, now_ns())) != NULL; _fired++)
+        {
+            epoll_serviced(_esd, &_timers, _conn, conn_service(_conn), 1);
+        }
 
-                    // echo data back
-                    _bytes_sent = send(_events[i].data.fd, _recv_buff, PKTSIZE, 0);
-                    update_bytes_struct(&(_stats[j].bytes), _bytes_sent);
-                    bzero(_recv_buff, sizeof(_recv_buff));
-                }
-            }
+        if(_ready == 0 && (admit_paused() || _fired > 0 || _timers.size > 0))  // quiet but not idle, let the lag decay
+        {
+            admit_loop_lag(0);
+            if(admit_resume(live_clts))
+                epoll_listen(_esd, nw, 1);
+            continue;
         }
+
+        if(_ready == 0)  // timeout
+        {
+            printf("\n- Timeout....Terminating\n");
+            close_listeners(nw);
+            close(_esd);
+            free(_events);
+            timer_free(&_timers);
+            return 0;
+        }
+
+        admit_loop_lag(now_ns() - _t);
+        if(admit_resume(live_clts))
+            epoll_listen(_esd, nw, 1);
+
+        // full batch, more events are likely waiting
+        if(_ready == _batch && _batch < MAXEVENTS)
+            if((_grown = realloc(_events, 2 * _batch * sizeof *_events)) != NULL)
+            {
+                _events = _grown;
+                _batch *= 2;
+            }
     }
+
+    close(_esd);
+    free(_events);
+    timer_free(&_timers);
     return 0;
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   int set_SIGINT()
+|   FUNCTION:   void epoll_serviced(int esd, struct timer_heap *timers,
+|                                   struct srv_conn *conn, int status, int held)
+|                   esd     : epoll instance
+|                   *timers : loop's timers
+|                   *conn   : connection just serviced
+|                   status  : what conn_service returned
+|                   held    : 1 if the connection was out of the interest set
 |
-|   RETURN:     0 on success, -1 on failure
+|   RETURN:     void
 |
-|   DATE:       Feb 20, 2018
+|   DATE:       Oct 18, 2026
 |
-|   AUTHOR:     Aman Abulla
+|   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Function to set up SIGINT interupt handler
+|   DESC:       Acts on the result of servicing a connection. A rate limited
+|               connection is removed from the epoll set, so it delivers no
+|               events at all, until its timer fires; one that was held is
+|               added back, edge triggered, which reports anything (data or
+|               a hang up) that arrived meanwhile. A connection with a
+|               response tail pending waits for writability only, and goes
+|               back to waiting for requests once the tail is sent.
 ------------------------------------------------------------------------------*/
-int set_SIGINT()
+void epoll_serviced(int esd, struct timer_heap *timers, struct srv_conn *conn, int status, int held)
 {
-    struct sigaction act;
-    act.sa_handler = close_fd;
-    act.sa_flags = 0;
+    struct epoll_event _event;
 
-    if ((sigemptyset (&act.sa_mask) == -1 || sigaction (SIGINT, &act, NULL) == -1))
+    _event.data.ptr = conn;
+    switch(status)
     {
-            printf("\n\tFailed to set SIGINT handler\n");
-            return -1;
+        case CONN_AGAIN:
+        case CONN_WRITE:
+            if(!held && conn->wait_out == (status == CONN_WRITE))
+                return;     // already armed for it
+            conn->wait_out = status == CONN_WRITE;
+            _event.events = (conn->wait_out ? EPOLLOUT : EPOLLIN) | EPOLLET;
+            if(epoll_ctl(esd, held ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, conn->sd, &_event) == -1)
+            {
+                printf("\tError re-arming client sock in epoll event loop\n");
+                printf("\tError code: %s\n\n", strerror(errno));
+                conn_close(conn);
+            }
+            return;
+        case CONN_DEFER:
+            if(timer_add(timers, now_ns() + conn->defer_ms * 1000000ULL, conn) == -1)
+            {
+                conn_close(conn);
+                return;
+            }
+            if(!held)
+                epoll_ctl(esd, EPOLL_CTL_DEL, conn->sd, NULL);
+            return;
+        default:    // client disconnected
+            conn_close(conn);  // close removes it from the epoll set
+            return;
     }
-
-    return 0;
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   void close_fd()
+|   FUNCTION:   void epoll_listen(int esd, struct srv_nw_var *nw, int on)
+|                   esd : epoll instance
+|                   *nw : servers network variables (listeners)
+|                   on  : 1 to watch the listeners, 0 to pause them
 |
 |   RETURN:     void
 |
-|   DATE:       Feb 20, 2018
+|   DATE:       Oct 18, 2026
 |
-|   AUTHOR:     Aman Abdulla
+|   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Function to execute when SIGINT signal is encountered.
-|               Terminates server's listening socket
+|   DESC:       Pauses or resumes the listeners. Resuming re-arms them edge
+|               triggered, which reports connections that queued up meanwhile.
 ------------------------------------------------------------------------------*/
-void close_fd()
+void epoll_listen(int esd, struct srv_nw_var *nw, int on)
 {
-    printf("\n\n- Terminating\n");
-    close(nw_var.sd_listen);
+    struct epoll_event _event;
+
+    for(int i = 0; i < nw->nlisten; i++)
+    {
+        _event.data.ptr = &nw->listen[i];
+        _event.events = on ? EPOLLIN | EPOLLET : 0;
+        epoll_ctl(esd, EPOLL_CTL_MOD, nw->listen[i].sd, &_event);
+    }
 }
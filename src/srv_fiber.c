@@ -0,0 +1,341 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     srv_fiber.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Backend that runs every connection as a fiber (see fiber.c).
+|               The handler is written like echo_loop() in srv_thread.c: it
+|               services the connection until the client leaves, and whenever
+|               a recv or send would block the fiber parks and its scheduler
+|               runs other connections. Each of the N worker threads owns a
+|               scheduler and an epoll instance; connections are registered
+|               once, edge triggered, and an event only wakes the fiber if it
+|               is parked. Workers accept for themselves from the shared
+|               listeners (EPOLLEXCLUSIVE, so a new connection wakes one).
+|
+|               Fiber stacks are --stack KB with a --guard KB PROT_NONE region
+|               below. Every guarded stack costs two kernel mappings, so past
+|               vm.max_map_count / 2 connections run with --guard 0.
+|
+|               The workers are a worker group (workers.c): worker 0 runs on
+|               the main thread and stops the others when the server stops.
+|               Each worker lists the connections of its fibers; those still
+|               open at the end are closed and the fiber stacks released.
+|
+|                   Usage: ./srv -b fiber [-n THREADS] [--stack KB]
+|                                [--guard KB] <PORT>
+------------------------------------------------------------------------------*/
+#include "../include/srv_fiber.h"
+#include "../include/srv_engine.h"
+#include "../include/fiber.h"
+#include "../include/workers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/epoll.h>
+
+/* --- Global ---- */
+const struct srv_backend fiber_backend =
+{
+    "fiber", "fibers on N epoll schedulers (blocking-style handler)", 1, 1, run_fiber
+};
+static __thread struct fiber_worker *fiber_worker_self = NULL;
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int run_fiber(struct srv_nw_var *nw, struct srv_config *cfg)
+|                   *nw  : pointer to servers network variables
+|                   *cfg : runtime options (worker threads, stack and guard)
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Creates 'cfg->threads' fiber workers, the first of which runs
+|               on the calling thread so it sees SIGINT. Once it stops, the
+|               other workers are stopped and joined, the connections of the
+|               fibers still alive are closed and their stacks released, then
+|               the fiber counters are reported. A worker that failed makes
+|               the run fail.
+------------------------------------------------------------------------------*/
+int run_fiber(struct srv_nw_var *nw, struct srv_config *cfg)
+{
+    struct fiber_worker *_workers;
+    struct srv_workers _group;
+    struct srv_conn *_conn;
+    FILE *_f;
+    long _maps;
+    int _ret = 0;
+
+    if((_workers = calloc(cfg->threads, sizeof *_workers)) == NULL)
+        return -1;
+
+    if(workers_init(&_group, cfg->threads) == -1)
+    {
+        free(_workers);
+        return -1;
+    }
+
+    for(int i = 0; i < cfg->threads; i++)
+    {
+        _workers[i].id = i;
+        _workers[i].group = &_group;
+        _workers[i].nw = nw;
+        _workers[i].cfg = cfg;
+        _workers[i].esd = -1;
+    }
+
+    for(int i = 0; i < cfg->threads && _ret == 0; i++)
+        if((_workers[i].esd = workers_epoll(&_group, nw)) == -1)
+            _ret = -1;
+
+    if(_ret == 0)
+    {
+        printf("- Fiber stacks: %d KB + %d KB guard on %d scheduler threads\n",
+               cfg->stack_kb, cfg->guard_kb, cfg->threads);
+        if(cfg->guard_kb > 0 && (_f = fopen("/proc/sys/vm/max_map_count", "r")) != NULL)
+        {
+            if(fscanf(_f, "%ld", &_maps) == 1)
+                printf("- vm.max_map_count %ld allows ~%ld guarded fibers (--guard 0 beyond)\n",
+                       _maps, _maps / 2);
+            fclose(_f);
+        }
+
+        _ret = workers_start(&_group, fiber_loop, _workers, sizeof *_workers);
+    }
+
+    if(_ret == 0)
+        _ret = fiber_loop(&_workers[0]) == NULL ? 0 : -1;
+
+    if(workers_stop(&_group) == -1)
+        _ret = -1;
+
+    // every worker is gone: close what its fibers held, then drop the fibers
+    for(int i = 0; i < cfg->threads; i++)
+    {
+        while((_conn = _workers[i].conns) != NULL)
+        {
+            conn_unlink(&_workers[i].conns, _conn);
+            conn_close(_conn);
+        }
+        fiber_sched_free(&_workers[i].sched);
+        if(_workers[i].esd != -1)
+            close(_workers[i].esd);
+    }
+
+    report_fibers(_workers, cfg->threads);
+    free(_workers);
+    return _ret;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void *fiber_loop(void *args)
+|                   *args : fiber worker to run
+|
+|   RETURN:     NULL when the server stops or times out, (void *)-1 on error
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Scheduler loop of one worker. Runs the fibers that are ready,
+|               then waits for events: new connections start a fiber, socket
+|               events put parked fibers back on the ready queue. epoll_wait
+|               doesn't sleep while fibers are still ready. Events of a batch
+|               are all handled before any fiber runs, so no event can refer
+|               to a fiber that finished meanwhile. Only worker 0 times out,
+|               and only once no worker has had an event for the idle
+|               timeout; the others run until the group stops.
+------------------------------------------------------------------------------*/
+void *fiber_loop(void *args)
+{
+    struct fiber_worker *_w = (struct fiber_worker *)args;
+    struct epoll_event _events[FIBEREVENTS];
+    struct srv_listener *_l;
+    struct srv_conn *_conn;
+    struct fiber *_f;
+    int _ready;
+
+    if(_w->id != 0)
+        block_SIGINT();
+
+    fiber_worker_self = _w;
+    fiber_sched_init(&_w->sched, (size_t)_w->cfg->stack_kb * 1024, (size_t)_w->cfg->guard_kb * 1024);
+    set_io_wait(fiber_wait);
+
+    while(!workers_stopping(_w->group))
+    {
+        fiber_run_ready(&_w->sched);
+
+        TRACE(TR_WAIT, 0);
+        _ready = epoll_wait(_w->esd, _events, FIBEREVENTS,
+                            _w->sched.ready_head != NULL ? 0 : _w->cfg->idle_timeout);
+        TRACE(TR_WAKE, _ready > 0 ? _ready : 0);
+        series_loop(_ready > 0 ? _ready : 0);
+        if(_ready == -1) // error
+        {
+            if(errno == EINTR)
+                continue;
+
+            printf("\tEPoll Failed\n");
+            printf("\tError code: %s\n\n", strerror(errno));
+            return (void *)-1;
+        }
+
+        if(_ready == 0 && _w->sched.ready_head == NULL)  // timeout
+        {
+            if(_w->id == 0 && _w->cfg->idle_timeout >= 0
+               && workers_idle(_w->group, _w->cfg->idle_timeout))
+            {
+                printf("\n- Timeout....Terminating\n");
+                break;
+            }
+            continue;
+        }
+
+        if(_ready > 0)
+            workers_busy(_w->group, _w->id);
+
+        for(int i = 0; i < _ready; i++)
+        {
+            if(_events[i].data.ptr == NULL)  // stop eventfd, see workers_stop()
+                continue;
+
+            if((_l = find_listener(_w->nw, _events[i].data.ptr)) != NULL) // connection request
+            {
+                while(srv_accept(_l->sd, 1, &_conn) == 0)
+                {
+                    conn_link(&_w->conns, _conn);
+                    if(fiber_create(&_w->sched, fiber_echo_loop, _conn) == NULL)
+                    {
+                        conn_unlink(&_w->conns, _conn);
+                        conn_close(_conn);
+                    }
+                }
+            }
+            else // socket of a fiber became ready
+            {
+                _f = _events[i].data.ptr;
+                if(_f->waiting)
+                {
+                    _f->waiting = 0;
+                    fiber_ready(&_w->sched, _f);
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int fiber_wait(int sd, short events)
+|                   sd     : socket the fiber waits on
+|                   events : POLLIN or POLLOUT
+|
+|   RETURN:     0 once the socket had an event
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Parks the calling fiber until its socket has an event. The
+|               socket is registered for both directions when the fiber
+|               starts, so no epoll_ctl is needed here; the caller retries its
+|               recv/send after waking. Installed as the engine's I/O wait so
+|               send_all() yields instead of blocking the whole thread.
+------------------------------------------------------------------------------*/
+int fiber_wait(int sd, short events)
+{
+    struct fiber *_f = fiber_self();
+
+    (void)sd;
+    (void)events;
+
+    _f->waiting = 1;
+    fiber_worker_self->waits++;
+    fiber_park();
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void fiber_echo_loop(void *args)
+|                   *args : connection to accomodate
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Body of a connection fiber, the fiber counterpart of
+|               echo_loop(): reads and echos requests until the client has
+|               finished sending data and has disconnected. Where a thread
+|               would block, the fiber parks.
+------------------------------------------------------------------------------*/
+void fiber_echo_loop(void *args)
+{
+    struct srv_conn *_conn = (struct srv_conn *)args;
+    struct epoll_event _event;
+
+    _event.data.ptr = fiber_self();
+    _event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    if(epoll_ctl(fiber_worker_self->esd, EPOLL_CTL_ADD, _conn->sd, &_event) == -1)
+    {
+        printf("\tError adding client sock to epoll event loop\n");
+        printf("\tError code: %s\n\n", strerror(errno));
+        conn_unlink(&fiber_worker_self->conns, _conn);
+        conn_close(_conn);
+        return;
+    }
+
+    while(conn_service(_conn) == CONN_AGAIN)
+        fiber_wait(_conn->sd, POLLIN);
+
+    conn_unlink(&fiber_worker_self->conns, _conn);
+    conn_close(_conn);  // close removes it from the epoll set
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void report_fibers(struct fiber_worker *workers, int n)
+|                   *workers : fiber workers
+|                   n        : number of workers
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Prints the fiber counters summed over the workers. Called
+|               once every worker has stopped.
+------------------------------------------------------------------------------*/
+void report_fibers(struct fiber_worker *workers, int n)
+{
+    long _created = 0, _stacks = 0, _peak = 0, _switches = 0, _waits = 0;
+
+    for(int i = 0; i < n; i++)
+    {
+        _created += workers[i].sched.created;
+        _stacks += workers[i].sched.stacks;
+        _peak += workers[i].sched.peak;
+        _switches += workers[i].sched.switches;
+        _waits += workers[i].waits;
+    }
+
+    printf("\nFibers\n");
+    printf("- Started %ld fibers on %ld stacks (%ld reused from the pool)\n",
+           _created, _stacks, _created - _stacks);
+    printf("- Peak fibers %ld (sum of per-worker peaks)\n", _peak);
+    printf("- %ld switches into fibers, %ld parks on EAGAIN\n", _switches, _waits);
+}
@@ -3,340 +3,289 @@
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Module that represents a multiplexed level triggered server
-|               program. The program takes in 1 additional cmd argument:
-|                   - host port
-|
-|                             Usage: ./clt <PORT>
-|
-|               The program will then listen on PORT for any incoming
-|               connections. Once a connection has been accepted it will be
-|               added to the poll array where it will be monitored for events.
+|   DESC:       Backend that represents a multiplexed level triggered server.
+|               The server listens for incoming connections. Once a connection
+|               has been accepted it will be added to the poll array where it
+|               will be monitored for events.
+|
+|               The poll array is kept densely packed: the first entries are the
+|               listening sockets and the rest are live clients, with a parallel
+|               array holding each client's connection state. Closed entries
+|               are swap-removed with the last entry and the arrays double in
+|               size when full, so poll() and the scan after it only ever walk
+|               live connections.
+|
+|                             Usage: ./srv -b poll <PORT>
 ------------------------------------------------------------------------------*/
 #include "../include/srv_poll.h"
-#include "../include/socket.h"
-#include "../include/log.h"
+#include "../include/srv_engine.h"
+#include "../include/hist.h"
 #include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h>
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
-#include <arpa/inet.h>
-#include <signal.h>
-#include <pthread.h>
-#include <sys/poll.h>
-#include <ctype.h>
+#include <poll.h>
 
 /* --- Global ---- */
-struct srv_nw_var nw_var;
+const struct srv_backend poll_backend =
+{
+    "poll", "single threaded level triggered poll loop", 1, 1, run_poll_loop
+};
 
-/*==============================================================================
-|   FUNCTION:   int main(int argc, char **argv)
-|                   argc   : number of cmd args
-|                   **argv : array of args
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int run_poll_loop(struct srv_nw_var *nw, struct srv_config *cfg)
+|                   *nw  : pointer to servers network variables
+|                   *cfg : runtime options
 |
-|   RETURN:     0 on success
+|   RETURN:     0 on success, -1 on failure
 |
 |   DATE:       Feb 22, 2018
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Main entry point of the program.
-==============================================================================*/
-int main(int argc, char **argv)
+|   DESC:       Function that runs the poll loop. Incoming connections are
+|               accepted and the new socket is added to the poll array. poll
+|               then monitors the array for any socket events and accomodates
+|               those events accordingly (echos back data). Each pass is timed
+|               for the admission controller's loop lag; under the pause
+|               policy the listeners stop being polled while over the limits.
+------------------------------------------------------------------------------*/
+int run_poll_loop(struct srv_nw_var *nw, struct srv_config *cfg)
 {
-    if(!valid_args(argc, argv[ARG_PORT]))   // check for valid args
-        exit(1);
+    struct poll_set _set;
+    struct srv_conn *_conn;
+    uint64_t _t;
+    int _ready, _status;
 
-    nw_var.port = atoi(argv[ARG_PORT]);     // extract port from cmd arg
+    if(pollset_init(&_set, POLLINITSIZE) == -1)
+        return -1;
 
-    if(app_srv_hdr(SRVLOGFILE) == -1)       // append header to server log file
-        exit(1);
+    // set listening sockets
+    for(int i = 0; i < nw->nlisten; i++)
+        pollset_add(&_set, nw->listen[i].sd, NULL);
 
-    if(run_srv(&nw_var) == -1)
-        exit(1);
+    admit_set_pausable();
 
-    return 0;
-}
+    // poll loop
+    while(!srv_stop)
+    {
+        // wait for event
+        TRACE(TR_WAIT, 0);
+        _ready = poll(_set.fds, _set.size, admit_paused() ? ADMIT_RECHECK : cfg->idle_timeout);
+        TRACE(TR_WAKE, _ready > 0 ? _ready : 0);
+        series_loop(_ready > 0 ? _ready : 0);
+        _t = now_ns();
+        if(_ready == -1) // error
+        {
+            if(errno == EINTR)
+                continue;
 
+            printf("\tPoll Failed\n");
+            printf("\tError code: %s\n\n", strerror(errno));
+            close_listeners(nw);
+            pollset_free(&_set);
+            return -1;
+        }
 
-/*------------------------------------------------------------------------------
-|   FUNCTION:   int valid_args(int arg, char *port)
-|                   arg   : number of cmd ARGSNUM
-|                   *port : port argument
-|
-|   RETURN:     1 on true, 0 on false
-|
-|   DATE:       Feb 19, 2018
-|
-|   AUTHOR:     Alex Zielinski
-|
-|   DESC:       Checks for valid arguments (valid num of arg and valid port).
-|               Returns true (1) if args are valid, otherwise returns false (0).
-------------------------------------------------------------------------------*/
-int valid_args(int arg, char *port)
-{
-    // check valid number of args (2)
-    if(arg != ARGSNUM)
-    {
-        printf("\nUsage: ./srv_poll <PORT>\n\n");
-        return 0;
-    }
+        if(_ready == 0 && admit_paused())  // quiet while paused, let the lag decay
+        {
+            admit_loop_lag(0);
+            if(admit_resume(live_clts))
+                poll_listen(&_set, nw, 1);
+            continue;
+        }
 
-    // check for valid port
-    for(int i = 0; port[i] != '\0'; i++)
-        if(!isdigit(port[i]))
+        if(_ready == 0)  // timeout
         {
-            printf("\nError: Invalid port: %s.\n\n", port);
-            return 0;
+            printf("\n- Timeout....Terminating\n");
+            close_listeners(nw);
+            break;
         }
 
-    return 1;
+        for(int l = 0; l < nw->nlisten; l++)
+        {
+            if(!(_set.fds[l].revents & POLLIN))  // connection request
+                continue;
+
+            while(srv_accept(nw->listen[l].sd, 1, &_conn) == 0)
+                if(pollset_add(&_set, _conn->sd, _conn) == -1)
+                    conn_close(_conn);
+            _ready--;
+
+            if(admit_paused())  // over the limits, stop polling the listeners
+                poll_listen(&_set, nw, 0);
+        }
+
+        // check for more events, new entries have no revents yet
+        for(int i = nw->nlisten; i < _set.size && _ready > 0; )
+        {
+            if(_set.fds[i].revents == 0)
+            {
+                i++;
+                continue;
+            }
+
+            _ready--;
+            // data ready to read (or hang up / error)
+            _status = conn_service(_set.conns[i]);
+            if(_status != CONN_AGAIN && _status != CONN_WRITE) // client disconnected
+            {
+                conn_close(_set.conns[i]);
+                pollset_remove(&_set, i);   // last entry now sits at i
+                continue;
+            }
+            _set.fds[i].events = _status == CONN_WRITE ? POLLOUT : POLLIN;
+            i++;
+        }
+
+        admit_loop_lag(now_ns() - _t);
+        if(admit_resume(live_clts))
+            poll_listen(&_set, nw, 1);
+    }
+
+    pollset_free(&_set);
+    return 0;
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   int run_srv(struct srv_nw_var *nw)
-|                   *nw : pointer to clients network variables
+|   FUNCTION:   void poll_listen(struct poll_set *set, struct srv_nw_var *nw, int on)
+|                   *set : poll set whose first entries are the listeners
+|                   *nw  : servers network variables (listeners)
+|                   on   : 1 to poll the listeners, 0 to pause them
 |
-|   RETURN:     0 on success, -1 on failure
+|   RETURN:     void
 |
-|   DATE:       Feb 22, 2018
+|   DATE:       Oct 18, 2026
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       High level function to run the server. Sets up the server and
-|               the SIGINT interupt handler and then runs the poll loop that
-|               listens for incoming connections and monitors socket events.
+|   DESC:       Pauses or resumes the listeners by clearing or setting their
+|               poll events.
 ------------------------------------------------------------------------------*/
-int run_srv(struct srv_nw_var *nw)
+void poll_listen(struct poll_set *set, struct srv_nw_var *nw, int on)
 {
-    if(setup_srv(nw) == -1)
-        return -1;
-
-    if(set_SIGINT() == -1)
-        return -1;
-
-    if(run_poll_loop(*nw) == -1)
-        return -1;
-
-    return 0;
+    for(int i = 0; i < nw->nlisten; i++)
+        set->fds[i].events = on ? POLLIN : 0;
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   int setup_srv(struct srv_nw_var *nw)
-|                   *nw : pointer to clients network variables
+|   FUNCTION:   int pollset_init(struct poll_set *set, int cap)
+|                   *set : poll set to initialize
+|                   cap  : initial number of entries to allocate
 |
 |   RETURN:     0 on success, -1 on failure
 |
-|   DATE:       Feb 22, 2018
+|   DATE:       Oct 18, 2026
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       High level function to setup the server. Uses the networking
-|               related variables held in '*nw' to:
-|                   - create a socket
-|                   - set socket option to reuse address
-|                   - set socket to non-blocking
-|                   - bind socket
-|                   - set socket to listen
+|   DESC:       Allocates an empty poll set.
 ------------------------------------------------------------------------------*/
-int setup_srv(struct srv_nw_var *nw)
+int pollset_init(struct poll_set *set, int cap)
 {
-    int _optval = 1;
+    set->size = 0;
+    set->cap = cap;
+    set->fds = malloc(cap * sizeof *set->fds);
+    set->conns = malloc(cap * sizeof *set->conns);
 
-    if(create_socket(&(nw->sd_listen), AF_INET, SOCK_STREAM, 0) == -1)
-        return -1;
-
-    bzero((char *)&(nw->srv_addr), sizeof(struct sockaddr_in));
-    fill_addr(&(nw->srv_addr), AF_INET, htons(nw->port), htonl(INADDR_ANY));
-
-    setsockopt(nw->sd_listen, SOL_SOCKET, SO_REUSEADDR, &_optval, sizeof(_optval));
-
-    if(set_nonblocking(&(nw->sd_listen)) == -1)
-        return -1;
-
-    if(bind_socket(nw->sd_listen, (struct sockaddr *)&(nw->srv_addr), sizeof(nw->srv_addr)) == -1)
-        return -1;
-
-    if(listen_socket(nw->sd_listen, BACKLOG) == -1)
+    if(set->fds == NULL || set->conns == NULL)
+    {
+        printf("\tError allocating poll array\n");
+        pollset_free(set);
         return -1;
+    }
 
     return 0;
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   int run_poll_loop(struct srv_nw_var nw)
-|                   nw : clients network variables
+|   FUNCTION:   int pollset_add(struct poll_set *set, int fd, struct srv_conn *conn)
+|                   *set  : poll set to add to
+|                   fd    : socket to monitor for POLLIN
+|                   *conn : connection owning fd (NULL for listeners)
 |
 |   RETURN:     0 on success, -1 on failure
 |
-|   DATE:       Feb 22, 2018
+|   DATE:       Oct 18, 2026
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Function that runs the poll loop. Incoming connections are
-|               accepted and the new socket is added to the poll array. poll
-|               then monitors the array for any socket events and accomodates
-|               those events accordingly (echos back data);
+|   DESC:       Appends 'fd' to the end of the poll set, doubling the arrays
+|               when they are full.
 ------------------------------------------------------------------------------*/
-int run_poll_loop(struct srv_nw_var nw)
+int pollset_add(struct poll_set *set, int fd, struct srv_conn *conn)
 {
-    struct pollfd _clts[MAXCLIENTS];
-    struct sockaddr_in _clt_addr;
-    struct srv_log_stats _stats[MAXCLIENTS];
-    socklen_t _clt_addr_len;
-    char _recv_buff[PKTSIZE];
-    int _bytes_recv, _bytes_sent, _sd, _ready, _size, _total_clts = 0;
-    int _timeout = (0.1 * 60 * 1000); // set timeout to 10 sec
-
-    // set listening socket
-    _clts[0].fd = nw.sd_listen;
-    _clts[0].events = POLLIN;
-
-    // indicate available space
-    for(int i = 1; i < MAXCLIENTS; i++)
-        _clts[i].fd = -1;
-    _size = 1; // increase array size
-
-    bzero((char *)&(_stats), sizeof(struct srv_log_stats));
-    _clt_addr_len = sizeof(_clt_addr);
+    struct pollfd *_fds;
+    struct srv_conn **_conns;
 
-    // poll loop
-    while(1)
+    if(set->size == set->cap)
     {
-        // wait for event
-        _ready = poll(_clts, _size, _timeout);
-        if(_ready == -1) // error
-        {
-            printf("\tPoll Failed\n");
-            printf("\tError code: %s\n\n", strerror(errno));
-            close(nw.sd_listen);
+        if((_fds = realloc(set->fds, 2 * set->cap * sizeof *_fds)) == NULL)
             return -1;
-        }
-
-        if(_ready == 0)  // timeout
-        {
-            printf("\n- Timeout....Terminating\n");
-            close(nw.sd_listen);
-            append_total_clients(SRVLOGFILE, _total_clts);
+        set->fds = _fds;
+        if((_conns = realloc(set->conns, 2 * set->cap * sizeof *_conns)) == NULL)
             return -1;
-        }
-
-        if(_clts[0].revents == POLLIN)  // connection request
-        {
-            if((_sd = accept(nw.sd_listen, (struct sockaddr *)&_clt_addr, &_clt_addr_len)) == -1)
-            {
-                printf("\tError accepting connection\n");
-                printf("\tError code: %s\n\n", strerror(errno));
-                close(nw.sd_listen);
-                return -1;
-            }
-
-            for(int i = 1; i < MAXCLIENTS; i++)  // save new socket descriptor
-                if(_clts[i].fd == -1)
-                {
-                    _clts[i].fd = _sd;
-                    _clts[i].events = POLLIN;
-                    strcpy(_stats[i].clt_ip, inet_ntoa(_clt_addr.sin_addr));
-                    _stats[i].requests = 0;
-                    time_t t = time(NULL);
-                    _stats[i].tm = *localtime(&t); // time of new connection
-                    _total_clts++;
-                    printf("- Client connected: %s\n",  _stats[i].clt_ip);
-                    break;
-                }
-            _size++;
-            _ready--;
-        }
-
-        if(_ready > 0)  // check for more events
-        {
-            for(int i = 1; i < MAXCLIENTS; i++)
-            {
-                if(_clts[i].fd != -1)
-                {
-                    if(_clts[i].revents == POLLIN)  // data ready to read
-                    {
-                        // read socket
-                        _bytes_recv = recv(_clts[i].fd, _recv_buff, PKTSIZE, MSG_WAITALL);
-                        if(_bytes_recv == 0) // client disconnected
-                        {
-                            printf("- Client disconnected: %s\n", _stats[i].clt_ip);
-                            close(_clts[i].fd);
-                            _clts[i].fd = -1;
-                            append_srv_data(SRVLOGFILE, _stats[i]); // write to log file
-                        }
-                        else    // successfully read socket
-                        {
-                            _stats[i].requests++;   // update client requests
-
-                            // echo data back
-                            _bytes_sent = send(_clts[i].fd, _recv_buff, PKTSIZE, 0);
-                            update_bytes_struct(&(_stats[i].bytes), _bytes_sent);
-                            bzero(_recv_buff, sizeof(_recv_buff));
-                        }
-                        _ready--;
-                    }
-
-                    if(_ready <= 0) // no more events
-                        break;
-                }
-            }
-        }
+        set->conns = _conns;
+        set->cap *= 2;
     }
 
-    close(nw.sd_listen);
-    close(_sd);
+    set->fds[set->size].fd = fd;
+    set->fds[set->size].events = POLLIN;
+    set->fds[set->size].revents = 0;
+    set->conns[set->size] = conn;
+    set->size++;
+
     return 0;
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   int set_SIGINT()
+|   FUNCTION:   void pollset_remove(struct poll_set *set, int i)
+|                   *set : poll set to remove from
+|                   i    : index of entry to remove
 |
-|   RETURN:     0 on success, -1 on failure
+|   RETURN:     void
 |
-|   DATE:       Feb 20, 2018
+|   DATE:       Oct 18, 2026
 |
-|   AUTHOR:     Aman Abulla
+|   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Function to set up SIGINT interupt handler
+|   DESC:       Removes entry 'i' by moving the last entry into its place. The
+|               moved entry keeps its revents so a scan in progress can still
+|               service it at index 'i'.
 ------------------------------------------------------------------------------*/
-int set_SIGINT()
+void pollset_remove(struct poll_set *set, int i)
 {
-    struct sigaction act;
-    act.sa_handler = close_fd;
-    act.sa_flags = 0;
-
-    if ((sigemptyset (&act.sa_mask) == -1 || sigaction (SIGINT, &act, NULL) == -1))
-    {
-            printf("\n\tFailed to set SIGINT handler\n");
-            return -1;
-    }
-
-    return 0;
+    set->size--;
+    set->fds[i] = set->fds[set->size];
+    set->conns[i] = set->conns[set->size];
 }
 
 
-
 /*------------------------------------------------------------------------------
-|   FUNCTION:   void close_fd()
+|   FUNCTION:   void pollset_free(struct poll_set *set)
+|                   *set : poll set to free
 |
 |   RETURN:     void
 |
-|   DATE:       Feb 20, 2018
+|   DATE:       Oct 18, 2026
 |
-|   AUTHOR:     Aman Abdulla
+|   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Function to execute when SIGINT signal is encountered.
-|               Terminates server's listening socket
+|   DESC:       Releases the poll set's arrays. Connections still in the set
+|               are not closed.
 ------------------------------------------------------------------------------*/
-void close_fd()
+void pollset_free(struct poll_set *set)
 {
-    printf("\n\n- Terminating\n");
-    close(nw_var.sd_listen);
+    free(set->fds);
+    free(set->conns);
+    set->fds = NULL;
+    set->conns = NULL;
+    set->size = 0;
+    set->cap = 0;
 }
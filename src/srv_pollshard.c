@@ -0,0 +1,361 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     srv_pollshard.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Backend that represents a sharded multi-threaded poll server.
+|               The main thread only accepts connections and hands each one to
+|               one of N poll worker threads (round-robin or least loaded).
+|               Every worker owns its own densely packed poll array and is woken
+|               through an eventfd when a new connection is handed to it, so
+|               each poll() call only covers that shard's connections.
+|               When the server stops, the acceptor flags every shard and
+|               wakes it the same way, then joins it; a shard closes the
+|               connections it still owns before it exits.
+|
+|                   Usage: ./srv -b pollshard [-n SHARDS] [-d rr|ll]
+|                                [-m MAX PER SHARD] <PORT>
+------------------------------------------------------------------------------*/
+#include "../include/srv_pollshard.h"
+#include "../include/srv_poll.h"
+#include "../include/srv_engine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+/* --- Global ---- */
+const struct srv_backend pollshard_backend =
+{
+    "pollshard", "acceptor + N poll worker threads (sharded poll)", 1, 0, run_pollshard
+};
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int run_pollshard(struct srv_nw_var *nw, struct srv_config *cfg)
+|                   *nw  : pointer to servers network variables
+|                   *cfg : runtime options (shards, dispatch policy, shard max)
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Creates 'cfg->threads' poll shards then runs the accept loop.
+|               Each accepted connection is made non-blocking and handed to the
+|               shard chosen by pick_shard(). When every shard is at its
+|               maximum the connection is closed straight away. The shards
+|               are stopped and joined before returning.
+------------------------------------------------------------------------------*/
+int run_pollshard(struct srv_nw_var *nw, struct srv_config *cfg)
+{
+    struct poll_shard *_shards;
+    struct srv_conn *_conn;
+    int _s, _ret = 0;
+
+    if((_shards = calloc(cfg->threads, sizeof *_shards)) == NULL)
+        return -1;
+
+    for(int i = 0; i < cfg->threads; i++)
+    {
+        _shards[i].id = i;
+        pthread_mutex_init(&_shards[i].lock, NULL);
+
+        if((_shards[i].efd = eventfd(0, EFD_NONBLOCK)) == -1
+           || pollset_init(&_shards[i].set, POLLINITSIZE) == -1
+           || pollset_add(&_shards[i].set, _shards[i].efd, NULL) == -1)
+        {
+            printf("\tError creating poll shard\n");
+            printf("\tError code: %s\n\n", strerror(errno));
+            pollset_free(&_shards[i].set);
+            if(_shards[i].efd != -1)
+                close(_shards[i].efd);
+            stop_shards(_shards, i);
+            return -1;
+        }
+
+        if(pthread_create(&_shards[i].thread, NULL, shard_loop, &_shards[i]) != 0)
+        {
+            printf("\n\tError creating shard thread\n");
+            pollset_free(&_shards[i].set);
+            close(_shards[i].efd);
+            stop_shards(_shards, i);
+            return -1;
+        }
+    }
+    printf("- Created %d poll shards (%s dispatch)\n", cfg->threads,
+           cfg->dispatch == DISPATCH_LL ? "least loaded" : "round-robin");
+
+    // loop on accept
+    while(!srv_stop)
+    {
+        if(srv_accept_any(nw, 1, &_conn) == -1)
+        {
+            _ret = srv_stop ? 0 : -1;
+            break;
+        }
+
+        if((_s = pick_shard(_shards, cfg->threads, cfg)) == -1)
+        {
+            printf("- All shards full, rejecting %s\n", _conn->stats.clt_ip);
+            conn_close(_conn);
+            continue;
+        }
+
+        if(hand_off(&_shards[_s], _conn) == -1)
+            conn_close(_conn);
+    }
+
+    stop_shards(_shards, cfg->threads);
+    return _ret;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void stop_shards(struct poll_shard *shards, int n)
+|                   *shards : shard array, freed on return
+|                   n       : number of shards running
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Flags every shard to stop, wakes it through its eventfd and
+|               waits for it to exit, so no shard still serves a connection
+|               once the final reports are printed.
+------------------------------------------------------------------------------*/
+void stop_shards(struct poll_shard *shards, int n)
+{
+    uint64_t _one = 1;
+
+    for(int i = 0; i < n; i++)
+    {
+        __atomic_store_n(&shards[i].stop, 1, __ATOMIC_RELEASE);
+        if(write(shards[i].efd, &_one, sizeof(_one)) == -1 && errno != EAGAIN)
+        {
+            printf("\tError waking shard %d\n", i);
+            printf("\tError code: %s\n\n", strerror(errno));
+        }
+    }
+
+    for(int i = 0; i < n; i++)
+    {
+        pthread_join(shards[i].thread, NULL);
+        pthread_mutex_destroy(&shards[i].lock);
+        close(shards[i].efd);
+    }
+
+    free(shards);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int pick_shard(struct poll_shard *shards, int n, struct srv_config *cfg)
+|                   *shards : shard array
+|                   n       : number of shards
+|                   *cfg    : runtime options (dispatch policy, shard max)
+|
+|   RETURN:     index of shard to use, -1 if every shard is full
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Chooses the shard for a new connection. Round-robin skips full
+|               shards, least loaded picks the shard owning fewest connections.
+|               Shard counts are read without locking; a slightly stale count
+|               only affects balance, not correctness.
+------------------------------------------------------------------------------*/
+int pick_shard(struct poll_shard *shards, int n, struct srv_config *cfg)
+{
+    static int _next = 0;
+    int _best = -1, _load;
+
+    for(int i = 0; i < n; i++)
+    {
+        int _s = (cfg->dispatch == DISPATCH_RR) ? (_next + i) % n : i;
+
+        _load = __atomic_load_n(&shards[_s].nconns, __ATOMIC_RELAXED);
+        if(cfg->shard_max > 0 && _load >= cfg->shard_max)
+            continue;
+
+        if(cfg->dispatch == DISPATCH_RR)
+        {
+            _next = (_s + 1) % n;
+            return _s;
+        }
+
+        if(_best == -1 || _load < __atomic_load_n(&shards[_best].nconns, __ATOMIC_RELAXED))
+            _best = _s;
+    }
+
+    return _best;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int hand_off(struct poll_shard *shard, struct srv_conn *conn)
+|                   *shard : shard that takes ownership of the connection
+|                   *conn  : connection to hand over
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Pushes the connection onto the shard's inbox and wakes the
+|               shard through its eventfd.
+------------------------------------------------------------------------------*/
+int hand_off(struct poll_shard *shard, struct srv_conn *conn)
+{
+    uint64_t _one = 1;
+
+    __atomic_add_fetch(&shard->nconns, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&shard->lock);
+    conn->next = shard->inbox;
+    shard->inbox = conn;
+    pthread_mutex_unlock(&shard->lock);
+
+    if(write(shard->efd, &_one, sizeof(_one)) == -1 && errno != EAGAIN)
+    {
+        printf("\tError waking shard %d\n", shard->id);
+        printf("\tError code: %s\n\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void *shard_loop(void *args)
+|                   *args : shard this thread runs
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Poll loop of one shard. Entry 0 of the poll array is the
+|               shard's eventfd; when it fires the inbox is drained into the
+|               poll array. Every other ready entry is serviced by the
+|               connection core and swap-removed once the client disconnects.
+|               Once flagged to stop, the shard closes every connection it
+|               owns, those still in the inbox included, and frees its poll
+|               array; the eventfd is closed by stop_shards().
+------------------------------------------------------------------------------*/
+void *shard_loop(void *args)
+{
+    struct poll_shard *_shard = (struct poll_shard *)args;
+    struct poll_set *_set = &_shard->set;
+    int _ready, _status;
+
+    block_SIGINT();
+
+    while(!__atomic_load_n(&_shard->stop, __ATOMIC_ACQUIRE))
+    {
+        // wait for event
+        TRACE(TR_WAIT, 0);
+        _ready = poll(_set->fds, _set->size, -1);
+        TRACE(TR_WAKE, _ready > 0 ? _ready : 0);
+        series_loop(_ready > 0 ? _ready : 0);
+        if(_ready == -1)
+        {
+            if(errno == EINTR)
+                continue;
+
+            printf("\tPoll Failed (shard %d)\n", _shard->id);
+            printf("\tError code: %s\n\n", strerror(errno));
+            break;
+        }
+
+        if(_set->fds[0].revents & POLLIN)  // new connections handed over
+        {
+            drain_inbox(_shard);
+            _ready--;
+            if(__atomic_load_n(&_shard->stop, __ATOMIC_ACQUIRE))  // server stopping
+                break;
+        }
+
+        // check for more events, new entries have no revents yet
+        for(int i = 1; i < _set->size && _ready > 0; )
+        {
+            if(_set->fds[i].revents == 0)
+            {
+                i++;
+                continue;
+            }
+
+            _ready--;
+            _status = conn_service(_set->conns[i]);
+            if(_status != CONN_AGAIN && _status != CONN_WRITE) // client disconnected
+            {
+                conn_close(_set->conns[i]);
+                pollset_remove(_set, i);   // last entry now sits at i
+                __atomic_sub_fetch(&_shard->nconns, 1, __ATOMIC_RELAXED);
+                continue;
+            }
+            _set->fds[i].events = _status == CONN_WRITE ? POLLOUT : POLLIN;
+            i++;
+        }
+    }
+
+    // stopped (or poll failed): close what is left
+    drain_inbox(_shard);
+    for(int i = 1; i < _set->size; i++)
+        conn_close(_set->conns[i]);
+    __atomic_store_n(&_shard->nconns, 0, __ATOMIC_RELAXED);
+    pollset_free(_set);
+
+    return NULL;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void drain_inbox(struct poll_shard *shard)
+|                   *shard : shard whose inbox to drain
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Clears the shard's eventfd and moves every connection waiting
+|               in the inbox into the shard's poll array.
+------------------------------------------------------------------------------*/
+void drain_inbox(struct poll_shard *shard)
+{
+    struct srv_conn *_conn, *_next;
+    uint64_t _count;
+
+    if(read(shard->efd, &_count, sizeof(_count)) == -1 && errno != EAGAIN)
+        printf("\tError reading eventfd (shard %d)\n", shard->id);
+
+    pthread_mutex_lock(&shard->lock);
+    _conn = shard->inbox;
+    shard->inbox = NULL;
+    pthread_mutex_unlock(&shard->lock);
+
+    for(; _conn != NULL; _conn = _next)
+    {
+        _next = _conn->next;
+        _conn->next = NULL;
+        if(pollset_add(&shard->set, _conn->sd, _conn) == -1)
+        {
+            conn_close(_conn);
+            __atomic_sub_fetch(&shard->nconns, 1, __ATOMIC_RELAXED);
+        }
+    }
+}
@@ -0,0 +1,210 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     srv_pool.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Backend that represents a thread pool server. A fixed number of
+|               worker threads is created up front. The main thread accepts
+|               connections and places them on a bounded queue where the next
+|               idle worker picks them up and services them until the client
+|               disconnects (blocking I/O, one connection per worker at a time).
+|               When the server stops, the queued connections are closed, the
+|               ones being served are shut down so their worker's blocking
+|               recv returns, and every worker is joined.
+|
+|                             Usage: ./srv -b pool [-n THREADS] <PORT>
+------------------------------------------------------------------------------*/
+#include "../include/srv_pool.h"
+#include "../include/srv_engine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+/* --- Global ---- */
+const struct srv_backend pool_backend =
+{
+    "pool", "fixed pool of worker threads (blocking I/O)", 0, 0, run_pool
+};
+static struct conn_queue queue =
+{
+    {NULL}, 0, 0, NULL, 0,
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER
+};
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int run_pool(struct srv_nw_var *nw, struct srv_config *cfg)
+|                   *nw  : pointer to servers network variables
+|                   *cfg : runtime options (number of worker threads)
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Creates 'cfg->threads' workers then accepts connections and
+|               queues them. Blocks while the queue is full so a saturated pool
+|               pushes back on the listen backlog instead of growing; the wait
+|               wakes every POOLRECHECK ms to see whether the server stopped.
+|               The workers are stopped and joined before returning.
+------------------------------------------------------------------------------*/
+int run_pool(struct srv_nw_var *nw, struct srv_config *cfg)
+{
+    struct srv_conn *_conn;
+    struct timespec _ts;
+    pthread_t *_threads;
+    int _ret = 0, _err, _started;
+
+    if((_threads = calloc(cfg->threads, sizeof *_threads)) == NULL
+       || (queue.busy = calloc(cfg->threads, sizeof *queue.busy)) == NULL)
+    {
+        free(_threads);
+        return -1;
+    }
+
+    for(_started = 0; _started < cfg->threads; _started++)
+    {
+        if((_err = pthread_create(&_threads[_started], NULL, pool_worker, &queue.busy[_started])) != 0)
+        {
+            printf("\n\tError creating worker thread\n");
+            printf("\tError code: %s\n\n", strerror(_err));
+            _ret = -1;
+            break;
+        }
+    }
+    if(_ret == 0)
+        printf("- Created %d worker threads\n", cfg->threads);
+
+    // loop on accept
+    while(_ret == 0 && !srv_stop)
+    {
+        if(srv_accept_any(nw, 0, &_conn) == -1)
+        {
+            _ret = srv_stop ? 0 : -1;
+            break;
+        }
+
+        pthread_mutex_lock(&queue.lock);
+        while(queue.count == QUEUESIZE && !srv_stop)
+        {
+            clock_gettime(CLOCK_REALTIME, &_ts);
+            _ts.tv_nsec += POOLRECHECK * 1000000L;
+            if(_ts.tv_nsec >= 1000000000L)
+            {
+                _ts.tv_sec++;
+                _ts.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&queue.not_full, &queue.lock, &_ts);
+        }
+        if(queue.count == QUEUESIZE)  // stopped while full
+        {
+            pthread_mutex_unlock(&queue.lock);
+            conn_close(_conn);
+            break;
+        }
+        queue.conns[(queue.head + queue.count) % QUEUESIZE] = _conn;
+        queue.count++;
+        pthread_cond_signal(&queue.not_empty);
+        pthread_mutex_unlock(&queue.lock);
+    }
+
+    pool_stop(_threads, _started);
+    return _ret;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void pool_stop(pthread_t *threads, int n)
+|                   *threads : worker threads, freed on return
+|                   n        : number of workers running
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Closes the connections still queued, shuts down the ones
+|               being served so their worker's recv returns and the worker
+|               closes them, then wakes the idle workers and joins them all.
+------------------------------------------------------------------------------*/
+void pool_stop(pthread_t *threads, int n)
+{
+    pthread_mutex_lock(&queue.lock);
+    queue.quit = 1;
+    for(; queue.count > 0; queue.count--)
+    {
+        conn_close(queue.conns[queue.head]);
+        queue.head = (queue.head + 1) % QUEUESIZE;
+    }
+    for(int i = 0; i < n; i++)
+        if(queue.busy[i] != NULL)
+            shutdown(queue.busy[i]->sd, SHUT_RDWR);
+    pthread_cond_broadcast(&queue.not_empty);
+    pthread_cond_broadcast(&queue.not_full);
+    pthread_mutex_unlock(&queue.lock);
+
+    for(int i = 0; i < n; i++)
+        pthread_join(threads[i], NULL);
+
+    free(threads);
+    free(queue.busy);
+    queue.busy = NULL;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void *pool_worker(void *args)
+|                   *args : this worker's slot in queue.busy
+|
+|   RETURN:     NULL
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Worker thread. Takes the next queued connection and runs the
+|               connection core on it until the client disconnects. The
+|               connection is published in the worker's busy slot meanwhile,
+|               so pool_stop() can shut it down. Exits once the queue is
+|               empty and the server stops.
+------------------------------------------------------------------------------*/
+void *pool_worker(void *args)
+{
+    struct srv_conn **_busy = (struct srv_conn **)args;
+    struct srv_conn *_conn;
+
+    block_SIGINT();
+
+    while(1)
+    {
+        pthread_mutex_lock(&queue.lock);
+        while(queue.count == 0 && !queue.quit)
+            pthread_cond_wait(&queue.not_empty, &queue.lock);
+        if(queue.count == 0)  // server stopping
+        {
+            pthread_mutex_unlock(&queue.lock);
+            break;
+        }
+        _conn = queue.conns[queue.head];
+        queue.head = (queue.head + 1) % QUEUESIZE;
+        queue.count--;
+        *_busy = _conn;
+        pthread_cond_signal(&queue.not_full);
+        pthread_mutex_unlock(&queue.lock);
+
+        conn_service(_conn);
+
+        // unpublish before freeing it, pool_stop() may be shutting it down
+        pthread_mutex_lock(&queue.lock);
+        *_busy = NULL;
+        pthread_mutex_unlock(&queue.lock);
+        conn_close(_conn);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,429 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     srv_steal.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Backend that represents an M:N work-stealing server. Each of
+|               the N workers accepts connections for itself and owns them in
+|               its own epoll instance, registered EPOLLONESHOT so a
+|               connection is only ever handed out once per event. Ready
+|               connections go into the worker's Chase-Lev deque (deque.c);
+|               the worker services them newest first, and a worker that runs
+|               out of work steals the oldest ready connection of a random
+|               busy worker. After servicing, a connection is re-armed in its
+|               home worker's epoll, so its next event goes back home and a
+|               steal only moves one burst, not the connection.
+|
+|               With --no-steal the same runtime behaves like a sharded epoll
+|               server, which is the baseline for skewed load. Steal counts and
+|               per-worker utilization are reported when the server stops.
+|
+|               The workers are a worker group (workers.c): worker 0 runs on
+|               the main thread and stops the others when the server stops.
+|
+|                   Usage: ./srv -b steal [-n THREADS] [--no-steal] <PORT>
+------------------------------------------------------------------------------*/
+#include "../include/srv_steal.h"
+#include "../include/srv_engine.h"
+#include "../include/deque.h"
+#include "../include/hist.h"
+#include "../include/workers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+/* --- Global ---- */
+const struct srv_backend steal_backend =
+{
+    "steal", "N workers with epoll + work-stealing deques (M:N)", 1, 1, run_steal
+};
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int run_steal(struct srv_nw_var *nw, struct srv_config *cfg)
+|                   *nw  : pointer to servers network variables
+|                   *cfg : runtime options (workers, stealing on/off)
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Creates 'cfg->threads' workers, the first of which runs on the
+|               calling thread so it sees SIGINT. Once it stops, the other
+|               workers are stopped and joined, the connections they still
+|               hold are closed, then steals and utilization are reported.
+|               A worker that failed makes the run fail.
+------------------------------------------------------------------------------*/
+int run_steal(struct srv_nw_var *nw, struct srv_config *cfg)
+{
+    struct steal_worker *_workers;
+    struct srv_workers _group;
+    struct srv_conn *_conn;
+    int _ret = 0;
+
+    if((_workers = aligned_alloc(64, cfg->threads * sizeof *_workers)) == NULL)
+        return -1;
+    memset(_workers, 0, cfg->threads * sizeof *_workers);
+
+    if(workers_init(&_group, cfg->threads) == -1)
+    {
+        free(_workers);
+        return -1;
+    }
+
+    for(int i = 0; i < cfg->threads; i++)
+    {
+        deque_init(&_workers[i].deque);
+        pthread_mutex_init(&_workers[i].lock, NULL);
+        _workers[i].id = i;
+        _workers[i].nworkers = cfg->threads;
+        _workers[i].all = _workers;
+        _workers[i].group = &_group;
+        _workers[i].nw = nw;
+        _workers[i].cfg = cfg;
+        _workers[i].rng = 0x9e3779b97f4a7c15ull * (i + 1);
+        _workers[i].esd = -1;
+    }
+
+    for(int i = 0; i < cfg->threads && _ret == 0; i++)
+        if((_workers[i].esd = workers_epoll(&_group, nw)) == -1)
+            _ret = -1;
+
+    if(_ret == 0)
+    {
+        printf("- Created %d workers (stealing %s)\n", cfg->threads, cfg->steal ? "on" : "off");
+        _ret = workers_start(&_group, steal_loop, _workers, sizeof *_workers);
+    }
+
+    if(_ret == 0)
+        _ret = steal_loop(&_workers[0]) == NULL ? 0 : -1;
+
+    if(workers_stop(&_group) == -1)
+        _ret = -1;
+
+    // every worker is gone: close what they held, queued in a deque or not
+    for(int i = 0; i < cfg->threads; i++)
+    {
+        while((_conn = _workers[i].conns) != NULL)
+        {
+            conn_unlink(&_workers[i].conns, _conn);
+            conn_close(_conn);
+        }
+        if(_workers[i].esd != -1)
+            close(_workers[i].esd);
+        pthread_mutex_destroy(&_workers[i].lock);
+    }
+
+    report_steal(_workers, cfg->threads);
+    free(_workers);
+    return _ret;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void *steal_loop(void *args)
+|                   *args : worker to run
+|
+|   RETURN:     NULL when the server stops or times out, (void *)-1 on error
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Worker loop. In order of preference a worker:
+|                   - services the newest connection of its own deque
+|                   - moves its own ready events into the deque
+|                   - steals from another worker
+|                   - sleeps in epoll_wait (briefly when stealing is on, so
+|                     it comes back to look for work)
+|               Only worker 0 times out, once the server has had a connection
+|               and no worker has had an event for the idle timeout; the
+|               others run until the group stops.
+------------------------------------------------------------------------------*/
+void *steal_loop(void *args)
+{
+    struct steal_worker *_w = (struct steal_worker *)args;
+    struct srv_conn *_conn;
+    int _ready, _timeout;
+
+    if(_w->id != 0)
+        block_SIGINT();
+
+    _w->start_ns = now_ns();
+    _timeout = _w->cfg->steal ? STEALWAIT : _w->cfg->idle_timeout;
+
+    while(!workers_stopping(_w->group))
+    {
+        if((_conn = deque_take(&_w->deque)) != DEQUE_EMPTY)
+        {
+            steal_run(_w, _conn);
+            continue;
+        }
+
+        if((_ready = steal_poll(_w, 0)) != 0)
+        {
+            if(_ready == -1)
+                return (void *)-1;
+            continue;
+        }
+
+        if(_w->cfg->steal && (_conn = steal_from(_w)) != NULL)
+        {
+            _w->stolen++;
+            steal_run(_w, _conn);
+            workers_busy(_w->group, _w->id);
+            continue;
+        }
+
+        // nothing to do
+        if((_ready = steal_poll(_w, _timeout)) == -1)
+            return (void *)-1;
+
+        if(_ready == 0 && _w->id == 0 && _w->cfg->idle_timeout >= 0
+           && __atomic_load_n(&total_clts, __ATOMIC_RELAXED) > 0
+           && workers_idle(_w->group, _w->cfg->idle_timeout))
+        {
+            printf("\n- Timeout....Terminating\n");
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int steal_poll(struct steal_worker *w, int timeout)
+|                   *w      : worker
+|                   timeout : ms to wait for events
+|
+|   RETURN:     number of events, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Collects the worker's ready events. New connections are
+|               accepted and registered with this worker as their home, ready
+|               connections are pushed on the worker's deque where thieves can
+|               see them. A batch is never larger than the deque, so pushing
+|               only fails if the deque is shared wrong; then the connection
+|               is serviced right away. Any event counts as activity for the
+|               idle timeout.
+------------------------------------------------------------------------------*/
+int steal_poll(struct steal_worker *w, int timeout)
+{
+    struct epoll_event _events[STEALEVENTS];
+    struct srv_listener *_l;
+    struct srv_conn *_conn;
+    int _ready;
+
+    TRACE(TR_WAIT, 0);
+    _ready = epoll_wait(w->esd, _events, STEALEVENTS, timeout);
+    TRACE(TR_WAKE, _ready > 0 ? _ready : 0);
+    series_loop(_ready > 0 ? _ready : 0);
+    if(_ready == -1)
+    {
+        if(errno == EINTR)
+            return 0;
+
+        printf("\tEPoll Failed\n");
+        printf("\tError code: %s\n\n", strerror(errno));
+        return -1;
+    }
+
+    if(_ready > 0)
+        workers_busy(w->group, w->id);
+
+    for(int i = 0; i < _ready; i++)
+    {
+        if(_events[i].data.ptr == NULL)  // stop eventfd, see workers_stop()
+            continue;
+
+        if((_l = find_listener(w->nw, _events[i].data.ptr)) != NULL) // connection request
+        {
+            while(srv_accept(_l->sd, 1, &_conn) == 0)
+            {
+                _conn->owner = w;
+                pthread_mutex_lock(&w->lock);
+                conn_link(&w->conns, _conn);
+                pthread_mutex_unlock(&w->lock);
+                if(steal_arm(w, _conn, EPOLL_CTL_ADD) == -1)
+                    steal_close(_conn);
+            }
+        }
+        else if(deque_push(&w->deque, _events[i].data.ptr) == -1)
+            steal_run(w, _events[i].data.ptr);
+    }
+
+    return _ready;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   struct srv_conn *steal_from(struct steal_worker *w)
+|                   *w : idle worker
+|
+|   RETURN:     stolen connection, NULL if no worker had one to spare
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Visits the other workers once, starting at a random one, and
+|               steals the oldest ready connection of the first non-empty
+|               deque. A lost race moves on to the next victim.
+------------------------------------------------------------------------------*/
+struct srv_conn *steal_from(struct steal_worker *w)
+{
+    struct steal_worker *_victim;
+    void *_item;
+    int _start;
+
+    if(w->nworkers < 2)
+        return NULL;
+
+    // xorshift64
+    w->rng ^= w->rng << 13;
+    w->rng ^= w->rng >> 7;
+    w->rng ^= w->rng << 17;
+    _start = w->rng % w->nworkers;
+
+    for(int i = 0; i < w->nworkers; i++)
+    {
+        _victim = &w->all[(_start + i) % w->nworkers];
+        if(_victim == w || deque_size(&_victim->deque) == 0)
+            continue;
+
+        w->attempts++;
+        _item = deque_steal(&_victim->deque);
+        if(_item != DEQUE_EMPTY && _item != DEQUE_ABORT)
+            return _item;
+    }
+
+    return NULL;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void steal_run(struct steal_worker *w, struct srv_conn *conn)
+|                   *w    : worker running the connection
+|                   *conn : ready connection
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Services a connection until its socket is drained, then
+|               re-arms it in its home worker's epoll (or closes it).
+------------------------------------------------------------------------------*/
+void steal_run(struct steal_worker *w, struct srv_conn *conn)
+{
+    uint64_t _t = now_ns();
+    int _status = conn_service(conn);
+
+    if((_status != CONN_AGAIN && _status != CONN_WRITE) || steal_arm(conn->owner, conn, EPOLL_CTL_MOD) == -1)
+        steal_close(conn);
+
+    w->runs++;
+    w->busy_ns += now_ns() - _t;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void steal_close(struct srv_conn *conn)
+|                   *conn : connection to close
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Takes a connection off its home worker's list and closes it,
+|               which also removes it from the home epoll set. A thief may
+|               close a connection, hence the home worker's lock.
+------------------------------------------------------------------------------*/
+void steal_close(struct srv_conn *conn)
+{
+    struct steal_worker *_home = conn->owner;
+
+    pthread_mutex_lock(&_home->lock);
+    conn_unlink(&_home->conns, conn);
+    pthread_mutex_unlock(&_home->lock);
+    conn_close(conn);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int steal_arm(struct steal_worker *home, struct srv_conn *conn,
+|                             int op)
+|                   *home : worker owning the connection
+|                   *conn : connection
+|                   op    : EPOLL_CTL_ADD for new connections, else EPOLL_CTL_MOD
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Arms a connection for exactly one event in its home epoll:
+|               writability while a response tail is pending, else a request.
+------------------------------------------------------------------------------*/
+int steal_arm(struct steal_worker *home, struct srv_conn *conn, int op)
+{
+    struct epoll_event _event;
+
+    _event.data.ptr = conn;
+    _event.events = (conn->olen > 0 ? EPOLLOUT : EPOLLIN) | EPOLLRDHUP | EPOLLONESHOT;
+    if(epoll_ctl(home->esd, op, conn->sd, &_event) == -1)
+    {
+        printf("\tError arming client sock in epoll event loop\n");
+        printf("\tError code: %s\n\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void report_steal(struct steal_worker *workers, int n)
+|                   *workers : workers
+|                   n        : number of workers
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Prints per worker how many connection runs it did, how many
+|               of them were stolen and how busy it was. Called once every
+|               worker has stopped.
+------------------------------------------------------------------------------*/
+void report_steal(struct steal_worker *workers, int n)
+{
+    uint64_t _now = now_ns();
+    long _runs = 0, _stolen = 0;
+
+    printf("\nWorkers\n");
+    for(int i = 0; i < n; i++)
+    {
+        printf("- Worker %d: %ld runs, %ld stolen (%ld attempts), %.1f%% busy\n", i,
+               workers[i].runs, workers[i].stolen, workers[i].attempts,
+               100.0 * workers[i].busy_ns / (_now - workers[i].start_ns));
+        _runs += workers[i].runs;
+        _stolen += workers[i].stolen;
+    }
+    printf("- Total: %ld runs, %ld stolen (%.1f%%)\n", _runs, _stolen,
+           _runs > 0 ? 100.0 * _stolen / _runs : 0.0);
+}
@@ -3,351 +3,401 @@
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Module that represents the traditional multi-threaded server
-|               program. The program takes in 1 additional cmd argument:
-|                   - host port
-|
-|                             Usage: ./clt <PORT>
-|
-|               The program will then listen on PORT for any incoming
-|               connections. Once a connection has been accepted then the server
-|               will create a new thread in order to accomodate that new
-|               connection. As a result each new connection will have its own
-|               thread.
+|   DESC:       Backend that represents the traditional multi-threaded server.
+|               The server listens for incoming connections. Once a connection
+|               has been accepted the server will create a new thread in order
+|               to accomodate that new connection. As a result each new
+|               connection will have its own thread.
+|
+|               Threads are created with a small stack (--stack KB) and a
+|               guard region below it (--guard KB). When a client disconnects
+|               its thread parks in a thread cache (--thread-cache N) and is
+|               handed the next accepted connection instead of exiting, so a
+|               busy server stops paying for thread creation. Thread creation
+|               rate, reuse and RSS are reported when the server stops.
+|
+|               Every thread links itself into the cache with the connection
+|               it serves. When the server stops, the parked threads are woken
+|               to exit and the connections being served are shut down so
+|               their blocking recv returns; the report waits for the last
+|               thread to leave.
+|
+|                             Usage: ./srv -b thread <PORT>
 ------------------------------------------------------------------------------*/
 #include "../include/srv_thread.h"
-#include "../include/socket.h"
-#include "../include/log.h"
+#include "../include/srv_engine.h"
+#include "../include/memstat.h"
+#include "../include/hist.h"
 #include <stdio.h>
-#include <stdlib.h>
-#include <unistd.h>
 #include <string.h>
-#include <errno.h>
-#include <unistd.h>
-#include <arpa/inet.h>
-#include <signal.h>
+#include <limits.h>
 #include <pthread.h>
-#include <ctype.h>
+#include <sys/socket.h>
 
 /* --- Global ---- */
-struct srv_nw_var nw_var;
-int total_clts = 0;
+const struct srv_backend thread_backend =
+{
+    "thread", "one thread per connection (blocking I/O)", 0, 0, run_accept_loop
+};
+static struct thread_cache cache =
+{
+    NULL, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, 0,
+    PTHREAD_COND_INITIALIZER, 0, 0, 0, 0, 0
+};
+static int cache_max;               // --thread-cache
 
-/*==============================================================================
-|   FUNCTION:   int main(int argc, char **argv)
-|                   argc   : number of cmd args
-|                   **argv : array of args
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int run_accept_loop(struct srv_nw_var *nw, struct srv_config *cfg)
+|                   *nw  : pointer to servers network variables
+|                   *cfg : runtime options
 |
-|   RETURN:     0 on success
+|   RETURN:     0 on success, -1 on failure
 |
-|   DATE:       Feb 19, 2018
+|   DATE:       Feb 15, 2018
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Main entry point of the program.
-==============================================================================*/
-int main(int argc, char **argv)
+|   DESC:       Function that accepts client connections. Once a connection
+|               has been established it is handed to a parked thread from the
+|               thread cache, or when none is parked a new thread is created
+|               in order to accomodate the new connection.
+------------------------------------------------------------------------------*/
+int run_accept_loop(struct srv_nw_var *nw, struct srv_config *cfg)
 {
-    if(!valid_args(argc, argv[ARG_PORT]))   // check for valid args
-        exit(1);
+    struct mem_sample _mem;
+    struct srv_conn *_conn;
+    pthread_attr_t _attr;
+    pthread_t _thread;
+    uint64_t _start = now_ns(), _t;
+    long _next_step = next_scale_step(0), _base_rss = 0, _peak_rss = 0;
+    int _ret = 0, _err, _peak;
+
+    if(thread_attr_init(&_attr, cfg) == -1)
+        return -1;
+    cache_max = cfg->thread_cache;
+
+    if(mem_sample(&_mem) == 0)
+        _base_rss = _peak_rss = _mem.rss;
 
-    nw_var.port = atoi(argv[ARG_PORT]);     // extract port from cmd arg
+    // loop on accept
+    while(!srv_stop)
+    {
+        if(srv_accept_any(nw, 0, &_conn) == -1)
+        {
+            _ret = srv_stop ? 0 : -1;
+            break;
+        }
 
-    if(app_srv_hdr(SRVLOGFILE) == -1)       // append header to server log file
-        exit(1);
+        if(cache_handoff(_conn) == 0)  // a parked thread took it
+            continue;
 
-    if(run_srv(&nw_var) == -1)
-        exit(1);
+        // accomodate client connection in seperate thread
+        _t = now_ns();
+        if((_err = pthread_create(&_thread, &_attr, echo_loop, _conn)) != 0)
+        {
+            printf("\n\tError creating thread\n");
+            printf("\tError code: %s\n\n", strerror(_err));
+            conn_close(_conn);
+            _ret = -1;
+            break;
+        }
+        pthread_detach(_thread);
+
+        pthread_mutex_lock(&cache.lock);
+        cache.create_ns += now_ns() - _t;
+        cache.created++;
+        if(++cache.live > cache.peak)
+            cache.peak = cache.live;
+        _peak = cache.peak;
+        pthread_mutex_unlock(&cache.lock);
+
+        // RSS as the thread count grows (same steps as the scale mode report)
+        if(_peak >= _next_step && mem_sample(&_mem) == 0)
+        {
+            if(_mem.rss > _peak_rss)
+                _peak_rss = _mem.rss;
+            _next_step = next_scale_step(_peak);
+        }
+    }
 
-    return 0;
+    cache_stop();
+
+    if(mem_sample(&_mem) == 0 && _mem.rss > _peak_rss)
+        _peak_rss = _mem.rss;
+
+    pthread_attr_destroy(&_attr);
+    report_threads(cfg, now_ns() - _start, _base_rss, _peak_rss);
+    return _ret;
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   int valid_args(int arg, char *port)
-|                   arg   : number of cmd ARGSNUM
-|                   *port : port argument
+|   FUNCTION:   int thread_attr_init(pthread_attr_t *attr,
+|                                    const struct srv_config *cfg)
+|                   *attr : attributes to initialize
+|                   *cfg  : runtime options (stack and guard size)
 |
-|   RETURN:     1 on true, 0 on false
+|   RETURN:     0 on success, -1 on failure
 |
-|   DATE:       Feb 19, 2018
+|   DATE:       Oct 18, 2026
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Checks for valid arguments (valid num of arg and valid port).
-|               Returns true (1) if args are valid, otherwise returns false (0).
+|   DESC:       Sets up the attributes of connection threads. The default 8 MB
+|               stack reservation is what limits a thread per connection
+|               design first, so stacks are sized explicitly with a guard
+|               region below them to turn an overflow into a crash instead of
+|               silent corruption.
 ------------------------------------------------------------------------------*/
-int valid_args(int arg, char *port)
+int thread_attr_init(pthread_attr_t *attr, const struct srv_config *cfg)
 {
-    // check valid number of args (2)
-    if(arg != ARGSNUM)
+    size_t _stack = (size_t)cfg->stack_kb * 1024;
+
+    if(_stack < PTHREAD_STACK_MIN)
     {
-        printf("\nUsage: ./srv_thread <PORT>\n\n");
-        return 0;
+        printf("\tError: Thread stack must be at least %ld KB\n\n", (long)PTHREAD_STACK_MIN / 1024);
+        return -1;
     }
 
-    // check for valid port
-    for(int i = 0; port[i] != '\0'; i++)
-        if(!isdigit(port[i]))
-        {
-            printf("\nError: Invalid port: %s.\n\n", port);
-            return 0;
-        }
+    pthread_attr_init(attr);
+    if(pthread_attr_setstacksize(attr, _stack) != 0
+       || pthread_attr_setguardsize(attr, (size_t)cfg->guard_kb * 1024) != 0)
+    {
+        printf("\tError setting thread stack size\n\n");
+        pthread_attr_destroy(attr);
+        return -1;
+    }
 
-    return 1;
+    printf("- Thread stack: %d KB + %d KB guard, cache up to %d idle threads\n",
+           cfg->stack_kb, cfg->guard_kb, cfg->thread_cache);
+    return 0;
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   int run_srv(struct srv_nw_var *nw)
-|                   *nw : pointer to clients network variables
+|   FUNCTION:   int cache_handoff(struct srv_conn *conn)
+|                   *conn : newly accepted connection
 |
-|   RETURN:     0 on success, -1 on failure
+|   RETURN:     0 if a parked thread took the connection, -1 if none is parked
 |
-|   DATE:       Feb 15, 2018
+|   DATE:       Oct 18, 2026
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       High level function to run the server. Sets up the server and
-|               the SIGINT interupt handler and then runs the accept loop that
-|               listens for incoming connections.
+|   DESC:       Gives a new connection to a parked thread. 'idle' only counts
+|               parked threads that have not been promised a connection yet, so
+|               every queued connection is guaranteed a thread.
 ------------------------------------------------------------------------------*/
-int run_srv(struct srv_nw_var *nw)
+int cache_handoff(struct srv_conn *conn)
 {
-    if(setup_srv(nw) == -1)
+    pthread_mutex_lock(&cache.lock);
+    if(cache.idle == 0)
+    {
+        pthread_mutex_unlock(&cache.lock);
         return -1;
+    }
 
-    if(set_SIGINT() == -1)
-        return -1;
-
-    if(run_accept_loop(*nw) == -1)
-        return -1;
+    conn->next = cache.head;
+    cache.head = conn;
+    cache.idle--;
+    cache.reused++;
+    pthread_cond_signal(&cache.handoff);
+    pthread_mutex_unlock(&cache.lock);
 
     return 0;
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   int setup_srv(struct srv_nw_var *nw)
-|                   *nw : pointer to clients network variables
+|   FUNCTION:   void cache_enter(struct cache_thread *self)
+|                   *self : calling thread's slot, holding its first connection
 |
-|   RETURN:     0 on success, -1 on failure
+|   RETURN:     void
 |
-|   DATE:       Feb 15, 2018
+|   DATE:       Oct 18, 2026
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       High level function to setup the server. Uses the networking
-|               related variables held in '*nw' to:
-|                   - create a socket
-|                   - set socket option to reuse address
-|                   - bind socket
-|                   - set socket to listen
+|   DESC:       Links a new connection thread into the cache so cache_stop()
+|               can reach the connection it serves. A thread that starts after
+|               the stop sweep shuts its own connection down.
 ------------------------------------------------------------------------------*/
-int setup_srv(struct srv_nw_var *nw)
+void cache_enter(struct cache_thread *self)
 {
-    int _optval = 1;
-
-    if(create_socket(&(nw->sd_listen), AF_INET, SOCK_STREAM, 0) == -1)
-        return -1;
-
-    bzero((char *)&(nw->srv_addr), sizeof(struct sockaddr_in));
-    fill_addr(&(nw->srv_addr), AF_INET, htons(nw->port), htonl(INADDR_ANY));
-
-    setsockopt(nw->sd_listen, SOL_SOCKET, SO_REUSEADDR, &_optval, sizeof(_optval));
-
-    if(bind_socket(nw->sd_listen, (struct sockaddr *)&(nw->srv_addr), sizeof(nw->srv_addr)) == -1)
-        return -1;
-
-    if(listen_socket(nw->sd_listen, BACKLOG) == -1)
-        return -1;
-
-    return 0;
+    pthread_mutex_lock(&cache.lock);
+    self->prev = NULL;
+    self->next = cache.threads;
+    if(cache.threads != NULL)
+        cache.threads->prev = self;
+    cache.threads = self;
+    if(cache.quit)
+        shutdown(self->conn->sd, SHUT_RDWR);
+    pthread_mutex_unlock(&cache.lock);
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   int run_accept_loop(struct srv_nw_var nw)
-|                   nw : clients network variables
+|   FUNCTION:   struct srv_conn *cache_park(struct cache_thread *self, int max)
+|                   *self : calling thread's slot
+|                   max   : most threads allowed to park
 |
-|   RETURN:     0 on success, -1 on failure
+|   RETURN:     next connection to service, NULL if the thread should exit
 |
-|   DATE:       Feb 15, 2018
+|   DATE:       Oct 18, 2026
 |
 |   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Function that accepts client connections. Once a connection
-|               has been established the function will then create a new thread
-|               in order to accomodate the new connection.
+|   DESC:       Called by a connection thread once its client is gone. Closes
+|               the connection, then parks the thread until the acceptor hands
+|               it another one. Returns NULL straight away when the cache is
+|               already full, and once the server stops; the thread is then
+|               unlinked and the last one out wakes cache_stop().
 ------------------------------------------------------------------------------*/
-int run_accept_loop(struct srv_nw_var nw)
+struct srv_conn *cache_park(struct cache_thread *self, int max)
 {
-    int _sd;
-    struct sockaddr_in _clt_addr;
-    struct thread_args *_args;
-    socklen_t _clt_addr_len;
-    pthread_t _threads[THREADS];
+    struct srv_conn *_conn = self->conn;
+    int _parked = 0;
 
-    _clt_addr_len = sizeof(_clt_addr);
+    // unpublish before freeing it, cache_stop() may be shutting it down
+    pthread_mutex_lock(&cache.lock);
+    self->conn = NULL;
+    pthread_mutex_unlock(&cache.lock);
+    conn_close(_conn);
 
-    // loop on accept
-    for(int i = 0; i < THREADS; i++)
+    pthread_mutex_lock(&cache.lock);
+    if(cache.idle < max && !cache.quit)
     {
-        bzero((char *)&(_clt_addr), sizeof(struct sockaddr_in));
-        if((_sd = accept(nw.sd_listen, (struct sockaddr *)&_clt_addr, &_clt_addr_len)) == -1)
-        {
-            printf("\tError accepting connection\n");
-            printf("\tError code: %s\n\n", strerror(errno));
-            close(nw.sd_listen);
-            return -1;
-        }
-
-        total_clts++;
-
-        // setup thread args
-        _args = (struct thread_args *)malloc(sizeof *_args);
-        _args->sd = _sd;
-        strcpy(_args->clt_ip, inet_ntoa(_clt_addr.sin_addr));
-
-        // accomodate client connection in seperate thread
-        if(pthread_create(&_threads[i], NULL, echo_loop, _args) != 0)
-        {
-            printf("\n\tError creating thread\n");
-            printf("\tError code: %s\n\n", strerror(errno));
-            close(nw.sd_listen);
-            return -1;
-        }
-        if(pthread_detach(_threads[i]) != 0)
-        {
-            printf("\n\tError joining thread\n");
-            printf("\tError code: %s\n\n", strerror(errno));
-            close(nw.sd_listen);
-            return -1;
-        }
+        cache.idle++;
+        _parked = 1;
+        while(cache.head == NULL && !cache.quit)
+            pthread_cond_wait(&cache.handoff, &cache.lock);
+    }
 
-        printf("- Client connected: %s\n",  inet_ntoa(_clt_addr.sin_addr));
+    if(!_parked || cache.quit)  // cache full or server stopping
+    {
+        if(self->prev != NULL)
+            self->prev->next = self->next;
+        else
+            cache.threads = self->next;
+        if(self->next != NULL)
+            self->next->prev = self->prev;
+        cache.live--;
+        pthread_cond_broadcast(&cache.gone);
+        pthread_mutex_unlock(&cache.lock);
+        return NULL;
     }
 
-    return 0;
+    self->conn = cache.head;
+    cache.head = self->conn->next;
+    pthread_mutex_unlock(&cache.lock);
+
+    return self->conn;
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   int set_SIGINT()
+|   FUNCTION:   void cache_stop()
 |
-|   RETURN:     0 on success, -1 on failure
+|   RETURN:     void
 |
-|   DATE:       Feb 20, 2018
+|   DATE:       Oct 18, 2026
 |
-|   AUTHOR:     Aman Abulla
+|   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Function to set up SIGINT interupt handler
+|   DESC:       Called by the acceptor once it stops. Closes connections handed
+|               over but not yet picked up, wakes the parked threads so they
+|               exit, shuts down the connections being served so their recv
+|               returns, and waits until every connection thread has left.
 ------------------------------------------------------------------------------*/
-int set_SIGINT()
+void cache_stop()
 {
-    struct sigaction act;
-    act.sa_handler = close_fd;
-    act.sa_flags = 0;
+    struct srv_conn *_conn;
 
-    if ((sigemptyset (&act.sa_mask) == -1 || sigaction (SIGINT, &act, NULL) == -1))
+    pthread_mutex_lock(&cache.lock);
+    cache.quit = 1;
+    while((_conn = cache.head) != NULL)
     {
-            printf("\n\tFailed to set SIGINT handler\n");
-            return -1;
+        cache.head = _conn->next;
+        conn_close(_conn);
     }
-
-    return 0;
+    for(struct cache_thread *_t = cache.threads; _t != NULL; _t = _t->next)
+        if(_t->conn != NULL)
+            shutdown(_t->conn->sd, SHUT_RDWR);
+    pthread_cond_broadcast(&cache.handoff);
+
+    while(cache.live > 0)
+        pthread_cond_wait(&cache.gone, &cache.lock);
+    pthread_mutex_unlock(&cache.lock);
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   void *echo_loop(void *sd)
+|   FUNCTION:   void report_threads(const struct srv_config *cfg,
+|                                   uint64_t elapsed_ns, long base_rss,
+|                                   long peak_rss)
+|                   *cfg       : runtime options
+|                   elapsed_ns : length of the run
+|                   base_rss   : RSS before the first thread (bytes)
+|                   peak_rss   : largest RSS seen (bytes)
 |
 |   RETURN:     void
 |
-|   DATE:       Feb 19, 2018
+|   DATE:       Oct 18, 2026
 |
-|   AUTHOR:     Alex Zielinsii
+|   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Function that is passed to a thread. This function accomadates
-|               a new connection. It reads data coming from client and echos it
-|               back. The function terminates once the client has finished
-|               sending data and has disconnected.
+|   DESC:       Prints how many threads were created and how fast, how many
+|               connections reused a cached thread and what the threads cost
+|               in resident memory.
 ------------------------------------------------------------------------------*/
-void *echo_loop(void *args)
+void report_threads(const struct srv_config *cfg, uint64_t elapsed_ns, long base_rss, long peak_rss)
 {
-    struct thread_args *_args = (struct thread_args *)args; // get function args
-    struct srv_log_stats _stats;
-    char _recv_buff[PKTSIZE];
-    int _bytes_recv;
-    int _bytes_sent;
-    time_t t = time(NULL);
-
-    // setup stats struct
-    _stats.requests = 0;
-    _stats.tm = *localtime(&t);     // time of new connection
-    strcpy(_stats.clt_ip, _args->clt_ip);
-    init_bytes_struct(&(_stats.bytes));
-
-    // echo loop
-    while(1)
-    {
-        // read socket
-        _bytes_recv = recv(_args->sd, _recv_buff, PKTSIZE, MSG_WAITALL);
-        if(_bytes_recv == -1)
-        {
-            printf("\tError reading\n");
-            printf("\tError code: %s\n\n", strerror(errno));
-            break;
-        }
-        if(_bytes_recv == 0) // client disconnected
-        {
-            printf("- Client disconnected: %s\n", _args->clt_ip);
-            close(_args->sd);
-            break;
-        }
-        else    // successfully read socket
-        {
-            _stats.requests++;   // update client requests
-
-            // write to socket (echo)
-            _bytes_sent = send(_args->sd, _recv_buff, PKTSIZE, 0);
-            if(_bytes_sent == -1)
-            {
-                printf("\tError sending\n");
-                printf("\tError code: %s\n\n", strerror(errno));
-                printf("\nsent %d bytes\n", _bytes_sent);
-                break;
-            }
-            update_bytes_struct(&_stats.bytes, _bytes_sent);
-            bzero(_recv_buff, sizeof(_recv_buff));
-        }
-    }
-
-    append_srv_data(SRVLOGFILE, _stats);    // write to log file
-
-    free(_args);
-    close(_args->sd);
-    pthread_exit(NULL);
-    return NULL;
+    double _secs = elapsed_ns / 1e9;
+    long _conns;
+
+    pthread_mutex_lock(&cache.lock);
+    _conns = cache.created + cache.reused;
+    printf("\nThreads (stack %d KB, guard %d KB, cache %d)\n", cfg->stack_kb, cfg->guard_kb, cfg->thread_cache);
+    printf("- Created %ld threads (%.1f/sec, %.1f us per pthread_create)\n", cache.created,
+           _secs > 0 ? cache.created / _secs : 0.0,
+           cache.created > 0 ? cache.create_ns / 1e3 / cache.created : 0.0);
+    printf("- Reused a cached thread for %ld of %ld connections (%.1f%%)\n", cache.reused, _conns,
+           _conns > 0 ? 100.0 * cache.reused / _conns : 0.0);
+    printf("- Peak threads %d, peak RSS %.1f MB (%.1f KB per thread over the %.1f MB base)\n",
+           cache.peak, peak_rss / 1048576.0,
+           cache.peak > 0 ? (peak_rss - base_rss) / 1024.0 / cache.peak : 0.0, base_rss / 1048576.0);
+    pthread_mutex_unlock(&cache.lock);
 }
 
 
 /*------------------------------------------------------------------------------
-|   FUNCTION:   void close_fd()
+|   FUNCTION:   void *echo_loop(void *args)
+|                   *args : connection to accomodate
 |
 |   RETURN:     void
 |
-|   DATE:       Feb 20, 2018
+|   DATE:       Feb 19, 2018
 |
-|   AUTHOR:     Aman Abdulla, Alex Zielinski
+|   AUTHOR:     Alex Zielinski
 |
-|   DESC:       Function to execute when SIGINT signal is encountered.
-|               Terminates server's listening socket
+|   DESC:       Function that is passed to a thread. This function accomadates
+|               a new connection. The socket is blocking so the connection core
+|               reads and echos requests until the client has finished sending
+|               data and has disconnected. The thread then parks in the thread
+|               cache and serves the next connection it is handed, exiting only
+|               when the cache is full or the server stops.
 ------------------------------------------------------------------------------*/
-void close_fd()
+void *echo_loop(void *args)
 {
-    printf("\n\n- Terminating\n");
-    close(nw_var.sd_listen);
+    struct cache_thread _self = {(struct srv_conn *)args, NULL, NULL};
 
-    append_total_clients(SRVLOGFILE, total_clts);
+    block_SIGINT();
+    cache_enter(&_self);
+    do
+        conn_service(_self.conn);
+    while(cache_park(&_self, cache_max) != NULL);
+
+    pthread_exit(NULL);
+    return NULL;
 }
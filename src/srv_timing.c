@@ -0,0 +1,236 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     srv_timing.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that times requests inside the server. One request in
+|               every 'sample' is stamped with the monotonic clock when the
+|               backend hands its connection to the core, when the frame has
+|               been received, when the handler is done and when the response
+|               has been sent, so server time can be told apart from time
+|               spent in the network stack.
+|
+|               Every thread records into its own slot of histograms, created
+|               on its first sampled request (see perthread.c). Slots of
+|               exiting threads (the thread backend has one per connection)
+|               are folded into a retired total.
+------------------------------------------------------------------------------*/
+#include "../include/srv_timing.h"
+#include <string.h>
+
+/* --- Global ---- */
+static int timing_every = 0;                    // sample 1 in N requests (0 = off)
+static struct slot_reg timing_slots = SLOTS_INITIALIZER;
+static struct hist timing_retired[STAGE_COUNT]; // merged slots of exited threads
+static __thread void *timing_mine = NULL;
+static __thread unsigned int timing_count = 0;
+
+static void timing_slot_init(void *arg);
+static void timing_retire(void *arg);
+
+static const char *stage_names[STAGE_COUNT] =
+{
+    "dequeue -> recv",
+    "recv -> handler",
+    "handler -> send",
+    "total"
+};
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int timing_init(int sample)
+|                   sample : time 1 in 'sample' requests, 0 to disable
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Sets the sampling rate and sets up the registry of the
+|               threads' slots.
+------------------------------------------------------------------------------*/
+int timing_init(int sample)
+{
+    timing_every = sample;
+    if(sample == 0)
+        return 0;
+
+    for(int i = 0; i < STAGE_COUNT; i++)
+        hist_init(&timing_retired[i]);
+
+    if(slots_init(&timing_slots, sizeof(struct timing_slot), timing_slot_init, timing_retire) == -1)
+    {
+        printf("\tError creating timing key\n");
+        timing_every = 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int timing_sample()
+|
+|   RETURN:     1 if the request about to start should be timed, otherwise 0
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Per-thread 1-in-N counter, so unsampled requests cost one
+|               increment and no clock reads.
+------------------------------------------------------------------------------*/
+int timing_sample()
+{
+    if(timing_every == 0)
+        return 0;
+
+    if(++timing_count < (unsigned int)timing_every)
+        return 0;
+
+    timing_count = 0;
+    return 1;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void timing_record(uint64_t t_ready, uint64_t t_recv,
+|                                  uint64_t t_handler, uint64_t t_send)
+|                   t_ready   : connection handed to the core
+|                   t_recv    : complete frame received
+|                   t_handler : work and handler done
+|                   t_send    : response sent
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Adds one sampled request to the calling thread's histograms.
+------------------------------------------------------------------------------*/
+void timing_record(uint64_t t_ready, uint64_t t_recv, uint64_t t_handler, uint64_t t_send)
+{
+    struct timing_slot *_slot;
+
+    if((_slot = slots_get(&timing_slots, &timing_mine)) == NULL)
+        return;
+
+    pthread_mutex_lock(&_slot->lock);
+    hist_add(&_slot->stage[STAGE_RECV], t_recv - t_ready);
+    hist_add(&_slot->stage[STAGE_HANDLER], t_handler - t_recv);
+    hist_add(&_slot->stage[STAGE_SEND], t_send - t_handler);
+    hist_add(&_slot->stage[STAGE_TOTAL], t_send - t_ready);
+    pthread_mutex_unlock(&_slot->lock);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void timing_merge(struct hist *stage)
+|                   *stage : STAGE_COUNT histograms to merge into
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Merges the retired total and every live slot into 'stage'. Safe
+|               to call while the server is running.
+------------------------------------------------------------------------------*/
+void timing_merge(struct hist *stage)
+{
+    struct timing_slot *_s;
+
+    pthread_mutex_lock(&timing_slots.lock);
+    for(int i = 0; i < STAGE_COUNT; i++)
+        hist_merge(&stage[i], &timing_retired[i]);
+
+    for(struct slot_link *l = timing_slots.live; l != NULL; l = l->next)
+    {
+        _s = (struct timing_slot *)l;
+        pthread_mutex_lock(&_s->lock);
+        for(int i = 0; i < STAGE_COUNT; i++)
+            hist_merge(&stage[i], &_s->stage[i]);
+        pthread_mutex_unlock(&_s->lock);
+    }
+    pthread_mutex_unlock(&timing_slots.lock);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void timing_report(FILE *out)
+|                   *out : stream to print to
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Prints the merged per stage latency of the sampled requests.
+------------------------------------------------------------------------------*/
+void timing_report(FILE *out)
+{
+    struct hist _stage[STAGE_COUNT];
+
+    if(timing_every == 0)
+        return;
+
+    for(int i = 0; i < STAGE_COUNT; i++)
+        hist_init(&_stage[i]);
+    timing_merge(_stage);
+
+    fprintf(out, "\nRequest timing (1 in %d sampled)\n", timing_every);
+    for(int i = 0; i < STAGE_COUNT; i++)
+        hist_print(out, stage_names[i], &_stage[i], 0);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   static void timing_slot_init(void *arg)
+|                   *arg : new slot of the calling thread
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Sets up a slot created by the registry on the thread's first
+|               sampled request.
+------------------------------------------------------------------------------*/
+static void timing_slot_init(void *arg)
+{
+    struct timing_slot *_slot = arg;
+
+    pthread_mutex_init(&_slot->lock, NULL);
+    for(int i = 0; i < STAGE_COUNT; i++)
+        hist_init(&_slot->stage[i]);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   static void timing_retire(void *arg)
+|                   *arg : slot of the exiting thread
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Called by the registry, with its lock held, when a thread
+|               exits: folds the slot into the retired total. The registry
+|               unlinks and frees it.
+------------------------------------------------------------------------------*/
+static void timing_retire(void *arg)
+{
+    struct timing_slot *_slot = arg;
+
+    for(int i = 0; i < STAGE_COUNT; i++)
+        hist_merge(&timing_retired[i], &_slot->stage[i]);
+    pthread_mutex_destroy(&_slot->lock);
+}
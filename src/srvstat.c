@@ -0,0 +1,398 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     srvstat.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Live viewer of a running server. Maps the server's stats page
+|               (/dev/shm/srv_<pid>, see shmstat.c) read only and redraws a
+|               top like screen every refresh: connections, requests and
+|               bytes with their rates, the latency percentiles of the
+|               requests sampled since the last screen, and a line per
+|               server thread with its requests and event loop wake ups.
+|               Reading the page costs the server nothing; no syscall or
+|               socket is involved on its side.
+|
+|                   Usage: ./srvstat [-d MS] [-n COUNT] [PID]
+|
+|               Without a PID the only running server is picked. -d sets the
+|               refresh period (default 1000 ms) and -n stops after COUNT
+|               screens. The viewer exits once the server has exited. When
+|               the output is not a terminal the screens are printed one
+|               after the other instead of redrawn.
+------------------------------------------------------------------------------*/
+#include "../include/srvstat.h"
+#include "../include/hist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+
+/*==============================================================================
+|   FUNCTION:   int main(int argc, char **argv)
+|                   argc   : number of cmd args
+|                   **argv : array of args
+|
+|   RETURN:     0 on success, 1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Main entry point of the program.
+==============================================================================*/
+int main(int argc, char **argv)
+{
+    const struct shmstat_page *_page;
+    struct shmstat_data *_cur, *_prev, *_swap;
+    struct timespec _ts;
+    int _refresh = DEFREFRESH;
+    long _count = -1;
+    int _pid, _opt;
+
+    while((_opt = getopt(argc, argv, "d:n:h")) != -1)
+    {
+        switch(_opt)
+        {
+            case 'd':
+                if((_refresh = atoi(optarg)) < 1)
+                {
+                    printf("\nError: Invalid refresh period: %s.\n\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'n':
+                if((_count = atol(optarg)) < 1)
+                {
+                    printf("\nError: Invalid number of screens: %s.\n\n", optarg);
+                    return 1;
+                }
+                break;
+            default:
+                print_usage();
+                return 1;
+        }
+    }
+
+    if(optind < argc - 1)
+    {
+        print_usage();
+        return 1;
+    }
+
+    if(optind == argc - 1)
+        _pid = atoi(argv[optind]);
+    else if((_pid = find_server()) == -1)
+        return 1;
+
+    if((_page = map_page(_pid)) == NULL)
+        return 1;
+
+    _cur = calloc(1, sizeof(*_cur));
+    _prev = calloc(1, sizeof(*_prev));
+    if(_cur == NULL || _prev == NULL)
+    {
+        printf("\tError allocating stats\n");
+        return 1;
+    }
+
+    _ts.tv_sec = _refresh / 1000;
+    _ts.tv_nsec = (_refresh % 1000) * 1000000L;
+
+    for(long i = 0; _count < 0 || i < _count; i++)
+    {
+        if(read_page(_page, _cur) == -1)
+        {
+            printf("\tError reading stats page: no consistent update\n");
+            return 1;
+        }
+
+        render(_page, _cur, i > 0 ? _prev : NULL);
+        if(!page_exists(_pid))
+        {
+            printf("\n- Server %d exited\n", _pid);
+            break;
+        }
+
+        _swap = _prev;
+        _prev = _cur;
+        _cur = _swap;
+        if(_count < 0 || i + 1 < _count)
+            nanosleep(&_ts, NULL);
+    }
+
+    free(_cur);
+    free(_prev);
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int find_server()
+|
+|   RETURN:     pid of the only running server, -1 if there are none or many
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Looks for stats pages of live processes. Pages left behind by
+|               a server that was killed are skipped. With several servers
+|               running they are listed and one must be picked.
+------------------------------------------------------------------------------*/
+int find_server()
+{
+    int _pids[MAXSERVERS];
+    struct dirent *_ent;
+    DIR *_dir;
+    int _n = 0, _pid;
+
+    if((_dir = opendir(SHMSTAT_DIR)) == NULL)
+    {
+        printf("\tError opening %s\n", SHMSTAT_DIR);
+        printf("\tError code: %s\n\n", strerror(errno));
+        return -1;
+    }
+
+    while((_ent = readdir(_dir)) != NULL && _n < MAXSERVERS)
+    {
+        if(strncmp(_ent->d_name, SHMSTAT_PREFIX, strlen(SHMSTAT_PREFIX)) != 0)
+            continue;
+        if((_pid = atoi(_ent->d_name + strlen(SHMSTAT_PREFIX))) <= 0)
+            continue;
+        if(kill(_pid, 0) == -1 && errno == ESRCH)
+            continue;   // stale page of a killed server
+        _pids[_n++] = _pid;
+    }
+    closedir(_dir);
+
+    if(_n == 1)
+        return _pids[0];
+
+    if(_n == 0)
+        printf("\nError: No running server found in %s.\n\n", SHMSTAT_DIR);
+    else
+    {
+        printf("\nError: Several servers running, pick one:");
+        for(int i = 0; i < _n; i++)
+            printf(" %d", _pids[i]);
+        printf("\n\n");
+    }
+    return -1;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   const struct shmstat_page *map_page(int pid)
+|                   pid : server process
+|
+|   RETURN:     the mapped page, NULL on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Maps the server's page read only and checks that it has the
+|               layout this viewer was built against.
+------------------------------------------------------------------------------*/
+const struct shmstat_page *map_page(int pid)
+{
+    const struct shmstat_page *_page;
+    char _name[SHMSTAT_NAMESIZE];
+    int _fd;
+
+    snprintf(_name, sizeof(_name), SHMSTAT_NAME, pid);
+    if((_fd = shm_open(_name, O_RDONLY, 0)) == -1)
+    {
+        printf("\tError opening stats page %s%s\n", SHMSTAT_DIR, _name);
+        printf("\tError code: %s\n\n", strerror(errno));
+        return NULL;
+    }
+
+    _page = mmap(NULL, sizeof(*_page), PROT_READ, MAP_SHARED, _fd, 0);
+    close(_fd);
+    if(_page == MAP_FAILED)
+    {
+        printf("\tError mapping stats page %s%s\n", SHMSTAT_DIR, _name);
+        printf("\tError code: %s\n\n", strerror(errno));
+        return NULL;
+    }
+
+    if(_page->magic != SHMSTAT_MAGIC || _page->version != SHMSTAT_VERSION
+       || _page->size != sizeof(*_page))
+    {
+        printf("\nError: %s%s is not a version %d stats page.\n\n", SHMSTAT_DIR, _name, SHMSTAT_VERSION);
+        munmap((void *)_page, sizeof(*_page));
+        return NULL;
+    }
+
+    return _page;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int read_page(const struct shmstat_page *page,
+|                             struct shmstat_data *data)
+|                   *page : mapped stats page
+|                   *data : set to a consistent copy of the page's data
+|
+|   RETURN:     0 on success, -1 if no consistent copy could be taken
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Reader side of the seqlock: the copy is good if the sequence
+|               was even before it and unchanged after it. An update only
+|               lasts one copy, so retries are rare and short.
+------------------------------------------------------------------------------*/
+int read_page(const struct shmstat_page *page, struct shmstat_data *data)
+{
+    uint64_t _seq;
+
+    for(int i = 0; i < READ_TRIES; i++)
+    {
+        if((_seq = __atomic_load_n(&page->seq, __ATOMIC_ACQUIRE)) & 1)
+            continue;   // being written
+
+        memcpy(data, (const void *)&page->data, sizeof(*data));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&page->seq, __ATOMIC_RELAXED) == _seq)
+            return 0;
+    }
+
+    return -1;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int page_exists(int pid)
+|                   pid : server process
+|
+|   RETURN:     1 while the server's page is still published, 0 once gone
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       The server removes its page on exit; a killed server leaves
+|               it, so the process is checked too.
+------------------------------------------------------------------------------*/
+int page_exists(int pid)
+{
+    char _path[SHMSTAT_NAMESIZE + sizeof(SHMSTAT_DIR)];
+
+    snprintf(_path, sizeof(_path), SHMSTAT_DIR SHMSTAT_NAME, pid);
+    if(access(_path, F_OK) == -1)
+        return 0;
+
+    return !(kill(pid, 0) == -1 && errno == ESRCH);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void render(const struct shmstat_page *page,
+|                           const struct shmstat_data *cur,
+|                           const struct shmstat_data *prev)
+|                   *page : mapped stats page (header)
+|                   *cur  : latest data
+|                   *prev : data of the last screen, NULL on the first
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Draws one screen. Rates and latency percentiles cover the
+|               time between the two updates compared (the whole run on the
+|               first screen). Threads are matched to their previous line by
+|               id; EV/LOOP is the mean number of events per wake up.
+------------------------------------------------------------------------------*/
+void render(const struct shmstat_page *page, const struct shmstat_data *cur,
+            const struct shmstat_data *prev)
+{
+    static struct hist _lat;
+    const struct shmstat_thread *_t, *_p;
+    uint64_t _since = prev != NULL ? prev->t_update : page->t_start;
+    double _secs = (cur->t_update - _since) / 1e9;
+    double _up = (cur->t_update - page->t_start) / 1e9;
+
+    if(_secs <= 0)
+        _secs = 1e-9;
+
+    // latency of the requests sampled since the last screen
+    hist_init(&_lat);
+    for(int i = 0; i < HIST_BUCKETS; i++)
+        _lat.buckets[i] = cur->lat[i] - (prev != NULL ? prev->lat[i] : 0);
+    _lat.count = cur->lat_count - (prev != NULL ? prev->lat_count : 0);
+    _lat.min = 0;
+    _lat.max = UINT64_MAX;
+
+    if(isatty(STDOUT_FILENO))
+        printf("\033[H\033[2J");
+    else if(prev != NULL)
+        printf("\n");
+
+    printf("srv %d (%s)   up %02d:%02d:%02d   updated %.0f ms ago\n\n", page->pid, page->backend,
+           (int)(_up / 3600), (int)(_up / 60) % 60, (int)_up % 60, (now_ns() - cur->t_update) / 1e6);
+    printf("Connections: %lld open, %lld accepted, %.1f/s\n", (long long)cur->live,
+           (long long)cur->total, (cur->total - (prev != NULL ? prev->total : 0)) / _secs);
+    printf("Requests:    %llu, %.1f/s\n", (unsigned long long)cur->requests,
+           (cur->requests - (prev != NULL ? prev->requests : 0)) / _secs);
+    printf("Bytes:       %.1f MB, %.2f MB/s\n", cur->bytes / 1e6,
+           (cur->bytes - (prev != NULL ? prev->bytes : 0)) / _secs / 1e6);
+    printf("Loops:       %llu, %.1f/s\n", (unsigned long long)cur->loops,
+           (cur->loops - (prev != NULL ? prev->loops : 0)) / _secs);
+    if(_lat.count > 0)
+        printf("Latency:     %llu sampled, p50 %.1f p90 %.1f p99 %.1f p99.9 %.1f us\n",
+               (unsigned long long)_lat.count, hist_percentile(&_lat, 50) / 1e3,
+               hist_percentile(&_lat, 90) / 1e3, hist_percentile(&_lat, 99) / 1e3,
+               hist_percentile(&_lat, 99.9) / 1e3);
+    else
+        printf("Latency:     no requests sampled\n");
+
+    printf("\nThreads: %d", cur->nthreads);
+    if(cur->shown < cur->nthreads)
+        printf(" (newest %d shown)", cur->shown);
+    printf("\n%8s %14s %12s %14s %12s %8s\n", "THREAD", "REQUESTS", "REQ/S", "LOOPS", "LOOPS/S", "EV/LOOP");
+    for(int i = 0; i < cur->shown; i++)
+    {
+        _t = &cur->thread[i];
+        _p = NULL;
+        for(int j = 0; prev != NULL && j < prev->shown && _p == NULL; j++)
+            if(prev->thread[j].id == _t->id)
+                _p = &prev->thread[j];
+
+        printf("%8d %14llu %12.1f %14llu %12.1f %8.2f\n", _t->id,
+               (unsigned long long)_t->requests, (_t->requests - (_p != NULL ? _p->requests : 0)) / _secs,
+               (unsigned long long)_t->loops, (_t->loops - (_p != NULL ? _p->loops : 0)) / _secs,
+               _t->loops > 0 ? (double)_t->events / _t->loops : 0.0);
+    }
+    fflush(stdout);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void print_usage()
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Prints the usage message.
+------------------------------------------------------------------------------*/
+void print_usage()
+{
+    printf("\nUsage: ./srvstat [-d MS] [-n COUNT] [PID]\n\n");
+    printf("  -d MS     refresh period (default %d)\n", DEFREFRESH);
+    printf("  -n COUNT  stop after COUNT screens\n");
+    printf("  PID       server to watch (default: the only one running)\n\n");
+}
@@ -0,0 +1,174 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     timer.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that provides the timers of an event loop: a binary
+|               min-heap ordered by expiry. The loop sleeps no longer than the
+|               earliest timer (timer_timeout) and after every wakeup pops the
+|               timers that are due. Timers are not cancellable; whoever sets
+|               one must keep its target alive until it fires.
+------------------------------------------------------------------------------*/
+#include "../include/timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int timer_init(struct timer_heap *h)
+|                   *h : heap to initialize
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Allocates an empty heap.
+------------------------------------------------------------------------------*/
+int timer_init(struct timer_heap *h)
+{
+    h->size = 0;
+    h->cap = TIMERINITSIZE;
+    if((h->ents = malloc(h->cap * sizeof *h->ents)) == NULL)
+    {
+        printf("\tError allocating timer heap\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int timer_add(struct timer_heap *h, uint64_t when, void *ptr)
+|                   *h   : heap
+|                   when : expiry (now_ns clock)
+|                   *ptr : returned by timer_pop_due once expired
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Inserts a timer and sifts it up to its place.
+------------------------------------------------------------------------------*/
+int timer_add(struct timer_heap *h, uint64_t when, void *ptr)
+{
+    struct timer_ent *_ents;
+    int _i, _parent;
+
+    if(h->size == h->cap)
+    {
+        if((_ents = realloc(h->ents, 2 * h->cap * sizeof *_ents)) == NULL)
+            return -1;
+        h->ents = _ents;
+        h->cap *= 2;
+    }
+
+    for(_i = h->size++; _i > 0; _i = _parent)
+    {
+        _parent = (_i - 1) / 2;
+        if(h->ents[_parent].when <= when)
+            break;
+        h->ents[_i] = h->ents[_parent];
+    }
+    h->ents[_i].when = when;
+    h->ents[_i].ptr = ptr;
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void *timer_pop_due(struct timer_heap *h, uint64_t now)
+|                   *h  : heap
+|                   now : current time (now_ns clock)
+|
+|   RETURN:     target of the earliest expired timer, NULL if none is due
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Removes the earliest timer if it has expired, moving the last
+|               entry to the root and sifting it down.
+------------------------------------------------------------------------------*/
+void *timer_pop_due(struct timer_heap *h, uint64_t now)
+{
+    struct timer_ent _last;
+    void *_ptr;
+    int _i = 0, _child;
+
+    if(h->size == 0 || h->ents[0].when > now)
+        return NULL;
+
+    _ptr = h->ents[0].ptr;
+    _last = h->ents[--h->size];
+
+    while((_child = 2 * _i + 1) < h->size)
+    {
+        if(_child + 1 < h->size && h->ents[_child + 1].when < h->ents[_child].when)
+            _child++;
+        if(_last.when <= h->ents[_child].when)
+            break;
+        h->ents[_i] = h->ents[_child];
+        _i = _child;
+    }
+    if(h->size > 0)
+        h->ents[_i] = _last;
+
+    return _ptr;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int timer_timeout(struct timer_heap *h, uint64_t now, int timeout)
+|                   *h      : heap
+|                   now     : current time (now_ns clock)
+|                   timeout : loop's own timeout in ms (-1 = none)
+|
+|   RETURN:     ms the loop may sleep
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Shortens the loop's timeout to the earliest timer, rounding up
+|               so the loop doesn't wake just before it.
+------------------------------------------------------------------------------*/
+int timer_timeout(struct timer_heap *h, uint64_t now, int timeout)
+{
+    uint64_t _ms;
+
+    if(h->size == 0)
+        return timeout;
+
+    _ms = h->ents[0].when > now ? (h->ents[0].when - now + 999999) / 1000000 : 0;
+    if(timeout < 0 || _ms < (uint64_t)timeout)
+        return (int)_ms;
+
+    return timeout;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void timer_free(struct timer_heap *h)
+|                   *h : heap to free
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Releases the heap. Pending timers are dropped.
+------------------------------------------------------------------------------*/
+void timer_free(struct timer_heap *h)
+{
+    free(h->ents);
+    h->ents = NULL;
+    h->size = 0;
+    h->cap = 0;
+}
@@ -0,0 +1,304 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     trace.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that records a timeline of what the server threads do.
+|               Every thread writes compact events (loop sleep/wakeup, accept,
+|               recv, send, close, log writes) into its own ring with no locks:
+|               the owner is the only writer and publishes each event by
+|               bumping the ring's head. Old events are overwritten once a ring
+|               is full, so the trace always holds the most recent history.
+|
+|               The rings are dumped as Chrome trace-event JSON (open it in
+|               chrome://tracing or Perfetto) when the server gets SIGUSR1 and
+|               when it exits. A reader copies a ring and then drops whatever
+|               the writer may have overwritten meanwhile, so dumping never
+|               stops the writers.
+|
+|               Rings of exited threads are kept for the dump and handed to
+|               new threads, which keeps the thread backend (one thread per
+|               connection) bounded.
+------------------------------------------------------------------------------*/
+#include "../include/trace.h"
+#include "../include/hist.h"
+#include "../include/perthread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/* --- Global ---- */
+int trace_on = 0;
+static uint64_t trace_t0;                       // time tracing started
+static const char *trace_path;                  // file dumps are written to
+static pthread_key_t trace_key;                 // owner of each thread's ring
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct trace_ring *trace_all = NULL;     // every ring allocated
+static struct trace_ring *trace_free = NULL;    // rings of exited threads
+static int trace_nrings = 0;
+static uint16_t trace_next_tid = 0;
+static __thread struct trace_ring *trace_mine = NULL;
+static __thread uint16_t trace_tid;
+static __thread int trace_none = 0;             // 1 once no ring was available
+
+static const char *trace_names[TR_TYPES] =
+{
+    "wait", "wait", "accept", "recv", "send", "close", "log", "log"
+};
+
+static struct trace_ring *trace_ring_get();
+static void trace_release(void *arg);
+static void *trace_dumper(void *arg);
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int trace_init(const char *path)
+|                   *path : file the Chrome trace is written to
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Enables tracing. SIGUSR1 is blocked in the calling thread, so
+|               it must run before any other server thread is created (they
+|               inherit the mask); a dumper thread then takes SIGUSR1 with
+|               sigwait() and writes the trace from normal thread context.
+|               The dumper is a helper thread (SIGINT blocked as well).
+------------------------------------------------------------------------------*/
+int trace_init(const char *path)
+{
+    sigset_t _set;
+
+    if(pthread_key_create(&trace_key, trace_release) != 0)
+    {
+        printf("\tError creating trace key\n");
+        return -1;
+    }
+
+    sigemptyset(&_set);
+    sigaddset(&_set, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &_set, NULL);
+
+    if(spawn_helper_thread(NULL, trace_dumper) == -1)
+    {
+        printf("\tError creating trace dumper thread\n");
+        return -1;
+    }
+
+    trace_path = path;
+    trace_t0 = now_ns();
+    trace_on = 1;
+    printf("- Tracing to %s (kill -USR1 %d to dump)\n", path, (int)getpid());
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void trace_event(int type, uint32_t arg)
+|                   type : enum trace_type
+|                   arg  : event argument
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Appends an event to the calling thread's ring. Called through
+|               the TRACE() macro.
+------------------------------------------------------------------------------*/
+void trace_event(int type, uint32_t arg)
+{
+    struct trace_ring *_ring = trace_mine;
+    struct trace_event *_ev;
+    uint64_t _head;
+
+    if(_ring == NULL && (_ring = trace_ring_get()) == NULL)
+        return;
+
+    _head = _ring->head;
+    _ev = &_ring->ev[_head & (TRACE_RING - 1)];
+    _ev->ts = now_ns();
+    _ev->arg = arg;
+    _ev->type = type;
+    _ev->tid = trace_tid;
+    __atomic_store_n(&_ring->head, _head + 1, __ATOMIC_RELEASE);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int trace_dump(const char *path)
+|                   *path : file to write
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Writes the events still held by every ring as Chrome
+|               trace-event JSON. Loop sleeps and log writes become begin/end
+|               pairs, everything else instant events.
+------------------------------------------------------------------------------*/
+int trace_dump(const char *path)
+{
+    struct trace_event *_copy;
+    struct trace_event *_ev;
+    uint64_t _h1, _h2, _from;
+    FILE *_out;
+    int _first = 1;
+    long _events = 0;
+
+    if(!trace_on)
+        return 0;
+
+    if((_copy = malloc(TRACE_RING * sizeof *_copy)) == NULL)
+        return -1;
+
+    if((_out = fopen(path, "w")) == NULL)
+    {
+        printf("\tError opening trace file %s\n", path);
+        printf("\tError code: %s\n\n", strerror(errno));
+        free(_copy);
+        return -1;
+    }
+
+    fprintf(_out, "{\"traceEvents\":[\n");
+    pthread_mutex_lock(&trace_lock);
+    for(struct trace_ring *r = trace_all; r != NULL; r = r->next)
+    {
+        _h1 = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        _from = _h1 > TRACE_RING ? _h1 - TRACE_RING : 0;
+        for(uint64_t i = _from; i < _h1; i++)
+            _copy[i & (TRACE_RING - 1)] = r->ev[i & (TRACE_RING - 1)];
+
+        // drop slots the writer may have reused while they were copied
+        _h2 = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        if(_h2 >= TRACE_RING && _h2 - TRACE_RING + 1 > _from)
+            _from = _h2 - TRACE_RING + 1;
+
+        for(uint64_t i = _from; i < _h1; i++)
+        {
+            _ev = &_copy[i & (TRACE_RING - 1)];
+            fprintf(_out, "%s{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":%d,\"tid\":%u,\"args\":{\"v\":%u}}",
+                    _first ? "" : ",\n", trace_names[_ev->type],
+                    _ev->type == TR_WAIT || _ev->type == TR_LOG_BEGIN ? "B" :
+                    _ev->type == TR_WAKE || _ev->type == TR_LOG_END ? "E" : "i\",\"s\":\"t",
+                    (_ev->ts - trace_t0) / 1000.0, (int)getpid(), _ev->tid, _ev->arg);
+            _first = 0;
+            _events++;
+        }
+    }
+    pthread_mutex_unlock(&trace_lock);
+    fprintf(_out, "\n]}\n");
+
+    fclose(_out);
+    free(_copy);
+    printf("- Trace: %ld events written to %s\n", _events, path);
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   static struct trace_ring *trace_ring_get()
+|
+|   RETURN:     calling thread's ring, NULL if the thread goes untraced
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Gives the thread a ring on its first event, reusing a ring of
+|               an exited thread when there is one.
+------------------------------------------------------------------------------*/
+static struct trace_ring *trace_ring_get()
+{
+    struct trace_ring *_ring = NULL;
+
+    if(trace_none)
+        return NULL;
+
+    pthread_mutex_lock(&trace_lock);
+    if(trace_free != NULL)
+    {
+        _ring = trace_free;
+        trace_free = _ring->free_next;
+    }
+    else if(trace_nrings < TRACE_MAXRINGS && (_ring = calloc(1, sizeof *_ring)) != NULL)
+    {
+        _ring->next = trace_all;
+        trace_all = _ring;
+        trace_nrings++;
+    }
+    trace_tid = ++trace_next_tid;
+    pthread_mutex_unlock(&trace_lock);
+
+    if(_ring == NULL)
+    {
+        trace_none = 1;
+        return NULL;
+    }
+
+    pthread_setspecific(trace_key, _ring);
+    trace_mine = _ring;
+    return _ring;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   static void trace_release(void *arg)
+|                   *arg : ring of the exiting thread
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Thread exit destructor: puts the ring on the free list. Its
+|               events stay in place until a new owner overwrites them.
+------------------------------------------------------------------------------*/
+static void trace_release(void *arg)
+{
+    struct trace_ring *_ring = arg;
+
+    pthread_mutex_lock(&trace_lock);
+    _ring->free_next = trace_free;
+    trace_free = _ring;
+    pthread_mutex_unlock(&trace_lock);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   static void *trace_dumper(void *arg)
+|                   *arg : unused
+|
+|   RETURN:     never returns
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Waits for SIGUSR1 and dumps the trace every time it arrives.
+------------------------------------------------------------------------------*/
+static void *trace_dumper(void *arg)
+{
+    sigset_t _set;
+    int _sig;
+
+    (void)arg;
+    sigemptyset(&_set);
+    sigaddset(&_set, SIGUSR1);
+
+    while(1)
+        if(sigwait(&_set, &_sig) == 0 && _sig == SIGUSR1)
+            trace_dump(trace_path);
+
+    return NULL;
+}
@@ -0,0 +1,270 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     verify.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that lets the client check every echo (--integrity).
+|               Each frame carries a header (stream, sequence number) and a
+|               pseudo-random body derived from both, plus a CRC32C of it all.
+|               An echo is checked by recomputing the CRC over the bytes that
+|               came back, so nothing has to be kept per request in flight,
+|               then by comparing its sequence number with the one just sent.
+|
+|               The CRC uses the SSE4.2 crc32 instruction 8 bytes at a time
+|               when the CPU has it (several GB/s per core, far more than a
+|               client thread pushes through a socket) and a table driven
+|               byte loop otherwise. The expected frame is only regenerated
+|               and compared byte by byte after a mismatch, to report where
+|               the corruption starts.
+------------------------------------------------------------------------------*/
+#include "../include/verify.h"
+#include "../include/keydist.h"
+#include <string.h>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+/* --- Global ---- */
+static uint32_t crc_table[256];
+static uint32_t (*crc_fn)(const void *, int) = crc32c_sw;
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void verify_init()
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Builds the table of the software CRC32C (Castagnoli,
+|               reflected polynomial 0x82F63B78) and picks the hardware one
+|               when the CPU supports SSE4.2. Must run before clients start.
+------------------------------------------------------------------------------*/
+void verify_init()
+{
+    uint32_t _c;
+
+    for(int i = 0; i < 256; i++)
+    {
+        _c = i;
+        for(int j = 0; j < 8; j++)
+            _c = _c & 1 ? (_c >> 1) ^ 0x82F63B78 : _c >> 1;
+        crc_table[i] = _c;
+    }
+
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("sse4.2"))
+        crc_fn = crc32c_hw;
+#endif
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   const char *verify_impl()
+|
+|   RETURN:     name of the CRC32C implementation in use
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       For the run banner.
+------------------------------------------------------------------------------*/
+const char *verify_impl()
+{
+    return crc_fn == crc32c_sw ? "table" : "sse4.2";
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   uint32_t crc32c(const void *buff, int len)
+|                   *buff : bytes to checksum
+|                   len   : number of bytes
+|
+|   RETURN:     CRC32C of the bytes
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Calls the implementation chosen by verify_init().
+------------------------------------------------------------------------------*/
+uint32_t crc32c(const void *buff, int len)
+{
+    return crc_fn(buff, len);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   uint32_t crc32c_sw(const void *buff, int len)
+|                   *buff : bytes to checksum
+|                   len   : number of bytes
+|
+|   RETURN:     CRC32C of the bytes
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Portable byte at a time CRC32C.
+------------------------------------------------------------------------------*/
+uint32_t crc32c_sw(const void *buff, int len)
+{
+    const uint8_t *_p = buff;
+    uint32_t _crc = 0xFFFFFFFF;
+
+    while(len-- > 0)
+        _crc = crc_table[(_crc ^ *_p++) & 0xFF] ^ (_crc >> 8);
+
+    return ~_crc;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   uint32_t crc32c_hw(const void *buff, int len)
+|                   *buff : bytes to checksum
+|                   len   : number of bytes
+|
+|   RETURN:     CRC32C of the bytes
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       CRC32C with the SSE4.2 crc32 instruction, 8 bytes per step
+|               then the tail byte by byte. Compiled for SSE4.2 on its own so
+|               the rest of the program still runs on any x86-64; only
+|               called once verify_init() has checked the CPU. Falls back to
+|               the table on other architectures.
+------------------------------------------------------------------------------*/
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+uint32_t crc32c_hw(const void *buff, int len)
+{
+    const uint8_t *_p = buff;
+    uint64_t _crc = 0xFFFFFFFF;
+    uint64_t _word;
+
+    for(; len >= 8; len -= 8, _p += 8)
+    {
+        memcpy(&_word, _p, 8);  // unaligned load
+        _crc = _mm_crc32_u64(_crc, _word);
+    }
+    while(len-- > 0)
+        _crc = _mm_crc32_u8((uint32_t)_crc, *_p++);
+
+    return ~(uint32_t)_crc;
+}
+#else
+uint32_t crc32c_hw(const void *buff, int len)
+{
+    return crc32c_sw(buff, len);
+}
+#endif
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void verify_fill(char *frame, int len, uint64_t stream, uint64_t seq)
+|                   *frame : buffer to build the frame in
+|                   len    : frame size (at least a header)
+|                   stream : client sending the frame
+|                   seq    : request number within the stream
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Writes the header, a body that differs for every (stream,
+|               seq) pair, and the CRC over both.
+------------------------------------------------------------------------------*/
+void verify_fill(char *frame, int len, uint64_t stream, uint64_t seq)
+{
+    struct verify_hdr _hdr;
+    uint64_t _rng = ((stream << 40) ^ seq) * 0x9E3779B97F4A7C15ULL | 1;
+    uint64_t _word;
+    int _i;
+
+    _hdr.magic = VERIFY_MAGIC;
+    _hdr.crc = 0;
+    _hdr.seq = seq;
+    _hdr.stream = stream;
+    memcpy(frame, &_hdr, sizeof(_hdr));
+
+    for(_i = sizeof(_hdr); _i + 8 <= len; _i += 8)
+    {
+        _word = xorshift64(&_rng);
+        memcpy(frame + _i, &_word, 8);
+    }
+    _word = xorshift64(&_rng);
+    memcpy(frame + _i, &_word, len - _i);
+
+    _hdr.crc = crc32c(frame + 8, len - 8);
+    memcpy(frame + 4, &_hdr.crc, sizeof(_hdr.crc));
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int verify_check(const char *frame, int len, uint64_t stream, uint64_t seq)
+|                   *frame : echo received (len bytes)
+|                   len    : frame size
+|                   stream : client that sent the request
+|                   seq    : request number just sent
+|
+|   RETURN:     VERIFY_OK, VERIFY_CORRUPT or VERIFY_MISORDERED
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       A frame whose bytes don't match its CRC (or magic) was
+|               corrupted. An intact frame of another stream or sequence
+|               number means the server mixed up, replayed or reordered
+|               frames.
+------------------------------------------------------------------------------*/
+int verify_check(const char *frame, int len, uint64_t stream, uint64_t seq)
+{
+    struct verify_hdr _hdr;
+
+    memcpy(&_hdr, frame, sizeof(_hdr));
+    if(_hdr.magic != VERIFY_MAGIC || _hdr.crc != crc32c(frame + 8, len - 8))
+        return VERIFY_CORRUPT;
+
+    if(_hdr.stream != stream || _hdr.seq != seq)
+        return VERIFY_MISORDERED;
+
+    return VERIFY_OK;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int verify_first_diff(const char *frame, int len, uint64_t stream, uint64_t seq)
+|                   *frame : echo that failed verify_check()
+|                   len    : frame size
+|                   stream : client that sent the request
+|                   seq    : request number just sent
+|
+|   RETURN:     offset of the first byte that differs from the frame sent,
+|               -1 if none does
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Rebuilds the frame that was sent and compares. Only used to
+|               describe a failure, never on the fast path.
+------------------------------------------------------------------------------*/
+int verify_first_diff(const char *frame, int len, uint64_t stream, uint64_t seq)
+{
+    char _sent[len];
+
+    verify_fill(_sent, len, stream, seq);
+    for(int i = 0; i < len; i++)
+        if(frame[i] != _sent[i])
+            return i;
+
+    return -1;
+}
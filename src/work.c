@@ -0,0 +1,201 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     work.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that provides synthetic per-request work for the server
+|               handlers. Pure echo makes every I/O model look I/O bound, so a
+|               work model can be selected to make each request cost CPU time,
+|               memory bandwidth or a blocking wait:
+|                   - spin:NS      busy loop for NS nanoseconds
+|                   - touch:BYTES  touch a per-thread working set of BYTES
+|                   - hash         checksum the request payload
+|                   - block:MS     sleep MS milliseconds (blocking call)
+------------------------------------------------------------------------------*/
+#include "../include/work.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* ---- Macros ---- */
+#define CACHELINE 64
+
+/* --- Global ---- */
+static volatile unsigned int work_sink;     // keeps results from being optimized out
+static __thread char *work_set = NULL;      // per-thread working set (WORK_TOUCH)
+static __thread size_t work_set_size = 0;
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int parse_work(const char *spec, struct work_cfg *work)
+|                   *spec : work model string (e.g. "spin:2000")
+|                   *work : work config to fill in
+|
+|   RETURN:     0 on success, -1 on invalid spec
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Parses a work model given on the command line.
+------------------------------------------------------------------------------*/
+int parse_work(const char *spec, struct work_cfg *work)
+{
+    const char *_arg = strchr(spec, ':');
+    size_t _len = _arg ? (size_t)(_arg - spec) : strlen(spec);
+
+    work->arg = _arg ? atol(_arg + 1) : 0;
+
+    if(strncmp(spec, "none", _len) == 0 && _len == 4)
+        work->model = WORK_NONE;
+    else if(strncmp(spec, "spin", _len) == 0 && _len == 4 && work->arg > 0)
+        work->model = WORK_SPIN;
+    else if(strncmp(spec, "touch", _len) == 0 && _len == 5 && work->arg > 0)
+        work->model = WORK_TOUCH;
+    else if(strncmp(spec, "hash", _len) == 0 && _len == 4)
+        work->model = WORK_HASH;
+    else if(strncmp(spec, "block", _len) == 0 && _len == 5 && work->arg > 0)
+        work->model = WORK_BLOCK;
+    else
+        return -1;
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   unsigned int do_work(const struct work_cfg *work, const char *buff,
+|                                    int len)
+|                   *work : work model to run
+|                   *buff : request payload
+|                   len   : length of payload
+|
+|   RETURN:     result of the work (checksum etc.), 0 for models without one
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Runs the selected work model once for a request.
+------------------------------------------------------------------------------*/
+unsigned int do_work(const struct work_cfg *work, const char *buff, int len)
+{
+    struct timespec _ts;
+    unsigned int _res = 0;
+
+    switch(work->model)
+    {
+        case WORK_NONE:
+            return 0;
+        case WORK_SPIN:
+            spin_ns(work->arg);
+            break;
+        case WORK_TOUCH:
+            _res = touch_set(work->arg);
+            break;
+        case WORK_HASH:
+            _res = hash_buff(buff, len);
+            break;
+        case WORK_BLOCK:
+            _ts.tv_sec = work->arg / 1000;
+            _ts.tv_nsec = (work->arg % 1000) * 1000000L;
+            nanosleep(&_ts, NULL);
+            break;
+    }
+
+    work_sink = _res;
+    return _res;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void spin_ns(long ns)
+|                   ns : nanoseconds to spin for
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Busy loops on the monotonic clock for 'ns' nanoseconds.
+------------------------------------------------------------------------------*/
+void spin_ns(long ns)
+{
+    struct timespec _start, _now;
+    long _elapsed;
+
+    clock_gettime(CLOCK_MONOTONIC, &_start);
+    do
+    {
+        clock_gettime(CLOCK_MONOTONIC, &_now);
+        _elapsed = (_now.tv_sec - _start.tv_sec) * 1000000000L + (_now.tv_nsec - _start.tv_nsec);
+    } while(_elapsed < ns);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   unsigned int touch_set(size_t bytes)
+|                   bytes : size of working set
+|
+|   RETURN:     sum of the bytes read
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Reads and writes one byte in every cache line of a per-thread
+|               working set of 'bytes'. The set is allocated on first use, so
+|               its footprint scales with the number of handler threads.
+------------------------------------------------------------------------------*/
+unsigned int touch_set(size_t bytes)
+{
+    unsigned int _sum = 0;
+
+    if(work_set_size != bytes)
+    {
+        free(work_set);
+        if((work_set = calloc(1, bytes)) == NULL)
+        {
+            work_set_size = 0;
+            return 0;
+        }
+        work_set_size = bytes;
+    }
+
+    for(size_t i = 0; i < bytes; i += CACHELINE)
+    {
+        _sum += (unsigned char)work_set[i];
+        work_set[i]++;
+    }
+
+    return _sum;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   unsigned int hash_buff(const char *buff, int len)
+|                   *buff : data to hash
+|                   len   : length of data
+|
+|   RETURN:     32 bit FNV-1a hash of the data
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Checksums the request payload byte by byte.
+------------------------------------------------------------------------------*/
+unsigned int hash_buff(const char *buff, int len)
+{
+    unsigned int _hash = 2166136261u;
+
+    for(int i = 0; i < len; i++)
+    {
+        _hash ^= (unsigned char)buff[i];
+        _hash *= 16777619u;
+    }
+
+    return _hash;
+}
@@ -0,0 +1,266 @@
+/*------------------------------------------------------------------------------
+|   SOURCE:     workers.c
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Module that runs the N event loop workers of the steal and
+|               fiber backends. Every worker owns an epoll instance holding
+|               the shared listeners (EPOLLEXCLUSIVE, so a new connection
+|               wakes one worker) and the group's stop eventfd. Worker 0 runs
+|               on the calling thread so it sees SIGINT, and it alone decides
+|               when the server stops: on SIGINT, or once no worker has had an
+|               event for the idle timeout. workers_stop() then raises the
+|               quit flag, writes the eventfd, which is never read so it wakes
+|               every worker, and joins them.
+------------------------------------------------------------------------------*/
+#include "../include/workers.h"
+#include "../include/hist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int workers_init(struct srv_workers *ws, int n)
+|                   *ws : worker group to set up
+|                   n   : number of workers
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Creates the stop eventfd and the per-worker state. Every
+|               worker's clock starts now.
+------------------------------------------------------------------------------*/
+int workers_init(struct srv_workers *ws, int n)
+{
+    memset(ws, 0, sizeof *ws);
+    ws->n = n;
+    ws->started = 1;
+
+    if((ws->qfd = eventfd(0, EFD_NONBLOCK)) == -1)
+    {
+        printf("\tError creating worker stop eventfd\n");
+        printf("\tError code: %s\n\n", strerror(errno));
+        return -1;
+    }
+
+    if((ws->threads = calloc(n, sizeof *ws->threads)) == NULL
+       || (ws->last = aligned_alloc(64, n * sizeof *ws->last)) == NULL)
+    {
+        printf("\tError allocating workers\n");
+        free(ws->threads);
+        close(ws->qfd);
+        return -1;
+    }
+
+    for(int i = 0; i < n; i++)
+        ws->last[i].ns = now_ns();
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int workers_epoll(struct srv_workers *ws, struct srv_nw_var *nw)
+|                   *ws : worker group
+|                   *nw : server network variables (listeners)
+|
+|   RETURN:     epoll file descriptor, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Creates a worker's epoll instance with every listener and the
+|               stop eventfd in it. Listener events carry the listener, the
+|               stop event a NULL pointer.
+------------------------------------------------------------------------------*/
+int workers_epoll(struct srv_workers *ws, struct srv_nw_var *nw)
+{
+    struct epoll_event _event;
+    int _esd;
+
+    if((_esd = epoll_create1(0)) == -1)
+    {
+        printf("\tError creating epoll file descriptor\n");
+        printf("\tError code: %s\n\n", strerror(errno));
+        return -1;
+    }
+
+    // level triggered: a worker accepts until EAGAIN but may leave some
+    for(int l = 0; l < nw->nlisten; l++)
+    {
+        _event.data.ptr = &nw->listen[l];
+        _event.events = EPOLLIN | EPOLLEXCLUSIVE;
+        if(epoll_ctl(_esd, EPOLL_CTL_ADD, nw->listen[l].sd, &_event) == -1)
+        {
+            printf("\tError adding server sock to epoll event loop\n");
+            printf("\tError code: %s\n\n", strerror(errno));
+            close(_esd);
+            return -1;
+        }
+    }
+
+    // level triggered and never read: once written it wakes every worker
+    _event.data.ptr = NULL;
+    _event.events = EPOLLIN;
+    if(epoll_ctl(_esd, EPOLL_CTL_ADD, ws->qfd, &_event) == -1)
+    {
+        printf("\tError adding stop eventfd to epoll event loop\n");
+        printf("\tError code: %s\n\n", strerror(errno));
+        close(_esd);
+        return -1;
+    }
+
+    return _esd;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int workers_start(struct srv_workers *ws, void *(*loop)(void *),
+|                                 void *workers, size_t size)
+|                   *ws      : worker group
+|                   *loop    : worker loop, returns NULL or (void *)-1 on error
+|                   *workers : array of the backend's worker structures
+|                   size     : size of one of them
+|
+|   RETURN:     0 on success, -1 on failure
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Starts a thread for workers 1 to n-1; worker 0 is left to the
+|               caller. On failure the threads already running are counted in
+|               'started' so workers_stop() still joins them.
+------------------------------------------------------------------------------*/
+int workers_start(struct srv_workers *ws, void *(*loop)(void *), void *workers, size_t size)
+{
+    int _err;
+
+    for(; ws->started < ws->n; ws->started++)
+    {
+        if((_err = pthread_create(&ws->threads[ws->started], NULL, loop,
+                                  (char *)workers + ws->started * size)) != 0)
+        {
+            printf("\n\tError creating worker thread\n");
+            printf("\tError code: %s\n\n", strerror(_err));
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int workers_stopping(struct srv_workers *ws)
+|                   *ws : worker group
+|
+|   RETURN:     1 once the workers must stop, else 0
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Loop condition of every worker.
+------------------------------------------------------------------------------*/
+int workers_stopping(struct srv_workers *ws)
+{
+    return srv_stop || __atomic_load_n(&ws->quit, __ATOMIC_ACQUIRE);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   void workers_busy(struct srv_workers *ws, int id)
+|                   *ws : worker group
+|                   id  : worker that had an event
+|
+|   RETURN:     void
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Records that a worker had an event now. Each worker only
+|               writes its own cache line.
+------------------------------------------------------------------------------*/
+void workers_busy(struct srv_workers *ws, int id)
+{
+    __atomic_store_n(&ws->last[id].ns, now_ns(), __ATOMIC_RELAXED);
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int workers_idle(struct srv_workers *ws, int timeout)
+|                   *ws     : worker group
+|                   timeout : idle timeout (ms)
+|
+|   RETURN:     1 if no worker had an event for 'timeout' ms, else 0
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Checked by worker 0 when its own wait times out, so the
+|               server doesn't time out while other workers are active.
+------------------------------------------------------------------------------*/
+int workers_idle(struct srv_workers *ws, int timeout)
+{
+    uint64_t _now = now_ns(), _last = 0, _t;
+
+    for(int i = 0; i < ws->n; i++)
+        if((_t = __atomic_load_n(&ws->last[i].ns, __ATOMIC_RELAXED)) > _last)
+            _last = _t;
+
+    return _now - _last >= timeout * 1000000ull;
+}
+
+
+/*------------------------------------------------------------------------------
+|   FUNCTION:   int workers_stop(struct srv_workers *ws)
+|                   *ws : worker group
+|
+|   RETURN:     0 if every worker thread ended cleanly, -1 if one failed
+|
+|   DATE:       Oct 18, 2026
+|
+|   AUTHOR:     Alex Zielinski
+|
+|   DESC:       Called by worker 0 once its loop ends. Raises the quit flag,
+|               wakes the other workers and joins them, then releases the
+|               group. The workers' own state (epoll, connections) is left to
+|               the backend.
+------------------------------------------------------------------------------*/
+int workers_stop(struct srv_workers *ws)
+{
+    uint64_t _one = 1;
+    void *_res;
+    int _ret = 0;
+
+    __atomic_store_n(&ws->quit, 1, __ATOMIC_RELEASE);
+    if(write(ws->qfd, &_one, sizeof(_one)) == -1)
+    {
+        printf("\tError waking workers\n");
+        printf("\tError code: %s\n\n", strerror(errno));
+    }
+
+    for(int i = 1; i < ws->started; i++)
+    {
+        pthread_join(ws->threads[i], &_res);
+        if(_res != NULL)
+            _ret = -1;
+    }
+
+    close(ws->qfd);
+    free(ws->threads);
+    free(ws->last);
+    return _ret;
+}